@@ -0,0 +1,222 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "BroadPhase.hpp"
+#include "Trace.hpp"
+#include "World.hpp"
+
+namespace fzx
+{
+
+BroadPhase::BroadPhase() : mStrategy(SWEEP_AND_PRUNE), mNumberOfBuilds(0), mIsStaticChanged(true) {}
+
+void BroadPhase::updateStaticBodies(World& world)
+{
+   //The tree is stale if a static body was added, removed or shifted to another
+   //index in the World.
+   unsigned numberOfStatic = 0;
+   bool isChanged = mIsStaticChanged;
+   for (unsigned i = 0; i < world.getNumberOfBodies(); i++)
+   {
+      RigidBody& body = world.getBody(i);
+      if (body.getType() != RigidBody::STATIC) continue;
+      if (numberOfStatic >= mStaticBodies.size() || mStaticBodies[numberOfStatic] != &body ||
+          mStaticIndices[numberOfStatic] != i)
+         isChanged = true;
+      numberOfStatic++;
+   }
+   if (!isChanged && numberOfStatic == mStaticBodies.size()) return;
+
+   mStaticBodies.clear();
+   mStaticIndices.clear();
+   std::vector<Shape::BoundingBox> boxes;
+   boxes.reserve(numberOfStatic);
+   for (unsigned i = 0; i < world.getNumberOfBodies(); i++)
+   {
+      const RigidBody& body = world.getBody(i);
+      if (body.getType() != RigidBody::STATIC) continue;
+      mStaticBodies.push_back(&body);
+      mStaticIndices.push_back(i);
+      boxes.push_back(body.getShape().getBoundingBox(body.getTransform()));
+   }
+   mStaticTree.build(boxes.data(), boxes.size());
+   mNumberOfBuilds++;
+   mIsStaticChanged = false;
+}
+
+void BroadPhase::updateProxies(World& world)
+{
+   //Keep last update's order when the moving bodies are the same, so the
+   //insertion sort below only has to fix what moved.
+   unsigned numberOfMoving = world.getNumberOfBodies() - mStaticBodies.size();
+   bool isSame = mProxies.size() == numberOfMoving;
+   for (unsigned i = 0; isSame && i < mProxies.size(); i++)
+   {
+      const Proxy& proxy = mProxies[i];
+      isSame = proxy.index < world.getNumberOfBodies() && &world.getBody(proxy.index) == proxy.body;
+   }
+   if (!isSame)
+   {
+      mProxies.clear();
+      for (unsigned i = 0; i < world.getNumberOfBodies(); i++)
+      {
+         RigidBody& body = world.getBody(i);
+         if (body.getType() == RigidBody::STATIC) continue;
+         Proxy proxy;
+         proxy.body = &body;
+         proxy.index = i;
+         mProxies.push_back(proxy);
+      }
+   }
+
+   for (Proxy& proxy : mProxies)
+   {
+      const RigidBody& body = world.getBody(proxy.index);
+      proxy.boundingBox = body.getShape().getBoundingBox(body.getTransform());
+      proxy.isSleeping = body.isSleeping();
+   }
+
+   if (mStrategy != SWEEP_AND_PRUNE) return;
+   for (unsigned i = 1; i < mProxies.size(); i++)
+   {
+      Proxy proxy = mProxies[i];
+      unsigned j = i;
+      while (j > 0 && mProxies[j - 1].boundingBox.lowerLeft.x > proxy.boundingBox.lowerLeft.x)
+      {
+         mProxies[j] = mProxies[j - 1];
+         j--;
+      }
+      mProxies[j] = proxy;
+   }
+}
+
+void BroadPhase::sweepProxies(std::vector<Pair>& pairs)
+{
+   for (unsigned i = 0; i < mProxies.size(); i++)
+   {
+      const Proxy& proxy = mProxies[i];
+      const Shape::BoundingBox& box = proxy.boundingBox;
+      for (unsigned j = i + 1; j < mProxies.size(); j++)
+      {
+         const Proxy& other = mProxies[j];
+         if (other.boundingBox.lowerLeft.x > box.upperRight.x) break;
+         if (proxy.isSleeping && other.isSleeping) continue;
+         if (other.boundingBox.lowerLeft.y > box.upperRight.y ||
+             box.lowerLeft.y > other.boundingBox.upperRight.y) continue;
+         pairs.push_back(Pair{proxy.index, other.index});
+      }
+   }
+}
+
+void BroadPhase::findLinearBvhPairs(std::vector<Pair>& pairs)
+{
+   mMovingBoxes.resize(mProxies.size());
+   for (unsigned i = 0; i < mProxies.size(); i++) mMovingBoxes[i] = mProxies[i].boundingBox;
+   mLinearBvh->build(mMovingBoxes.data(), mMovingBoxes.size());
+   mLinearBvh->findPairs(mMovingPairs);
+   for (const LinearBvh::Pair& pair : mMovingPairs)
+   {
+      const Proxy& proxy = mProxies[pair.a];
+      const Proxy& other = mProxies[pair.b];
+      if (proxy.isSleeping && other.isSleeping) continue;
+      pairs.push_back(Pair{proxy.index, other.index});
+   }
+}
+
+void BroadPhase::dropSeparatedPairs(World& world, std::vector<Pair>& pairs)
+{
+   unsigned numberOfKept = 0;
+   for (const Pair& pair : pairs)
+   {
+      if (!mSeparatingAxes.isSeparated(world.getBody(pair.a), world.getBody(pair.b)))
+         pairs[numberOfKept++] = pair;
+   }
+   pairs.resize(numberOfKept);
+   mSeparatingAxes.endStep();
+}
+
+void BroadPhase::update(World& world, std::vector<Pair>& pairs)
+{
+   FZX_PROFILE_PHASE(world.getProfiler(), BROAD_PHASE);
+   FZX_TRACE_SPAN("Broad phase");
+   pairs.clear();
+   updateStaticBodies(world);
+   updateProxies(world);
+
+   //Moving against moving.
+   if (mStrategy == LINEAR_BVH) findLinearBvhPairs(pairs);
+   else sweepProxies(pairs);
+
+   //Moving against static, through the tree.
+   for (const Proxy& proxy : mProxies)
+   {
+      if (proxy.isSleeping) continue;
+      mQuery.clear();
+      mStaticTree.query(proxy.boundingBox, mQuery);
+      for (unsigned item : mQuery) pairs.push_back(Pair{proxy.index, mStaticIndices[item]});
+   }
+   FZX_PROFILE_COUNT(world.getProfiler(), candidatePairs, pairs.size());
+   FZX_TRACE_COUNTER("Candidate pairs", pairs.size());
+   dropSeparatedPairs(world, pairs);
+   FZX_TRACE_COUNTER("Pairs", pairs.size());
+}
+
+void BroadPhase::markStaticBodiesChanged()
+{
+   mIsStaticChanged = true;
+}
+
+const StaticTree& BroadPhase::getStaticTree() const
+{
+   return mStaticTree;
+}
+
+unsigned BroadPhase::getStaticBodyIndex(unsigned item) const
+{
+   return mStaticIndices[item];
+}
+
+void BroadPhase::setStrategy(Strategy strategy, unsigned numberOfThreads)
+{
+   if (strategy == LINEAR_BVH && !mLinearBvh) mLinearBvh.reset(new LinearBvh(numberOfThreads));
+   mStrategy = strategy;
+}
+
+BroadPhase::Strategy BroadPhase::getStrategy() const
+{
+   return mStrategy;
+}
+
+const SeparatingAxisCache& BroadPhase::getSeparatingAxisCache() const
+{
+   return mSeparatingAxes;
+}
+
+unsigned BroadPhase::getNumberOfBuilds() const
+{
+   return mNumberOfBuilds;
+}
+
+}
@@ -0,0 +1,206 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_BROAD_PHASE_HPP_
+#define FZX_BROAD_PHASE_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "LinearBvh.hpp"
+#include "Memory.hpp"
+#include "SeparatingAxisCache.hpp"
+#include "StaticTree.hpp"
+
+namespace fzx
+{
+
+class World;
+class RigidBody;
+
+/**
+ * Finds the pairs of RigidBodys in a World whose BoundingBoxes overlap.
+ *
+ * STATIC bodies are kept in a StaticTree that is only rebuilt when the set of
+ * static bodies changes, so adding a batch of them costs one build. Moving
+ * bodies are swept and pruned along x every update, and each of them queries
+ * the tree. Two static bodies are never paired, and neither are two sleeping
+ * ones.
+ *
+ * With the LINEAR_BVH strategy, the moving bodies are instead put in a
+ * LinearBvh rebuilt in parallel every update, which holds up better than the
+ * sweep when many bodies move far each step, as in explosions.
+ *
+ * Pairs whose BoundingBoxes overlap but that a face of either body separates
+ * are dropped through a SeparatingAxisCache, so a pair that stays apart costs
+ * one projection per update instead of a Collision.
+ */
+class BroadPhase
+{
+public:
+   /**
+    * How the moving bodies are paired with each other.
+    */
+   enum Strategy
+   {
+      SWEEP_AND_PRUNE, ///< Sorted along x, reusing the last order.
+      LINEAR_BVH ///< A LinearBvh rebuilt every update.
+   };
+
+   /**
+    * Two RigidBodys that might be touching, by index in the World.
+    */
+   struct Pair
+   {
+      unsigned a; ///< The index of the first RigidBody.
+      unsigned b; ///< The index of the second RigidBody.
+   };
+private:
+   /**
+    * A moving RigidBody in the sweep.
+    */
+   struct Proxy
+   {
+      Shape::BoundingBox boundingBox; ///< The BoundingBox of the body this update.
+      const RigidBody* body; ///< The body, to notice when the World changes.
+      unsigned index; ///< The index of the body in the World.
+      bool isSleeping; ///< Whether the body is asleep.
+   };
+
+   StaticTree mStaticTree; ///< The tree of the static bodies.
+   std::vector<const RigidBody*, TrackingAllocator<const RigidBody*, Memory::BROAD_PHASE>> mStaticBodies; ///< The static bodies, as items of the tree.
+   std::vector<unsigned, TrackingAllocator<unsigned, Memory::BROAD_PHASE>> mStaticIndices; ///< The index of each static body in the World.
+   std::vector<Proxy, TrackingAllocator<Proxy, Memory::BROAD_PHASE>> mProxies; ///< The moving bodies, sorted by their lowest x for the sweep.
+   std::vector<unsigned> mQuery; ///< Reused for the results of tree queries.
+   Strategy mStrategy; ///< How the moving bodies are paired.
+   std::unique_ptr<LinearBvh> mLinearBvh; ///< The tree of the moving bodies, made when first selected.
+   std::vector<Shape::BoundingBox, TrackingAllocator<Shape::BoundingBox, Memory::BROAD_PHASE>> mMovingBoxes; ///< The boxes of the proxies, for the LinearBvh.
+   std::vector<LinearBvh::Pair> mMovingPairs; ///< Reused for the pairs of the LinearBvh.
+   SeparatingAxisCache mSeparatingAxes; ///< Drops the pairs a face still separates.
+   unsigned mNumberOfBuilds; ///< The number of times the tree was built.
+   bool mIsStaticChanged; ///< Whether the tree must be rebuilt at the next update.
+
+   /**
+    * Rebuilds the tree if the static bodies changed.
+    */
+   void updateStaticBodies(World& world);
+
+   /**
+    * Refreshes the proxies of the moving bodies, sorting them for the sweep.
+    */
+   void updateProxies(World& world);
+
+   /**
+    * Pairs the moving bodies with each other by sweeping the proxies.
+    */
+   void sweepProxies(std::vector<Pair>& pairs);
+
+   /**
+    * Pairs the moving bodies with each other through the LinearBvh.
+    */
+   void findLinearBvhPairs(std::vector<Pair>& pairs);
+
+   /**
+    * Removes the pairs a face of either body separates, and ends the step of
+    * the SeparatingAxisCache.
+    */
+   void dropSeparatedPairs(World& world, std::vector<Pair>& pairs);
+public:
+   /**
+    * Creates an empty BroadPhase.
+    */
+   BroadPhase();
+
+   /**
+    * Finds the pairs of the World that might be touching. Call it once per
+    * step, since each call ends a step of the SeparatingAxisCache.
+    *
+    * @param world The World to look at.
+    * @param pairs The vector the pairs are written to. Its previous content is
+    *              replaced.
+    */
+   void update(World& world, std::vector<Pair>& pairs);
+
+   /**
+    * Forces the tree to be rebuilt at the next update.
+    *
+    * Call it after moving or reshaping a static body, since the BroadPhase only
+    * notices static bodies being added or removed.
+    */
+   void markStaticBodiesChanged();
+
+   /**
+    * Returns the tree of the static bodies.
+    *
+    * Its items are positions in the list of static bodies, see
+    * getStaticBodyIndex().
+    *
+    * @return A constant reference to the StaticTree.
+    */
+   const StaticTree& getStaticTree() const;
+
+   /**
+    * Returns the index in the World of a static body of the tree.
+    *
+    * @param  item An item of the StaticTree.
+    * @return The index of the RigidBody in the World.
+    */
+   unsigned getStaticBodyIndex(unsigned item) const;
+
+   /**
+    * Selects how the moving bodies are paired with each other.
+    *
+    * @param strategy        The Strategy.
+    * @param numberOfThreads The threads of the LinearBvh, if it's made now. 0
+    *                        uses one per hardware thread.
+    */
+   void setStrategy(Strategy strategy, unsigned numberOfThreads = 0);
+
+   /**
+    * Returns how the moving bodies are paired with each other.
+    *
+    * @return The Strategy.
+    */
+   Strategy getStrategy() const;
+
+   /**
+    * Returns the cache of separating faces, whose Stats tell how many pairs
+    * were dropped in the last update.
+    *
+    * @return A constant reference to the SeparatingAxisCache.
+    */
+   const SeparatingAxisCache& getSeparatingAxisCache() const;
+
+   /**
+    * Returns the number of times the tree was built.
+    *
+    * @return The number of builds.
+    */
+   unsigned getNumberOfBuilds() const;
+};
+
+}
+
+#endif /*FZX_BROAD_PHASE_HPP_*/
@@ -8,19 +8,25 @@
 namespace fzx
 {
 
+class ContactEvents;
+class IslandSolver;
+
 /**
  * A representation of a collision between two RigidBodys.
  */
 class Collision
 {
 friend World;
+friend WorldSerializer;
+friend ContactEvents;
+friend IslandSolver;
 public:
 /**
  * The data of a point of contact in the Collision.
  */
 struct ContactData
 {
-   Vec2f normal; ///< The normal vector to the flat surface of the contact.
+   Vec2f normal; ///< The unit normal to the flat surface of the contact, always pointing from the first body to the second.
    Vec2f tangent; ///< The tangent vector to the flat surface of the contact.
    Vec2f location; ///< The location of the contact in real space.
    Vec2f velocity; ///< The relative velocity of the point of contact.
@@ -29,11 +35,12 @@ struct ContactData
    float normalImpulse; ///< The impulse exchange from the contact in the normal.
    float tangentImpulse; ///< The impulse exchange from the contact in the tangent.
    float penetration; ///< The amount the object penetrated in this contact.
+   unsigned featureId; ///< Names the features in contact, matching the contact of the last step. 0 when the pair has no feature ids.
 };
 private:
    RigidBody* mBodyA; ///< A pointer to RigidBody A
    RigidBody* mBodyB; ///< A pointer to RigidBody B
-   std::vector<ContactData> mContacts; ///< The contact locations of this collision.
+   std::vector<ContactData, TrackingAllocator<ContactData, Memory::CONTACTS>> mContacts; ///< The contact locations of this collision.
    float mMixedStaticFriction; ///< The static friction between the two surfaces.
    float mMixedKineticFriction; ///< The kinetic friction between the two surfaces.
    float mMixedRestitution; ///< The restituion between the two surfaces.
@@ -51,7 +58,8 @@ private:
     */
    void solveCircleVsPolygon();
    /**
-    * Solves the contacts between two Rectangles
+    * Solves the contacts between two Rectangles with Rectangle::collide(),
+    * copying the feature id of each contact of its Manifold into featureId.
     */
    void solveRectangleVsRectangle();
    /**
@@ -0,0 +1,108 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "ContactEvents.hpp"
+#include "World.hpp"
+
+#include <algorithm>
+
+namespace fzx
+{
+
+void ContactEvents::update(const World& world)
+{
+   mNextContacts.clear();
+   for (unsigned i = 0; i < world.getNumberOfCollisions(); i++)
+   {
+      const Collision& collision = world.getCollision(i);
+      if (collision.getNumberOfContacts() == 0) continue;
+
+      Contact contact;
+      contact.bodyA = collision.mBodyA;
+      contact.bodyB = collision.mBodyB;
+      contact.lowId = std::min(contact.bodyA->getId(), contact.bodyB->getId());
+      contact.highId = std::max(contact.bodyA->getId(), contact.bodyB->getId());
+      contact.normal = collision.getContactData(0).normal;
+      contact.maxImpulse = 0;
+      for (unsigned j = 0; j < collision.getNumberOfContacts(); j++)
+         contact.maxImpulse = std::max(contact.maxImpulse, collision.getContactData(j).normalImpulse);
+      mNextContacts.push_back(contact);
+   }
+   std::sort(mNextContacts.begin(), mNextContacts.end());
+
+   //Walk both sorted sets together.
+   mBack.clear();
+   unsigned last = 0, next = 0;
+   while (last < mContacts.size() || next < mNextContacts.size())
+   {
+      bool hasLast = last < mContacts.size();
+      bool hasNext = next < mNextContacts.size();
+      ContactEvent event;
+      const Contact* contact;
+      if (hasLast && (!hasNext || mContacts[last] < mNextContacts[next]))
+      {
+         event.type = ContactEvent::END;
+         contact = &mContacts[last++];
+      }
+      else if (hasNext && (!hasLast || mNextContacts[next] < mContacts[last]))
+      {
+         event.type = ContactEvent::BEGIN;
+         contact = &mNextContacts[next++];
+      }
+      else
+      {
+         event.type = ContactEvent::PERSIST;
+         last++;
+         contact = &mNextContacts[next++];
+      }
+      event.bodyA = contact->bodyA;
+      event.bodyB = contact->bodyB;
+      event.normal = contact->normal;
+      event.maxImpulse = event.type == ContactEvent::END ? 0 : contact->maxImpulse;
+      mBack.push_back(event);
+   }
+   mContacts.swap(mNextContacts);
+
+   std::lock_guard<std::mutex> lock(mMutex);
+   if (mFront.empty()) mFront.swap(mBack);
+   else mFront.insert(mFront.end(), mBack.begin(), mBack.end());
+}
+
+void ContactEvents::drain(std::vector<ContactEvent>& events)
+{
+   events.clear();
+   std::lock_guard<std::mutex> lock(mMutex);
+   mFront.swap(events);
+}
+
+void ContactEvents::clear()
+{
+   mContacts.clear();
+   mBack.clear();
+   std::lock_guard<std::mutex> lock(mMutex);
+   mFront.clear();
+}
+
+}
@@ -0,0 +1,134 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_CONTACT_EVENTS_HPP_
+#define FZX_CONTACT_EVENTS_HPP_
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "Vec2.hpp"
+
+namespace fzx
+{
+
+class World;
+class RigidBody;
+
+/**
+ * A change in the contact between two RigidBodys during a step.
+ */
+struct ContactEvent
+{
+   /**
+    * The kind of change.
+    *
+    * BEGIN means the bodies started touching this step.
+    * PERSIST means they were already touching and still are.
+    * END means they stopped touching this step.
+    */
+   enum Type
+   {
+      BEGIN, PERSIST, END
+   };
+
+   Type type; ///< The kind of change.
+   const RigidBody* bodyA; ///< The first body of the Collision. Compare it, but don't dereference it in END events, the body may have been removed.
+   const RigidBody* bodyB; ///< The second body of the Collision.
+   Vec2f normal; ///< The normal of the first contact, as the Collision reports it. The last known one in END events.
+   float maxImpulse; ///< The largest normal impulse of any contact this step, 0 in END events.
+};
+
+/**
+ * Turns the Collisions of each step into BEGIN, PERSIST and END events by
+ * comparing them with the pairs of the step before.
+ *
+ * Pairs are matched and ordered by the ids of their RigidBodys, so the events
+ * come in the same order on every run, and a body made where a removed one
+ * was is a new pair rather than a PERSIST. The bodies and normal of an event
+ * keep the order of their Collision.
+ *
+ * The events are double-buffered: update() fills one buffer on the stepping
+ * thread and publishes it, and drain() hands the published events to any
+ * thread. Events that aren't drained before the next update are kept, so a
+ * slower consumer doesn't miss any.
+ */
+class ContactEvents
+{
+private:
+   /**
+    * A pair of bodies that was touching.
+    */
+   struct Contact
+   {
+      uint64_t lowId; ///< The lower id of the two bodies.
+      uint64_t highId; ///< The higher id of the two bodies.
+      const RigidBody* bodyA; ///< The first body of the Collision.
+      const RigidBody* bodyB; ///< The second body of the Collision.
+      Vec2f normal; ///< The normal of the first contact.
+      float maxImpulse; ///< The largest normal impulse of the step.
+
+      bool operator<(const Contact& other) const
+      {
+         return lowId != other.lowId ? lowId < other.lowId : highId < other.highId;
+      }
+   };
+
+   std::vector<Contact> mContacts; ///< The pairs touching after the last update, sorted.
+   std::vector<Contact> mNextContacts; ///< The pairs of the current update, reused.
+   std::vector<ContactEvent> mBack; ///< The events being written by update().
+   std::vector<ContactEvent> mFront; ///< The published events, waiting for drain().
+   std::mutex mMutex; ///< Guards mFront.
+public:
+   /**
+    * Compares the Collisions of the World's last step with the step before and
+    * publishes the resulting events.
+    *
+    * Call it once after every World::step().
+    *
+    * @param world The World that was stepped.
+    */
+   void update(const World& world);
+
+   /**
+    * Takes every published event.
+    *
+    * Safe to call from another thread than update().
+    *
+    * @param events The vector the events are moved into. Its previous content
+    *               is replaced, and its storage is reused for later events.
+    */
+   void drain(std::vector<ContactEvent>& events);
+
+   /**
+    * Forgets every pair and event, so the next update only has BEGIN events.
+    */
+   void clear();
+};
+
+}
+
+#endif /*FZX_CONTACT_EVENTS_HPP_*/
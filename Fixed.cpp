@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "Fixed.hpp"
+
+#include <cmath>
+
+namespace fzx
+{
+
+namespace
+{
+
+/// sin(i * pi / 512) in Q16.16 for i in [0, 256], one quarter of a wave.
+const int32_t SINE_TABLE[257] =
+{
+   0, 402, 804, 1206, 1608, 2010, 2412, 2814,
+   3216, 3617, 4019, 4420, 4821, 5222, 5623, 6023,
+   6424, 6824, 7224, 7623, 8022, 8421, 8820, 9218,
+   9616, 10014, 10411, 10808, 11204, 11600, 11996, 12391,
+   12785, 13180, 13573, 13966, 14359, 14751, 15143, 15534,
+   15924, 16314, 16703, 17091, 17479, 17867, 18253, 18639,
+   19024, 19409, 19792, 20175, 20557, 20939, 21320, 21699,
+   22078, 22457, 22834, 23210, 23586, 23961, 24335, 24708,
+   25080, 25451, 25821, 26190, 26558, 26925, 27291, 27656,
+   28020, 28383, 28745, 29106, 29466, 29824, 30182, 30538,
+   30893, 31248, 31600, 31952, 32303, 32652, 33000, 33347,
+   33692, 34037, 34380, 34721, 35062, 35401, 35738, 36075,
+   36410, 36744, 37076, 37407, 37736, 38064, 38391, 38716,
+   39040, 39362, 39683, 40002, 40320, 40636, 40951, 41264,
+   41576, 41886, 42194, 42501, 42806, 43110, 43412, 43713,
+   44011, 44308, 44604, 44898, 45190, 45480, 45769, 46056,
+   46341, 46624, 46906, 47186, 47464, 47741, 48015, 48288,
+   48559, 48828, 49095, 49361, 49624, 49886, 50146, 50404,
+   50660, 50914, 51166, 51417, 51665, 51911, 52156, 52398,
+   52639, 52878, 53114, 53349, 53581, 53812, 54040, 54267,
+   54491, 54714, 54934, 55152, 55368, 55582, 55794, 56004,
+   56212, 56418, 56621, 56823, 57022, 57219, 57414, 57607,
+   57798, 57986, 58172, 58356, 58538, 58718, 58896, 59071,
+   59244, 59415, 59583, 59750, 59914, 60075, 60235, 60392,
+   60547, 60700, 60851, 60999, 61145, 61288, 61429, 61568,
+   61705, 61839, 61971, 62101, 62228, 62353, 62476, 62596,
+   62714, 62830, 62943, 63054, 63162, 63268, 63372, 63473,
+   63572, 63668, 63763, 63854, 63944, 64031, 64115, 64197,
+   64277, 64354, 64429, 64501, 64571, 64639, 64704, 64766,
+   64827, 64884, 64940, 64993, 65043, 65091, 65137, 65180,
+   65220, 65259, 65294, 65328, 65358, 65387, 65413, 65436,
+   65457, 65476, 65492, 65505, 65516, 65525, 65531, 65535,
+   65536
+};
+
+const int64_t INVERSE_TWO_PI_Q32 = 683565276; ///< 2^32 / (2 * pi)
+const int32_t PI_RAW = 205887; ///< pi in Q16.16
+const int32_t HALF_PI_RAW = 102944; ///< pi / 2 in Q16.16
+
+/**
+ * Looks up the sine of a phase given in 1/65536ths of a full turn.
+ */
+int32_t sineOfPhase(uint32_t phase)
+{
+   phase &= 0xFFFF;
+   uint32_t quadrant = phase >> 14;
+   uint32_t offset = phase & 0x3FFF;
+   //The second and fourth quadrants mirror the table.
+   if (quadrant & 1) offset = 0x4000 - offset;
+
+   uint32_t index = offset >> 6;
+   int32_t fraction = offset & 63;
+   int32_t value = SINE_TABLE[index];
+   if (index < 256)
+      value += ((SINE_TABLE[index + 1] - value) * fraction) >> 6;
+
+   //The bottom half of the wave is negative.
+   return quadrant & 2 ? -value : value;
+}
+
+/**
+ * Converts an angle in radians into a phase in 1/65536ths of a full turn.
+ */
+uint32_t toPhase(Fixed theta)
+{
+   return (uint32_t)(((int64_t)theta.getRaw() * INVERSE_TWO_PI_Q32) >> 32);
+}
+
+}
+
+Fixed sin(Fixed theta)
+{
+   return Fixed::fromRaw(sineOfPhase(toPhase(theta)));
+}
+
+Fixed cos(Fixed theta)
+{
+   //A quarter turn ahead of sine.
+   return Fixed::fromRaw(sineOfPhase(toPhase(theta) + 0x4000));
+}
+
+Fixed atan2(Fixed y, Fixed x)
+{
+   if (x == 0 && y == 0) return Fixed();
+
+   //Reduce to the first octant, where atan(z) has z in [0, 1].
+   Fixed absX = abs(x);
+   Fixed absY = abs(y);
+   bool swapped = absY > absX;
+   Fixed z = swapped ? absX / absY : absY / absX;
+
+   //Minimax polynomial, accurate to about 1e-5 radians.
+   Fixed z2 = z * z;
+   Fixed angle = Fixed::fromRaw(1365);
+   angle = angle * z2 + Fixed::fromRaw(-5579);
+   angle = angle * z2 + Fixed::fromRaw(11806);
+   angle = angle * z2 + Fixed::fromRaw(-21647);
+   angle = angle * z2 + Fixed::fromRaw(65527);
+   angle = angle * z;
+
+   if (swapped) angle = Fixed::fromRaw(HALF_PI_RAW) - angle;
+   if (x < 0) angle = Fixed::fromRaw(PI_RAW) - angle;
+   if (y < 0) angle = -angle;
+   return angle;
+}
+
+Fixed sqrt(Fixed value)
+{
+   if (value <= 0) return Fixed();
+
+   //The root of the value scaled by another 2^16. The double root is only a
+   //guess, within 1 of the exact one, and the integer checks round it down the
+   //same way on every platform.
+   uint64_t square = (uint64_t)value.getRaw() << Fixed::FRACTION_BITS;
+   uint64_t root = (uint64_t)std::sqrt((double)square);
+   if (root * root > square) root--;
+   else if ((root + 1) * (root + 1) <= square) root++;
+   return Fixed::fromRaw((int32_t)root);
+}
+
+}
@@ -0,0 +1,253 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_FIXED_HPP_
+#define FZX_FIXED_HPP_
+
+#include <cstdint>
+#include <limits>
+
+#include "Vec2.hpp"
+#include "Mat22.hpp"
+
+namespace fzx
+{
+
+/**
+ * A class that represents a real number in Q16.16 fixed-point format.
+ *
+ * Every result is computed, or at least rounded, with integer arithmetic, so
+ * the results are bit-identical on every platform and compiler. It can be
+ * used as the template parameter of Vec2 and Mat22 to build a deterministic
+ * math layer.
+ *
+ * Only that math layer is deterministic. RigidBody, Shape, Transform, World
+ * and Collision are not templated and still simulate in float, so a World
+ * can't be stepped in Fixed yet.
+ */
+class Fixed
+{
+private:
+   int32_t mRaw; ///< The raw value, scaled by 2^16.
+public:
+   static const int FRACTION_BITS = 16; ///< The number of fractional bits.
+   static const int32_t ONE = 1 << FRACTION_BITS; ///< The raw value of 1.
+
+   /**
+    * Creates a Fixed with a value of 0.
+    */
+   Fixed() : mRaw(0) {}
+
+   /**
+    * Creates a Fixed from an integer.
+    *
+    * Integers above 32767 saturate to the largest Fixed, and integers below
+    * -32768 to the smallest, like division does.
+    *
+    * @param value The integer value of the Fixed.
+    */
+   Fixed(int value) :
+      mRaw(value > 32767 ? std::numeric_limits<int32_t>::max() :
+           value < -32768 ? std::numeric_limits<int32_t>::min() : value * ONE) {}
+
+   /**
+    * Creates a Fixed from a float.
+    *
+    * The conversion rounds to the nearest representable value. Values out of
+    * range saturate like division does, and NaN becomes 0. It is explicit so
+    * that floats don't silently leak into a deterministic computation.
+    *
+    * @param value The float value of the Fixed.
+    */
+   explicit Fixed(float value) : mRaw(0)
+   {
+      //2^31 is exact in float, so the comparisons don't round.
+      float scaled = value * ONE + (value < 0 ? -.5f : .5f);
+      if (scaled >= 2147483648.0f) mRaw = std::numeric_limits<int32_t>::max();
+      else if (scaled <= -2147483648.0f) mRaw = std::numeric_limits<int32_t>::min();
+      else if (scaled == scaled) mRaw = (int32_t)scaled;
+   }
+
+   /**
+    * Creates a Fixed from its raw representation.
+    *
+    * @param  raw The value scaled by 2^16.
+    * @return A Fixed with the given raw representation.
+    */
+   static Fixed fromRaw(int32_t raw)
+   {
+      Fixed output;
+      output.mRaw = raw;
+      return output;
+   }
+
+   /**
+    * Returns the raw representation of this Fixed.
+    *
+    * @return The value scaled by 2^16.
+    */
+   int32_t getRaw() const
+   {
+      return mRaw;
+   }
+
+   /**
+    * Converts this Fixed to a float.
+    *
+    * Meant for rendering and debugging only, the simulation should stay in
+    * fixed-point.
+    *
+    * @return The closest float to this value.
+    */
+   float toFloat() const
+   {
+      return (float)mRaw / ONE;
+   }
+
+   Fixed operator-() const
+   {
+      return fromRaw(-mRaw);
+   }
+
+   Fixed operator+(Fixed other) const
+   {
+      return fromRaw(mRaw + other.mRaw);
+   }
+
+   Fixed operator-(Fixed other) const
+   {
+      return fromRaw(mRaw - other.mRaw);
+   }
+
+   Fixed operator*(Fixed other) const
+   {
+      return fromRaw((int32_t)(((int64_t)mRaw * other.mRaw) >> FRACTION_BITS));
+   }
+
+   /**
+    * Divides this Fixed by another.
+    *
+    * Quotients out of range saturate instead of wrapping, and so does a
+    * division by 0, towards the sign of this Fixed. 0 / 0 is 0.
+    *
+    * @param  other The divisor.
+    * @return The quotient, rounded towards 0.
+    */
+   Fixed operator/(Fixed other) const
+   {
+      const int32_t max = std::numeric_limits<int32_t>::max();
+      const int32_t min = std::numeric_limits<int32_t>::min();
+      if (other.mRaw == 0) return fromRaw(mRaw > 0 ? max : mRaw < 0 ? min : 0);
+      int64_t quotient = (int64_t)mRaw * ONE / other.mRaw;
+      if (quotient > max) return fromRaw(max);
+      if (quotient < min) return fromRaw(min);
+      return fromRaw((int32_t)quotient);
+   }
+
+   Fixed& operator+=(Fixed other)
+   {
+      mRaw += other.mRaw;
+      return *this;
+   }
+
+   Fixed& operator-=(Fixed other)
+   {
+      mRaw -= other.mRaw;
+      return *this;
+   }
+
+   Fixed& operator*=(Fixed other)
+   {
+      return *this = *this * other;
+   }
+
+   Fixed& operator/=(Fixed other)
+   {
+      return *this = *this / other;
+   }
+
+   bool operator==(Fixed other) const { return mRaw == other.mRaw; }
+   bool operator!=(Fixed other) const { return mRaw != other.mRaw; }
+   bool operator<(Fixed other) const { return mRaw < other.mRaw; }
+   bool operator>(Fixed other) const { return mRaw > other.mRaw; }
+   bool operator<=(Fixed other) const { return mRaw <= other.mRaw; }
+   bool operator>=(Fixed other) const { return mRaw >= other.mRaw; }
+};
+
+/**
+ * Calculates the sine of a Fixed angle.
+ *
+ * Uses a quarter-wave lookup table with linear interpolation instead of libm.
+ *
+ * @param  theta The angle in radians.
+ * @return The sine of the angle.
+ */
+Fixed sin(Fixed theta);
+
+/**
+ * Calculates the cosine of a Fixed angle.
+ *
+ * Uses a quarter-wave lookup table with linear interpolation instead of libm.
+ *
+ * @param  theta The angle in radians.
+ * @return The cosine of the angle.
+ */
+Fixed cos(Fixed theta);
+
+/**
+ * Calculates the angle of the point (x, y) from the positive x-axis.
+ *
+ * @param  y The y-coordinate of the point.
+ * @param  x The x-coordinate of the point.
+ * @return The angle in radians, in the range [-pi, pi].
+ */
+Fixed atan2(Fixed y, Fixed x);
+
+/**
+ * Calculates the square root of a Fixed.
+ *
+ * @param  value The value to take the square root of. Negative values
+ * return 0.
+ * @return The square root, rounded down.
+ */
+Fixed sqrt(Fixed value);
+
+/**
+ * Calculates the absolute value of a Fixed.
+ *
+ * @param  value The Fixed to take the absolute value of.
+ * @return The absolute value.
+ */
+inline Fixed abs(Fixed value)
+{
+   return value < 0 ? -value : value;
+}
+
+typedef Vec2<Fixed> Vec2x;
+typedef Mat22<Fixed> Mat22x;
+
+}
+
+#endif /*FZX_FIXED_HPP_*/
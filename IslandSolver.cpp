@@ -0,0 +1,389 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "IslandSolver.hpp"
+#include "Settings.hpp"
+#include "Trace.hpp"
+#include "World.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace fzx
+{
+
+namespace
+{
+
+const unsigned NO_ISLAND = ~0u; ///< Marks bodies, roots and Collisions without an island.
+
+}
+
+IslandSolver::IslandSolver() :
+   mStats(), mImpulseTolerance(0.001f), mPenetrationTolerance(0.01f), mPositionSolver(BAUMGARTE) {}
+
+unsigned IslandSolver::findRoot(unsigned body)
+{
+   while (mParents[body] != body)
+   {
+      mParents[body] = mParents[mParents[body]];
+      body = mParents[body];
+   }
+   return body;
+}
+
+void IslandSolver::buildIslands(World& world)
+{
+   unsigned numberOfBodies = world.mBodies.size();
+   mParents.resize(numberOfBodies);
+   for (unsigned i = 0; i < numberOfBodies; i++)
+   {
+      world.mBodies[i]->mIndex = i;
+      mParents[i] = i;
+   }
+
+   //Only DYNAMIC bodies link islands, anything else just takes the impulses.
+   for (const Collision& collision : world.mCollisions)
+   {
+      if (collision.mBodyA->getType() != RigidBody::DYNAMIC) continue;
+      if (collision.mBodyB->getType() != RigidBody::DYNAMIC) continue;
+      unsigned rootA = findRoot(collision.mBodyA->mIndex);
+      unsigned rootB = findRoot(collision.mBodyB->mIndex);
+      if (rootA != rootB) mParents[rootA] = rootB;
+   }
+
+   //Number the islands and count their Collisions.
+   mIslands.clear();
+   mIslandOfRoot.assign(numberOfBodies, NO_ISLAND);
+   mCollisionIslands.resize(world.mCollisions.size());
+   for (unsigned i = 0; i < world.mCollisions.size(); i++)
+   {
+      const Collision& collision = world.mCollisions[i];
+      RigidBody* body = collision.mBodyA->getType() == RigidBody::DYNAMIC ? collision.mBodyA : collision.mBodyB;
+      mCollisionIslands[i] = NO_ISLAND;
+      if (body->getType() != RigidBody::DYNAMIC) continue;
+
+      unsigned root = findRoot(body->mIndex);
+      if (mIslandOfRoot[root] == NO_ISLAND)
+      {
+         mIslandOfRoot[root] = mIslands.size();
+         mIslands.push_back(Island());
+      }
+      mCollisionIslands[i] = mIslandOfRoot[root];
+      mIslands[mIslandOfRoot[root]].numberOfCollisions++;
+   }
+
+   mBodySlots.assign(numberOfBodies, NO_ISLAND);
+   for (unsigned i = 0; i < numberOfBodies; i++)
+   {
+      if (world.mBodies[i]->getType() != RigidBody::DYNAMIC) continue;
+      unsigned island = mIslandOfRoot[findRoot(i)];
+      if (island == NO_ISLAND) continue;
+      mBodySlots[i] = island;
+      mIslands[island].numberOfBodies++;
+   }
+
+   //Counting sort the Collisions and bodies by island.
+   unsigned collisions = 0, bodies = 0;
+   for (Island& island : mIslands)
+   {
+      island.firstCollision = collisions;
+      island.firstBody = bodies;
+      collisions += island.numberOfCollisions;
+      bodies += island.numberOfBodies;
+      island.numberOfCollisions = island.numberOfBodies = 0;
+   }
+
+   mCollisionOrder.resize(collisions);
+   for (unsigned i = 0; i < mCollisionIslands.size(); i++)
+   {
+      if (mCollisionIslands[i] == NO_ISLAND) continue;
+      Island& island = mIslands[mCollisionIslands[i]];
+      mCollisionOrder[island.firstCollision + island.numberOfCollisions++] = i;
+   }
+
+   mBodies.resize(bodies);
+   for (unsigned i = 0; i < numberOfBodies; i++)
+   {
+      if (mBodySlots[i] == NO_ISLAND) continue;
+      Island& island = mIslands[mBodySlots[i]];
+      mBodySlots[i] = island.firstBody + island.numberOfBodies++;
+      mBodies[mBodySlots[i]].body = world.mBodies[i].get();
+   }
+}
+
+void IslandSolver::solveVelocities(World& world, Island& island)
+{
+   Body* begin = mBodies.data() + island.firstBody;
+   Body* end = begin + island.numberOfBodies;
+   for (unsigned iteration = 0; iteration < world.mVelocityIterations; iteration++)
+   {
+      for (Body* body = begin; body != end; body++)
+      {
+         body->velocity = body->body->getPush(RigidBody::VELOCITY);
+         body->angularVelocity = body->body->getTwist(RigidBody::VELOCITY);
+      }
+      for (unsigned i = 0; i < island.numberOfCollisions; i++)
+         world.mCollisions[mCollisionOrder[island.firstCollision + i]].applyImpulse();
+      island.velocityIterations++;
+
+      //The change in velocity is the impulse per mass. The spin is counted at
+      //the rim, so it is in the same units.
+      island.impulseDelta = 0;
+      for (Body* body = begin; body != end; body++)
+      {
+         Vec2f linear = body->body->getPush(RigidBody::VELOCITY) - body->velocity;
+         float angular = body->body->getTwist(RigidBody::VELOCITY) - body->angularVelocity;
+         float delta = std::sqrt(linear * linear) + std::abs(angular) * body->body->getShape().getRadius();
+         island.impulseDelta = std::max(island.impulseDelta, delta);
+      }
+      if (island.impulseDelta < mImpulseTolerance) break;
+   }
+}
+
+float IslandSolver::getPenetration(World& world, const Island& island)
+{
+   float deepest = 0;
+   for (unsigned i = 0; i < island.numberOfCollisions; i++)
+   {
+      const Collision& collision = world.mCollisions[mCollisionOrder[island.firstCollision + i]];
+      const Body* bodyA = nullptr;
+      const Body* bodyB = nullptr;
+      unsigned slotA = mBodySlots[collision.mBodyA->mIndex];
+      unsigned slotB = mBodySlots[collision.mBodyB->mIndex];
+      if (slotA != NO_ISLAND) bodyA = &mBodies[slotA];
+      if (slotB != NO_ISLAND) bodyB = &mBodies[slotB];
+
+      for (unsigned j = 0; j < collision.getNumberOfContacts(); j++)
+      {
+         const Collision::ContactData& contact = collision.getContactData(j);
+
+         //How far each body's point of the contact moved since the narrow
+         //phase. Bodies outside the island weren't moved.
+         Vec2f moved[2];
+         const Body* bodies[2] = {bodyA, bodyB};
+         const Vec2f* levers[2] = {&contact.leverA, &contact.leverB};
+         for (unsigned k = 0; k < 2; k++)
+         {
+            if (!bodies[k]) continue;
+            const Transform& transform = bodies[k]->body->getTransform();
+            const Mat22f& rotation = bodies[k]->rotation;
+            Vec2f local(*levers[k] * rotation.getLeftColumn(), *levers[k] * rotation.getRightColumn());
+            moved[k] = transform.apply(local) - (bodies[k]->translation + *levers[k]);
+         }
+         //Moving B away from A along the normal takes away penetration.
+         float separation = (moved[1] - moved[0]) * contact.normal;
+         deepest = std::max(deepest, contact.penetration - separation - PENETRATION_SLOP);
+      }
+   }
+   return deepest;
+}
+
+void IslandSolver::solvePositions(World& world, Island& island)
+{
+   Body* begin = mBodies.data() + island.firstBody;
+   Body* end = begin + island.numberOfBodies;
+   for (Body* body = begin; body != end; body++)
+   {
+      body->translation = body->body->getTransform().getTranslation();
+      body->rotation = body->body->getTransform().getRotationMatrix();
+   }
+
+   island.penetration = getPenetration(world, island);
+   while (island.positionIterations < world.mPositionIterations && island.penetration >= mPenetrationTolerance)
+   {
+      for (unsigned i = 0; i < island.numberOfCollisions; i++)
+         world.mCollisions[mCollisionOrder[island.firstCollision + i]].correctPenetration();
+      island.positionIterations++;
+      island.penetration = getPenetration(world, island);
+   }
+}
+
+void IslandSolver::solvePositionsNonlinear(World& world, Island& island)
+{
+   //Anchor every contact to both bodies, so its separation can be found again
+   //after the bodies move.
+   mContacts.clear();
+   for (unsigned i = 0; i < island.numberOfCollisions; i++)
+   {
+      const Collision& collision = world.mCollisions[mCollisionOrder[island.firstCollision + i]];
+      RigidBody& bodyA = *collision.mBodyA;
+      RigidBody& bodyB = *collision.mBodyB;
+      const Mat22f& rotationA = bodyA.getTransform().getRotationMatrix();
+      const Mat22f& rotationB = bodyB.getTransform().getRotationMatrix();
+      for (unsigned j = 0; j < collision.getNumberOfContacts(); j++)
+      {
+         const Collision::ContactData& data = collision.getContactData(j);
+         Contact contact;
+         contact.bodyA = &bodyA;
+         contact.bodyB = &bodyB;
+         contact.localA = Vec2f(data.leverA * rotationA.getLeftColumn(), data.leverA * rotationA.getRightColumn());
+         contact.localB = Vec2f(data.leverB * rotationB.getLeftColumn(), data.leverB * rotationB.getRightColumn());
+
+         const Vec2f& normal = data.normal;
+         contact.localNormal = Vec2f(normal * rotationA.getLeftColumn(), normal * rotationA.getRightColumn());
+         contact.penetration = data.penetration;
+
+         bool isDynamicA = bodyA.getType() == RigidBody::DYNAMIC;
+         bool isDynamicB = bodyB.getType() == RigidBody::DYNAMIC;
+         contact.inverseMassA = isDynamicA ? bodyA.getMassData().inverseMass : 0;
+         contact.inverseInertiaA = isDynamicA ? bodyA.getMassData().inverseInertia : 0;
+         contact.inverseMassB = isDynamicB ? bodyB.getMassData().inverseMass : 0;
+         contact.inverseInertiaB = isDynamicB ? bodyB.getMassData().inverseInertia : 0;
+         mContacts.push_back(contact);
+      }
+   }
+
+   //Each contact sees where the corrections before it left the bodies. The
+   //depth is measured on the way, so an island stops after the first pass
+   //that found nothing left to correct.
+   island.penetration = 0;
+   for (const Contact& contact : mContacts)
+      island.penetration = std::max(island.penetration, contact.penetration - PENETRATION_SLOP);
+   while (island.positionIterations < world.mPositionIterations)
+   {
+      float deepest = 0;
+      for (const Contact& contact : mContacts)
+      {
+         Transform& transformA = contact.bodyA->getTransform();
+         Transform& transformB = contact.bodyB->getTransform();
+         Vec2f leverA = transformA.getRotationMatrix() * contact.localA;
+         Vec2f leverB = transformB.getRotationMatrix() * contact.localB;
+         Vec2f normal = transformA.getRotationMatrix() * contact.localNormal;
+         Vec2f offset = transformB.getTranslation() + leverB - (transformA.getTranslation() + leverA);
+         float separation = offset * normal - contact.penetration;
+         deepest = std::max(deepest, -separation - PENETRATION_SLOP);
+
+         //Only the penetration beyond the slop is corrected, a fraction at a
+         //time, so resting contacts stay in contact.
+         float correction = std::min(POSITION_CORRECTION_PERCENTAGE * (separation + PENETRATION_SLOP), 0.0f);
+         correction = std::max(correction, -MAXIMUM_POSITION_CORRECTION);
+         float leverNormalA = leverA % normal;
+         float leverNormalB = leverB % normal;
+         float mass = contact.inverseMassA + contact.inverseMassB
+                      + contact.inverseInertiaA * leverNormalA * leverNormalA
+                      + contact.inverseInertiaB * leverNormalB * leverNormalB;
+         if (correction == 0 || mass <= 0) continue;
+
+         Vec2f push = normal * (-correction / mass);
+         transformA.translate(push * -contact.inverseMassA);
+         transformA.rotate(-contact.inverseInertiaA * (leverA % push));
+         transformB.translate(push * contact.inverseMassB);
+         transformB.rotate(contact.inverseInertiaB * (leverB % push));
+      }
+      island.positionIterations++;
+      island.penetration = deepest;
+      if (deepest < mPenetrationTolerance) break;
+   }
+}
+
+void IslandSolver::solve(World& world)
+{
+   buildIslands(world);
+
+   mStats = Stats();
+   mStats.islands = mIslands.size();
+   //Islands share no bodies, so every island's velocities can be solved
+   //before any positions are corrected, timing each phase once.
+   {
+      FZX_PROFILE_PHASE(world.getProfiler(), VELOCITY_ITERATIONS);
+      FZX_TRACE_SPAN("Velocity iterations");
+      for (Island& island : mIslands) solveVelocities(world, island);
+   }
+   {
+      FZX_PROFILE_PHASE(world.getProfiler(), POSITION_CORRECTION);
+      FZX_TRACE_SPAN("Position correction");
+      //The contacts are charged to the World, so they are freed before the
+      //World could be destroyed.
+      mContacts = std::vector<Contact, ContactAllocator>(ContactAllocator(&world.mMemory));
+      for (Island& island : mIslands)
+      {
+         if (mPositionSolver == NONLINEAR_GAUSS_SEIDEL) solvePositionsNonlinear(world, island);
+         else solvePositions(world, island);
+      }
+      mContacts = std::vector<Contact, ContactAllocator>();
+   }
+
+   for (const Island& island : mIslands)
+   {
+      for (unsigned i = 0; i < island.numberOfCollisions; i++)
+         mStats.contacts += world.mCollisions[mCollisionOrder[island.firstCollision + i]].getNumberOfContacts();
+      mStats.velocityIterations += island.velocityIterations;
+      mStats.positionIterations += island.positionIterations;
+      mStats.maximumVelocityIterations = std::max(mStats.maximumVelocityIterations, island.velocityIterations);
+      mStats.maximumPositionIterations = std::max(mStats.maximumPositionIterations, island.positionIterations);
+      mStats.impulseDelta = std::max(mStats.impulseDelta, island.impulseDelta);
+      mStats.penetration = std::max(mStats.penetration, island.penetration);
+   }
+   FZX_TRACE_COUNTER("Islands", mStats.islands);
+   FZX_TRACE_COUNTER("Contacts", mStats.contacts);
+}
+
+const IslandSolver::Stats& IslandSolver::getStats() const
+{
+   return mStats;
+}
+
+unsigned IslandSolver::getNumberOfIslands() const
+{
+   return mIslands.size();
+}
+
+const IslandSolver::Island& IslandSolver::getIsland(unsigned i) const
+{
+   return mIslands[i];
+}
+
+float IslandSolver::getImpulseTolerance() const
+{
+   return mImpulseTolerance;
+}
+
+float IslandSolver::getPenetrationTolerance() const
+{
+   return mPenetrationTolerance;
+}
+
+IslandSolver::PositionSolver IslandSolver::getPositionSolver() const
+{
+   return mPositionSolver;
+}
+
+void IslandSolver::setPositionSolver(PositionSolver solver)
+{
+   mPositionSolver = solver;
+}
+
+void IslandSolver::setImpulseTolerance(float tolerance)
+{
+   mImpulseTolerance = tolerance;
+}
+
+void IslandSolver::setPenetrationTolerance(float tolerance)
+{
+   mPenetrationTolerance = tolerance;
+}
+
+}
@@ -0,0 +1,271 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_ISLAND_SOLVER_HPP_
+#define FZX_ISLAND_SOLVER_HPP_
+
+#include <vector>
+
+#include "Mat22.hpp"
+#include "Memory.hpp"
+#include "Vec2.hpp"
+
+namespace fzx
+{
+
+class World;
+class RigidBody;
+
+/**
+ * Solves the Collisions of a World island by island, stopping each island's
+ * iterations once it has converged.
+ *
+ * An island is a set of DYNAMIC bodies linked by Collisions, together with
+ * those Collisions. STATIC and KINEMATIC bodies don't link islands, so a box
+ * resting on the ground doesn't wait for a pile elsewhere on it.
+ *
+ * The World's velocity and position iteration counts act as maximums. After
+ * each velocity iteration the largest impulse a body received is measured,
+ * divided by the body's mass so light and heavy islands share one tolerance,
+ * and the island stops once it is below the impulse tolerance. After each
+ * position iteration the deepest penetration left is estimated from how far
+ * the bodies moved since the narrow phase, and the island stops once it is
+ * below the penetration tolerance. Only penetration beyond PENETRATION_SLOP
+ * counts, since resting contacts are left at about the slop on purpose.
+ *
+ * Penetrations are corrected by one of two position solvers. BAUMGARTE runs
+ * Collision::correctPenetration(), which pushes the bodies apart by a fixed
+ * fraction of the penetration found by the narrow phase. NONLINEAR_GAUSS_SEIDEL
+ * recomputes the separation of every contact from the bodies' current
+ * transforms before correcting it, and moves the positions and rotations
+ * directly. It never touches the velocities, so correcting a penetration adds
+ * no energy, and each correction sees where the ones before it left the
+ * bodies instead of the depth the narrow phase found.
+ */
+class IslandSolver
+{
+public:
+   /**
+    * The ways penetrations can be corrected.
+    */
+   enum PositionSolver
+   {
+      BAUMGARTE, NONLINEAR_GAUSS_SEIDEL
+   };
+
+   /**
+    * What the solver did to one island.
+    */
+   struct Island
+   {
+      unsigned firstCollision; ///< The position of the island's first Collision in the solve order.
+      unsigned numberOfCollisions; ///< The number of Collisions in the island.
+      unsigned firstBody; ///< The position of the island's first body in the solve order.
+      unsigned numberOfBodies; ///< The number of DYNAMIC bodies in the island.
+      unsigned velocityIterations; ///< The velocity iterations used.
+      unsigned positionIterations; ///< The position iterations used.
+      float impulseDelta; ///< The largest impulse per mass of the last velocity iteration, in m/s.
+      float penetration; ///< The deepest penetration beyond PENETRATION_SLOP left after the last position iteration.
+   };
+
+   /**
+    * What the solver did in one step, over every island.
+    */
+   struct Stats
+   {
+      unsigned islands; ///< The number of islands solved.
+      unsigned contacts; ///< The contacts of the Collisions in the islands.
+      unsigned velocityIterations; ///< The velocity iterations used, summed over the islands.
+      unsigned positionIterations; ///< The position iterations used, summed over the islands.
+      unsigned maximumVelocityIterations; ///< The most velocity iterations any island used.
+      unsigned maximumPositionIterations; ///< The most position iterations any island used.
+      float impulseDelta; ///< The largest final impulse delta of any island.
+      float penetration; ///< The deepest final penetration beyond PENETRATION_SLOP of any island.
+   };
+private:
+   /**
+    * A body of an island, with its state before the current iteration.
+    */
+   struct Body
+   {
+      RigidBody* body; ///< The body.
+      Vec2f velocity; ///< The velocity before the iteration.
+      float angularVelocity; ///< The angular velocity before the iteration.
+      Vec2f translation; ///< The translation before the position iterations.
+      Mat22f rotation; ///< The rotation before the position iterations.
+   };
+
+   std::vector<unsigned> mParents; ///< The union-find parent of each body of the World.
+   std::vector<unsigned> mCollisionOrder; ///< The indices of the Collisions, grouped by island.
+   std::vector<unsigned> mCollisionIslands; ///< The island of each Collision of the World, or NO_ISLAND.
+   std::vector<unsigned> mIslandOfRoot; ///< The island of each union-find root, or NO_ISLAND.
+   std::vector<unsigned> mBodySlots; ///< The position of each body of the World in mBodies, or NO_ISLAND.
+   std::vector<Body> mBodies; ///< The DYNAMIC bodies, grouped by island.
+   std::vector<Island> mIslands; ///< The islands of the last solve.
+   /**
+    * A contact of the position iterations of NONLINEAR_GAUSS_SEIDEL.
+    */
+   struct Contact
+   {
+      RigidBody* bodyA; ///< The first body.
+      RigidBody* bodyB; ///< The second body.
+      Vec2f localA; ///< The contact in the first body's space.
+      Vec2f localB; ///< The contact in the second body's space.
+      Vec2f localNormal; ///< The normal from the first body to the second, in the first body's space.
+      float penetration; ///< The penetration found by the narrow phase.
+      float inverseMassA; ///< The inverse mass of the first body, 0 unless it is DYNAMIC.
+      float inverseInertiaA; ///< The inverse inertia of the first body, 0 unless it is DYNAMIC.
+      float inverseMassB; ///< The inverse mass of the second body, 0 unless it is DYNAMIC.
+      float inverseInertiaB; ///< The inverse inertia of the second body, 0 unless it is DYNAMIC.
+   };
+
+   typedef TrackingAllocator<Contact, Memory::CONTACTS> ContactAllocator;
+
+   std::vector<Contact, ContactAllocator> mContacts; ///< The contacts of the island being corrected, charged to its World.
+   Stats mStats; ///< What the last solve did.
+   float mImpulseTolerance; ///< The impulse delta per mass an island stops at.
+   float mPenetrationTolerance; ///< The penetration an island stops at.
+   PositionSolver mPositionSolver; ///< How penetrations are corrected.
+
+   /**
+    * Returns the root of a body's island, flattening the path on the way.
+    */
+   unsigned findRoot(unsigned body);
+
+   /**
+    * Splits the Collisions and bodies of the World into islands.
+    */
+   void buildIslands(World& world);
+
+   /**
+    * Runs the velocity iterations of an island until it converges.
+    */
+   void solveVelocities(World& world, Island& island);
+
+   /**
+    * Runs the position iterations of an island until it converges.
+    */
+   void solvePositions(World& world, Island& island);
+
+   /**
+    * Runs the position iterations of an island with nonlinear Gauss-Seidel
+    * until it converges.
+    */
+   void solvePositionsNonlinear(World& world, Island& island);
+
+   /**
+    * Estimates the deepest penetration beyond PENETRATION_SLOP left in an
+    * island from how far its bodies moved since the position iterations
+    * started.
+    */
+   float getPenetration(World& world, const Island& island);
+public:
+   /**
+    * Creates an IslandSolver with an impulse tolerance of 0.001 m/s, a
+    * penetration tolerance of 0.01 and the BAUMGARTE position solver.
+    */
+   IslandSolver();
+
+   /**
+    * Applies the impulses and corrects the penetrations of the Collisions of
+    * the World's current step.
+    *
+    * Call it from World::step() after the narrow phase, in place of running
+    * every Collision a fixed number of times.
+    *
+    * @param world The World being stepped.
+    */
+   void solve(World& world);
+
+   /**
+    * Returns what the last solve did over every island.
+    *
+    * @return A constant reference to the Stats.
+    */
+   const Stats& getStats() const;
+
+   /**
+    * Returns the number of islands of the last solve.
+    *
+    * @return The number of islands.
+    */
+   unsigned getNumberOfIslands() const;
+
+   /**
+    * Returns what the last solve did to an island.
+    *
+    * @param  i The index of the island.
+    * @return A constant reference to the Island.
+    */
+   const Island& getIsland(unsigned i) const;
+
+   /**
+    * Returns the impulse delta per mass an island stops at.
+    *
+    * @return The impulse tolerance in m/s.
+    */
+   float getImpulseTolerance() const;
+
+   /**
+    * Returns the penetration beyond PENETRATION_SLOP an island stops at.
+    *
+    * @return The penetration tolerance.
+    */
+   float getPenetrationTolerance() const;
+
+   /**
+    * Returns how penetrations are corrected.
+    *
+    * @return The PositionSolver.
+    */
+   PositionSolver getPositionSolver() const;
+
+   /**
+    * Sets how penetrations are corrected.
+    *
+    * @param solver The new PositionSolver.
+    */
+   void setPositionSolver(PositionSolver solver);
+
+   /**
+    * Sets the impulse delta per mass an island stops at. 0 runs every
+    * velocity iteration.
+    *
+    * @param tolerance The new impulse tolerance in m/s.
+    */
+   void setImpulseTolerance(float tolerance);
+
+   /**
+    * Sets the penetration beyond PENETRATION_SLOP an island stops at. 0 runs
+    * every position iteration.
+    *
+    * @param tolerance The new penetration tolerance.
+    */
+   void setPenetrationTolerance(float tolerance);
+};
+
+}
+
+#endif /*FZX_ISLAND_SOLVER_HPP_*/
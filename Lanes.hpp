@@ -0,0 +1,223 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_LANES_HPP_
+#define FZX_LANES_HPP_
+
+#include <cmath>
+
+namespace fzx
+{
+
+/**
+ * A fixed number of floats that are operated on together, one per lane.
+ *
+ * Every operator is a plain loop over the lanes, which compilers turn into
+ * SIMD instructions at -O2 or higher. It can be used as the component type of
+ * Vec2, so Vec2<Lanes<8>> holds 8 vectors as a structure of arrays.
+ *
+ * Comparisons return masks with 1 in the lanes where they hold and 0
+ * elsewhere, which can be multiplied with values or passed to select().
+ */
+template <unsigned N>
+struct Lanes
+{
+   static_assert(N > 0 && N <= 16 && (N & (N - 1)) == 0,
+                 "The number of lanes must be a power of two up to 16");
+
+   alignas(N * sizeof(float)) float v[N]; ///< The value of each lane.
+
+   /**
+    * Creates Lanes with uninitialized values.
+    */
+   Lanes() {}
+
+   /**
+    * Creates Lanes with the same value in every lane.
+    *
+    * @param s The value of every lane.
+    */
+   Lanes(float s)
+   {
+      for (unsigned i = 0; i < N; i++) v[i] = s;
+   }
+
+   float& operator[](unsigned i)
+   {
+      return v[i];
+   }
+
+   float operator[](unsigned i) const
+   {
+      return v[i];
+   }
+
+   Lanes operator-() const
+   {
+      Lanes output;
+      for (unsigned i = 0; i < N; i++) output.v[i] = -v[i];
+      return output;
+   }
+
+   Lanes operator+(const Lanes& other) const
+   {
+      Lanes output;
+      for (unsigned i = 0; i < N; i++) output.v[i] = v[i] + other.v[i];
+      return output;
+   }
+
+   Lanes operator-(const Lanes& other) const
+   {
+      Lanes output;
+      for (unsigned i = 0; i < N; i++) output.v[i] = v[i] - other.v[i];
+      return output;
+   }
+
+   Lanes operator*(const Lanes& other) const
+   {
+      Lanes output;
+      for (unsigned i = 0; i < N; i++) output.v[i] = v[i] * other.v[i];
+      return output;
+   }
+
+   Lanes operator/(const Lanes& other) const
+   {
+      Lanes output;
+      for (unsigned i = 0; i < N; i++) output.v[i] = v[i] / other.v[i];
+      return output;
+   }
+
+   Lanes& operator+=(const Lanes& other)
+   {
+      for (unsigned i = 0; i < N; i++) v[i] += other.v[i];
+      return *this;
+   }
+
+   Lanes& operator-=(const Lanes& other)
+   {
+      for (unsigned i = 0; i < N; i++) v[i] -= other.v[i];
+      return *this;
+   }
+
+   Lanes& operator*=(const Lanes& other)
+   {
+      for (unsigned i = 0; i < N; i++) v[i] *= other.v[i];
+      return *this;
+   }
+
+   Lanes& operator/=(const Lanes& other)
+   {
+      for (unsigned i = 0; i < N; i++) v[i] /= other.v[i];
+      return *this;
+   }
+
+   Lanes operator<(const Lanes& other) const
+   {
+      Lanes output;
+      for (unsigned i = 0; i < N; i++) output.v[i] = v[i] < other.v[i] ? 1.0f : 0.0f;
+      return output;
+   }
+
+   Lanes operator>(const Lanes& other) const
+   {
+      return other < *this;
+   }
+};
+
+template <unsigned N>
+Lanes<N> operator+(float s, const Lanes<N>& lanes)
+{
+   return Lanes<N>(s) + lanes;
+}
+
+template <unsigned N>
+Lanes<N> operator-(float s, const Lanes<N>& lanes)
+{
+   return Lanes<N>(s) - lanes;
+}
+
+template <unsigned N>
+Lanes<N> operator*(float s, const Lanes<N>& lanes)
+{
+   return Lanes<N>(s) * lanes;
+}
+
+template <unsigned N>
+Lanes<N> sqrt(const Lanes<N>& lanes)
+{
+   Lanes<N> output;
+   for (unsigned i = 0; i < N; i++) output.v[i] = std::sqrt(lanes.v[i]);
+   return output;
+}
+
+template <unsigned N>
+Lanes<N> abs(const Lanes<N>& lanes)
+{
+   Lanes<N> output;
+   for (unsigned i = 0; i < N; i++) output.v[i] = std::fabs(lanes.v[i]);
+   return output;
+}
+
+template <unsigned N>
+Lanes<N> min(const Lanes<N>& a, const Lanes<N>& b)
+{
+   Lanes<N> output;
+   for (unsigned i = 0; i < N; i++) output.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i];
+   return output;
+}
+
+template <unsigned N>
+Lanes<N> max(const Lanes<N>& a, const Lanes<N>& b)
+{
+   Lanes<N> output;
+   for (unsigned i = 0; i < N; i++) output.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i];
+   return output;
+}
+
+/**
+ * Returns 1 in the lanes that are positive or zero and -1 elsewhere.
+ */
+template <unsigned N>
+Lanes<N> sign(const Lanes<N>& lanes)
+{
+   Lanes<N> output;
+   for (unsigned i = 0; i < N; i++) output.v[i] = lanes.v[i] < 0 ? -1.0f : 1.0f;
+   return output;
+}
+
+/**
+ * Picks, in each lane, a value where the mask is non-zero and b elsewhere.
+ */
+template <unsigned N>
+Lanes<N> select(const Lanes<N>& mask, const Lanes<N>& a, const Lanes<N>& b)
+{
+   Lanes<N> output;
+   for (unsigned i = 0; i < N; i++) output.v[i] = mask.v[i] != 0 ? a.v[i] : b.v[i];
+   return output;
+}
+
+}
+
+#endif /*FZX_LANES_HPP_*/
@@ -0,0 +1,402 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "LinearBvh.hpp"
+
+#include <algorithm>
+
+namespace fzx
+{
+
+namespace
+{
+
+const unsigned BLOCKS_PER_THREAD = 4; ///< Extra blocks balance threads that fall behind.
+const unsigned MINIMUM_BLOCK_SIZE = 512; ///< Fewer items than this aren't worth a block.
+const unsigned RADIX_BITS = 8; ///< The bits sorted by each radix pass.
+const unsigned RADIX = 1 << RADIX_BITS; ///< The number of digits of a radix pass.
+const unsigned STACK_SIZE = 128; ///< Twice the deepest a tree of 64-bit keys can be.
+
+/**
+ * Spreads the lower 16 bits of a number to its even bits.
+ */
+uint32_t spreadBits(uint32_t x)
+{
+   x &= 0xFFFF;
+   x = (x | (x << 8)) & 0x00FF00FF;
+   x = (x | (x << 4)) & 0x0F0F0F0F;
+   x = (x | (x << 2)) & 0x33333333;
+   x = (x | (x << 1)) & 0x55555555;
+   return x;
+}
+
+/**
+ * Returns the number of leading zero bits of a nonzero number.
+ */
+int countLeadingZeros(uint64_t x)
+{
+#if defined(__GNUC__)
+   return __builtin_clzll(x);
+#else
+   int count = 0;
+   for (uint64_t bit = uint64_t(1) << 63; !(x & bit); bit >>= 1) count++;
+   return count;
+#endif
+}
+
+bool overlaps(const Shape::BoundingBox& a, const Shape::BoundingBox& b)
+{
+   return a.lowerLeft.x <= b.upperRight.x && b.lowerLeft.x <= a.upperRight.x &&
+          a.lowerLeft.y <= b.upperRight.y && b.lowerLeft.y <= a.upperRight.y;
+}
+
+Shape::BoundingBox merge(const Shape::BoundingBox& a, const Shape::BoundingBox& b)
+{
+   Shape::BoundingBox box;
+   box.lowerLeft = Vec2f(std::min(a.lowerLeft.x, b.lowerLeft.x), std::min(a.lowerLeft.y, b.lowerLeft.y));
+   box.upperRight = Vec2f(std::max(a.upperRight.x, b.upperRight.x), std::max(a.upperRight.y, b.upperRight.y));
+   return box;
+}
+
+/**
+ * Finds the range of items of a block.
+ */
+void getBlockRange(unsigned block, unsigned numberOfBlocks, unsigned numberOfItems, unsigned& begin, unsigned& end)
+{
+   begin = (unsigned)((uint64_t)numberOfItems * block / numberOfBlocks);
+   end = (unsigned)((uint64_t)numberOfItems * (block + 1) / numberOfBlocks);
+}
+
+}
+
+LinearBvh::LinearBvh(unsigned numberOfThreads) :
+   mVisitsSize(0), mNumberOfItems(0), mPool(numberOfThreads, "LinearBvh worker")
+{
+}
+
+void LinearBvh::forEachBlock(unsigned numberOfBlocks, const char* name, const std::function<void(unsigned)>& task)
+{
+   mPool.forEach(numberOfBlocks, 1, name, task);
+}
+
+unsigned LinearBvh::getNumberOfBlocks(unsigned numberOfItems) const
+{
+   unsigned numberOfBlocks = getNumberOfThreads() * BLOCKS_PER_THREAD;
+   return std::max(1u, std::min(numberOfBlocks, numberOfItems / MINIMUM_BLOCK_SIZE));
+}
+
+void LinearBvh::build(const Shape::BoundingBox* boxes, unsigned numberOfBoxes)
+{
+   mNumberOfItems = numberOfBoxes;
+   mBoxes.resize(numberOfBoxes);
+   mKeys.resize(numberOfBoxes);
+   mSwapKeys.resize(numberOfBoxes);
+   mNodes.resize(numberOfBoxes > 0 ? numberOfBoxes - 1 : 0);
+   if (numberOfBoxes == 0) return;
+
+   //The bounds of the centers, which the Morton codes are relative to.
+   unsigned numberOfBlocks = getNumberOfBlocks(numberOfBoxes);
+   mBlockBounds.resize(numberOfBlocks);
+   forEachBlock(numberOfBlocks, "LinearBvh::boundCenters", [&](unsigned block)
+   {
+      unsigned begin, end;
+      getBlockRange(block, numberOfBlocks, numberOfBoxes, begin, end);
+      Shape::BoundingBox bounds;
+      bounds.lowerLeft = bounds.upperRight = (boxes[begin].lowerLeft + boxes[begin].upperRight) / 2;
+      for (unsigned i = begin + 1; i < end; i++)
+      {
+         Vec2f center = (boxes[i].lowerLeft + boxes[i].upperRight) / 2;
+         bounds.lowerLeft = Vec2f(std::min(bounds.lowerLeft.x, center.x), std::min(bounds.lowerLeft.y, center.y));
+         bounds.upperRight = Vec2f(std::max(bounds.upperRight.x, center.x), std::max(bounds.upperRight.y, center.y));
+      }
+      mBlockBounds[block] = bounds;
+   });
+   Shape::BoundingBox bounds = mBlockBounds[0];
+   for (unsigned block = 1; block < numberOfBlocks; block++) bounds = merge(bounds, mBlockBounds[block]);
+
+   //16 bits per axis, interleaved. The index below the code keeps the keys
+   //unique, which the hierarchy needs.
+   Vec2f extent = bounds.upperRight - bounds.lowerLeft;
+   float scaleX = extent.x > 0 ? 65535 / extent.x : 0;
+   float scaleY = extent.y > 0 ? 65535 / extent.y : 0;
+   forEachBlock(numberOfBlocks, "LinearBvh::encodeKeys", [&](unsigned block)
+   {
+      unsigned begin, end;
+      getBlockRange(block, numberOfBlocks, numberOfBoxes, begin, end);
+      for (unsigned i = begin; i < end; i++)
+      {
+         Vec2f center = (boxes[i].lowerLeft + boxes[i].upperRight) / 2;
+         uint32_t x = (uint32_t)((center.x - bounds.lowerLeft.x) * scaleX);
+         uint32_t y = (uint32_t)((center.y - bounds.lowerLeft.y) * scaleY);
+         uint32_t code = spreadBits(x) | spreadBits(y) << 1;
+         mKeys[i] = (uint64_t)code << 32 | i;
+      }
+   });
+   sortKeys();
+
+   forEachBlock(numberOfBlocks, "LinearBvh::gatherBoxes", [&](unsigned block)
+   {
+      unsigned begin, end;
+      getBlockRange(block, numberOfBlocks, numberOfBoxes, begin, end);
+      for (unsigned i = begin; i < end; i++) mBoxes[i] = boxes[(uint32_t)mKeys[i]];
+   });
+   if (numberOfBoxes == 1) return;
+
+   emitNodes();
+   fitNodes();
+}
+
+void LinearBvh::sortKeys()
+{
+   //A stable least significant digit radix sort of the codes. Each block
+   //counts its digits, the counts are turned into where each block writes
+   //each digit, then each block scatters its keys.
+   unsigned numberOfItems = mNumberOfItems;
+   unsigned numberOfBlocks = getNumberOfBlocks(numberOfItems);
+   mHistograms.resize(numberOfBlocks * RADIX);
+   for (unsigned shift = 32; shift < 64; shift += RADIX_BITS)
+   {
+      forEachBlock(numberOfBlocks, "LinearBvh::countDigits", [&](unsigned block)
+      {
+         unsigned begin, end;
+         getBlockRange(block, numberOfBlocks, numberOfItems, begin, end);
+         uint32_t* histogram = mHistograms.data() + block * RADIX;
+         std::fill(histogram, histogram + RADIX, 0);
+         for (unsigned i = begin; i < end; i++) histogram[(mKeys[i] >> shift) & (RADIX - 1)]++;
+      });
+
+      uint32_t sum = 0;
+      for (unsigned digit = 0; digit < RADIX; digit++)
+      {
+         for (unsigned block = 0; block < numberOfBlocks; block++)
+         {
+            uint32_t count = mHistograms[block * RADIX + digit];
+            mHistograms[block * RADIX + digit] = sum;
+            sum += count;
+         }
+      }
+
+      forEachBlock(numberOfBlocks, "LinearBvh::scatterKeys", [&](unsigned block)
+      {
+         unsigned begin, end;
+         getBlockRange(block, numberOfBlocks, numberOfItems, begin, end);
+         uint32_t* offsets = mHistograms.data() + block * RADIX;
+         for (unsigned i = begin; i < end; i++)
+            mSwapKeys[offsets[(mKeys[i] >> shift) & (RADIX - 1)]++] = mKeys[i];
+      });
+      mKeys.swap(mSwapKeys);
+   }
+}
+
+void LinearBvh::emitNodes()
+{
+   //The length of the prefix two keys share, -1 past the ends.
+   int numberOfItems = mNumberOfItems;
+   auto delta = [&](int i, int j)
+   {
+      if (j < 0 || j >= numberOfItems) return -1;
+      return countLeadingZeros(mKeys[i] ^ mKeys[j]);
+   };
+
+   //Internal node i covers a range of leaves that starts or ends at leaf i,
+   //found from the prefixes alone, so every node is independent.
+   unsigned numberOfNodes = numberOfItems - 1;
+   mParents.resize(numberOfNodes + numberOfItems);
+   mParents[0] = 0;
+   unsigned numberOfBlocks = getNumberOfBlocks(numberOfNodes);
+   forEachBlock(numberOfBlocks, "LinearBvh::emitNodes", [&](unsigned block)
+   {
+      unsigned begin, end;
+      getBlockRange(block, numberOfBlocks, numberOfNodes, begin, end);
+      for (int i = begin; i < (int)end; i++)
+      {
+         //The direction of the range is towards the neighbour sharing more.
+         int direction = delta(i, i + 1) > delta(i, i - 1) ? 1 : -1;
+         int minimumPrefix = delta(i, i - direction);
+
+         //Find the other end of the range, first roughly then exactly.
+         int maximumLength = 2;
+         while (delta(i, i + maximumLength * direction) > minimumPrefix) maximumLength *= 2;
+         int length = 0;
+         for (int step = maximumLength / 2; step >= 1; step /= 2)
+            if (delta(i, i + (length + step) * direction) > minimumPrefix) length += step;
+         int other = i + length * direction;
+
+         //Split where the prefix of the whole range ends.
+         int nodePrefix = delta(i, other);
+         int split = 0;
+         int step = length;
+         do
+         {
+            step = (step + 1) / 2;
+            if (delta(i, i + (split + step) * direction) > nodePrefix) split += step;
+         } while (step > 1);
+         int gamma = i + split * direction + std::min(direction, 0);
+
+         Node& node = mNodes[i];
+         node.left = std::min(i, other) == gamma ? gamma | LEAF : gamma;
+         node.right = std::max(i, other) == gamma + 1 ? (gamma + 1) | LEAF : gamma + 1;
+         mParents[node.left & LEAF ? numberOfNodes + gamma : gamma] = i;
+         mParents[node.right & LEAF ? numberOfNodes + gamma + 1 : gamma + 1] = i;
+      }
+   });
+}
+
+void LinearBvh::fitNodes()
+{
+   unsigned numberOfItems = mNumberOfItems;
+   unsigned numberOfNodes = numberOfItems - 1;
+   if (mVisitsSize < numberOfNodes)
+   {
+      mVisits.reset(new std::atomic<uint32_t>[numberOfNodes]);
+      mVisitsSize = numberOfNodes;
+   }
+   for (unsigned i = 0; i < numberOfNodes; i++) mVisits[i].store(0, std::memory_order_relaxed);
+
+   //Every leaf climbs towards the root. The first child to reach a node stops
+   //there, the second fits the node and carries on, so each node is fitted
+   //once, after both of its children.
+   unsigned numberOfBlocks = getNumberOfBlocks(numberOfItems);
+   forEachBlock(numberOfBlocks, "LinearBvh::fitNodes", [&](unsigned block)
+   {
+      unsigned begin, end;
+      getBlockRange(block, numberOfBlocks, numberOfItems, begin, end);
+      for (unsigned leaf = begin; leaf < end; leaf++)
+      {
+         unsigned node = mParents[numberOfNodes + leaf];
+         while (mVisits[node].fetch_add(1, std::memory_order_acq_rel) == 1)
+         {
+            Node& current = mNodes[node];
+            const Shape::BoundingBox& left = current.left & LEAF ? mBoxes[current.left & ~LEAF]
+                                                                  : mNodes[current.left].boundingBox;
+            const Shape::BoundingBox& right = current.right & LEAF ? mBoxes[current.right & ~LEAF]
+                                                                    : mNodes[current.right].boundingBox;
+            current.boundingBox = merge(left, right);
+            if (node == 0) break;
+            node = mParents[node];
+         }
+      }
+   });
+}
+
+void LinearBvh::findPairs(std::vector<Pair>& pairs)
+{
+   pairs.clear();
+   if (mNumberOfItems < 2) return;
+
+   //Every leaf walks the tree for the leaves after it. The blocks are joined in
+   //order, so the pairs come out the same however the blocks were run.
+   unsigned numberOfItems = mNumberOfItems;
+   unsigned numberOfBlocks = getNumberOfBlocks(numberOfItems);
+   if (mBlockPairs.size() < numberOfBlocks) mBlockPairs.resize(numberOfBlocks);
+   forEachBlock(numberOfBlocks, "LinearBvh::findPairs", [&](unsigned block)
+   {
+      unsigned begin, end;
+      getBlockRange(block, numberOfBlocks, numberOfItems, begin, end);
+      std::vector<Pair>& blockPairs = mBlockPairs[block];
+      blockPairs.clear();
+      uint32_t stack[STACK_SIZE];
+      for (unsigned leaf = begin; leaf < end; leaf++)
+      {
+         const Shape::BoundingBox& box = mBoxes[leaf];
+         unsigned size = 0;
+         stack[size++] = 0;
+         while (size > 0)
+         {
+            const Node& node = mNodes[stack[--size]];
+            const uint32_t children[2] = {node.left, node.right};
+            for (uint32_t child : children)
+            {
+               if (child & LEAF)
+               {
+                  unsigned other = child & ~LEAF;
+                  if (other > leaf && overlaps(box, mBoxes[other]))
+                     blockPairs.push_back(Pair{(uint32_t)mKeys[leaf], (uint32_t)mKeys[other]});
+               }
+               else if (overlaps(box, mNodes[child].boundingBox))
+                  stack[size++] = child;
+            }
+         }
+      }
+   });
+
+   for (unsigned block = 0; block < numberOfBlocks; block++)
+      pairs.insert(pairs.end(), mBlockPairs[block].begin(), mBlockPairs[block].end());
+}
+
+void LinearBvh::query(const Shape::BoundingBox& boundingBox, std::vector<unsigned>& items) const
+{
+   if (mNumberOfItems == 0) return;
+   if (mNumberOfItems == 1)
+   {
+      if (overlaps(boundingBox, mBoxes[0])) items.push_back((uint32_t)mKeys[0]);
+      return;
+   }
+
+   uint32_t stack[STACK_SIZE];
+   unsigned size = 0;
+   stack[size++] = 0;
+   while (size > 0)
+   {
+      const Node& node = mNodes[stack[--size]];
+      const uint32_t children[2] = {node.left, node.right};
+      for (uint32_t child : children)
+      {
+         if (child & LEAF)
+         {
+            if (overlaps(boundingBox, mBoxes[child & ~LEAF])) items.push_back((uint32_t)mKeys[child & ~LEAF]);
+         }
+         else if (overlaps(boundingBox, mNodes[child].boundingBox))
+            stack[size++] = child;
+      }
+   }
+}
+
+unsigned LinearBvh::getNumberOfItems() const
+{
+   return mNumberOfItems;
+}
+
+unsigned LinearBvh::getNumberOfNodes() const
+{
+   return mNodes.size();
+}
+
+const LinearBvh::Node& LinearBvh::getNode(unsigned i) const
+{
+   return mNodes[i];
+}
+
+unsigned LinearBvh::getItem(unsigned leaf) const
+{
+   return (uint32_t)mKeys[leaf];
+}
+
+unsigned LinearBvh::getNumberOfThreads() const
+{
+   return mPool.getNumberOfThreads();
+}
+
+}
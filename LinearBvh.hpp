@@ -0,0 +1,208 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_LINEAR_BVH_HPP_
+#define FZX_LINEAR_BVH_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "Memory.hpp"
+#include "Shape.hpp"
+#include "ThreadPool.hpp"
+
+namespace fzx
+{
+
+/**
+ * A bounding volume tree over BoundingBoxes that is rebuilt from scratch every
+ * time, spread over a pool of threads.
+ *
+ * The centers of the boxes are mapped to Morton codes, which are sorted with
+ * a parallel radix sort, so boxes close in space end up close in the order.
+ * Every internal node of the hierarchy is then found independently from the
+ * sorted codes (Karras 2012), so the whole tree is emitted in one parallel
+ * pass, and the boxes of the nodes are fitted bottom-up by whichever thread
+ * reaches a node second. Nothing is kept from one build to the next, so it
+ * doesn't degrade when every box moves a lot, as incremental trees do.
+ *
+ * findPairs() then walks the tree for every item at once, again spread over
+ * the threads.
+ */
+class LinearBvh
+{
+public:
+   static const uint32_t LEAF = 0x80000000u; ///< Marks a child that is a leaf. The rest is its position in the sorted order.
+
+   /**
+    * An internal node of the tree. The root is node 0.
+    */
+   struct Node
+   {
+      Shape::BoundingBox boundingBox; ///< The box that sorrounds every item below.
+      uint32_t left; ///< The left child, an internal node or a leaf marked with LEAF.
+      uint32_t right; ///< The right child, an internal node or a leaf marked with LEAF.
+   };
+
+   /**
+    * Two items whose boxes overlap.
+    */
+   struct Pair
+   {
+      unsigned a; ///< The first item.
+      unsigned b; ///< The second item.
+   };
+private:
+   typedef std::vector<Shape::BoundingBox, TrackingAllocator<Shape::BoundingBox, Memory::BROAD_PHASE>> BoxList;
+   typedef std::vector<uint64_t, TrackingAllocator<uint64_t, Memory::BROAD_PHASE>> KeyList;
+   typedef std::vector<uint32_t, TrackingAllocator<uint32_t, Memory::BROAD_PHASE>> IndexList;
+
+   BoxList mBoxes; ///< The box of each item, in sorted order.
+   BoxList mBlockBounds; ///< The bounds of the centers of each block.
+   KeyList mKeys; ///< The Morton code of each item above its index, sorted.
+   KeyList mSwapKeys; ///< The other buffer of the radix sort.
+   std::vector<Node, TrackingAllocator<Node, Memory::BROAD_PHASE>> mNodes; ///< The internal nodes, one less than the items.
+   IndexList mParents; ///< The parent of each internal node, then of each leaf.
+   IndexList mHistograms; ///< The digit counts of each block in a radix pass.
+   std::unique_ptr<std::atomic<uint32_t>[]> mVisits; ///< How many children of each internal node were fitted.
+   unsigned mVisitsSize; ///< The number of counters in mVisits.
+   std::vector<std::vector<Pair>> mBlockPairs; ///< The pairs found by each block.
+   unsigned mNumberOfItems; ///< The number of items in the tree.
+
+   ThreadPool mPool; ///< Spreads the blocks of each pass over threads.
+
+   /**
+    * Runs a function on every block, spread over the threads, and returns
+    * once every call is done. Every thread records the pass as a span with
+    * the given name.
+    */
+   void forEachBlock(unsigned numberOfBlocks, const char* name, const std::function<void(unsigned)>& task);
+
+   /**
+    * Returns how many blocks a number of items is split into, so that each
+    * thread gets a few, but none is too small to be worth claiming.
+    */
+   unsigned getNumberOfBlocks(unsigned numberOfItems) const;
+
+   /**
+    * Sorts the keys by their Morton codes.
+    */
+   void sortKeys();
+
+   /**
+    * Finds the children of every internal node from the sorted keys.
+    */
+   void emitNodes();
+
+   /**
+    * Fits the boxes of the internal nodes, from the leaves up.
+    */
+   void fitNodes();
+
+   //The threads refer to the tree, so it can't be copied.
+   LinearBvh(const LinearBvh&);
+   LinearBvh& operator=(const LinearBvh&);
+public:
+   /**
+    * Creates an empty tree and its threads.
+    *
+    * @param numberOfThreads The number of threads work is spread over,
+    *                        including the calling thread. 0 uses one per
+    *                        hardware thread.
+    */
+   LinearBvh(unsigned numberOfThreads = 0);
+
+   /**
+    * Builds the tree over a set of boxes, replacing any previous tree.
+    *
+    * @param boxes         The boxes. Item i is boxes[i].
+    * @param numberOfBoxes The number of boxes.
+    */
+   void build(const Shape::BoundingBox* boxes, unsigned numberOfBoxes);
+
+   /**
+    * Finds every pair of items whose boxes overlap, each pair once.
+    *
+    * The order of the pairs is the same for any number of threads.
+    *
+    * @param pairs The vector the pairs are written to. Its previous content is
+    *              replaced.
+    */
+   void findPairs(std::vector<Pair>& pairs);
+
+   /**
+    * Finds every item whose box overlaps a box.
+    *
+    * @param boundingBox The box to test against.
+    * @param items       The vector the indices of the overlapping items are
+    *                    appended to.
+    */
+   void query(const Shape::BoundingBox& boundingBox, std::vector<unsigned>& items) const;
+
+   /**
+    * Returns the number of items in the tree.
+    *
+    * @return The number of items.
+    */
+   unsigned getNumberOfItems() const;
+
+   /**
+    * Returns the number of internal nodes, one less than the items unless the
+    * tree is empty.
+    *
+    * @return The number of internal nodes.
+    */
+   unsigned getNumberOfNodes() const;
+
+   /**
+    * Returns an internal node of the tree.
+    *
+    * @param  i The index of the node, the root being 0.
+    * @return A constant reference to the Node.
+    */
+   const Node& getNode(unsigned i) const;
+
+   /**
+    * Returns the item of a leaf.
+    *
+    * @param  leaf The position of the leaf in the sorted order.
+    * @return The index of the item.
+    */
+   unsigned getItem(unsigned leaf) const;
+
+   /**
+    * Returns the number of threads work is spread over.
+    *
+    * @return The number of threads, including the calling one.
+    */
+   unsigned getNumberOfThreads() const;
+};
+
+}
+
+#endif /*FZX_LINEAR_BVH_HPP_*/
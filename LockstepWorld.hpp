@@ -0,0 +1,656 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_LOCKSTEP_WORLD_HPP_
+#define FZX_LOCKSTEP_WORLD_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Circle.hpp"
+#include "Lanes.hpp"
+#include "Memory.hpp"
+#include "Rectangle.hpp"
+#include "Settings.hpp"
+#include "World.hpp"
+
+namespace fzx
+{
+
+/**
+ * Simulates N copies of the same small World in lockstep, with the state of
+ * each copy in one SIMD lane.
+ *
+ * Every copy has the same RigidBodys with the same Shapes and Materials, and
+ * only their state differs. Each body's state is stored as Lanes, so
+ * integration, contact generation and the impulse solver run on all N copies
+ * at once, without branches, using the Vec2 math on Lanes<N>.
+ *
+ * Only Circles and Rectangles are supported. Every pair of bodies that could
+ * touch is tested each step, which suits the handful of bodies these rigs
+ * have. Rectangle pairs get up to two contacts from the incident face, clamped
+ * to the reference face rather than fully clipped.
+ */
+template <unsigned N>
+class LockstepWorld
+{
+public:
+   typedef Lanes<N> Value;
+   typedef Vec2<Value> Vector;
+
+   /**
+    * The state of one RigidBody in every lane.
+    */
+   struct State
+   {
+      Vector translation; ///< The translation of the body.
+      Vector velocity; ///< The translational velocity of the body.
+      Vector force; ///< The constant force on the body.
+      Value angle; ///< The rotation of the body.
+      Value cosine; ///< The cosine of the rotation.
+      Value sine; ///< The sine of the rotation.
+      Value angularVelocity; ///< The rotational velocity of the body.
+      Value torque; ///< The constant torque on the body.
+   };
+private:
+   /**
+    * The layout of one RigidBody, shared by every lane.
+    */
+   struct Body
+   {
+      Shape::ShapeType shapeType;
+      float radius; ///< The radius of a Circle.
+      float halfWidth; ///< Half the width of a Rectangle.
+      float halfHeight; ///< Half the height of a Rectangle.
+      float inverseMass; ///< The inverse mass in contacts, 0 unless DYNAMIC.
+      float inverseInertia; ///< The inverse inertia in contacts, 0 unless DYNAMIC.
+      float forceInverseMass; ///< The inverse mass for forces, 0 if STATIC.
+      float forceInverseInertia; ///< The inverse inertia for torques, 0 if STATIC.
+      float gravityScale; ///< 1 if gravity applies to the body, 0 if STATIC.
+   };
+
+   /**
+    * A pair of RigidBodys that could touch.
+    */
+   struct Pair
+   {
+      unsigned a; ///< The index of body A. A is a Circle if either is.
+      unsigned b; ///< The index of body B.
+      float restitution; ///< The mixed restitution of the pair.
+      float friction; ///< The mixed kinetic friction of the pair.
+   };
+
+   /**
+    * A contact point of a Pair in every lane.
+    */
+   struct Contact
+   {
+      Vector normal; ///< The normal from A to B.
+      Vector leverA; ///< From the center of A to the contact.
+      Vector leverB; ///< From the center of B to the contact.
+      Value penetration; ///< How deep the bodies overlap.
+      Value mask; ///< 1 in the lanes where the contact exists, 0 elsewhere.
+      Value normalMass; ///< The inverse effective mass along the normal.
+      Value tangentMass; ///< The inverse effective mass along the tangent.
+      Value bias; ///< The normal velocity the restitution aims for.
+      Value normalImpulse; ///< The accumulated normal impulse.
+      Value tangentImpulse; ///< The accumulated tangent impulse.
+   };
+
+   std::vector<Body> mBodies; ///< The layout of every RigidBody.
+   std::vector<State, TrackingAllocator<State, Memory::BODIES>> mStates; ///< The state of every RigidBody.
+   std::vector<Pair> mPairs; ///< The pairs that are tested.
+   std::vector<Contact, TrackingAllocator<Contact, Memory::CONTACTS>> mContacts; ///< Two per Pair.
+   Vec2f mGravity; ///< The gravity of the template World.
+   float mDeltaTime; ///< The time displacement per step.
+   unsigned mVelocityIterations; ///< The number of velocity iterations per step.
+
+   /**
+    * Zeroes every field of a contact slot that a pair doesn't use. The solver
+    * still runs over it, masked, and anything left in memory could be NaN,
+    * which a 0 mask doesn't cancel.
+    */
+   static void clearContact(Contact& contact)
+   {
+      contact.normal = Vector(Value(0), Value(0));
+      contact.leverA = contact.leverB = contact.normal;
+      contact.penetration = contact.mask = Value(0);
+      contact.normalMass = contact.tangentMass = contact.bias = Value(0);
+      contact.normalImpulse = contact.tangentImpulse = Value(0);
+   }
+
+   /**
+    * Finds the contact of a Circle and a Circle.
+    */
+   void solveCircleVsCircle(const Pair& pair, Contact* contacts)
+   {
+      const State& a = mStates[pair.a];
+      const State& b = mStates[pair.b];
+      float radiusA = mBodies[pair.a].radius;
+      float radiusB = mBodies[pair.b].radius;
+
+      Vector delta = b.translation - a.translation;
+      Value distance = delta.getMagnitude();
+      Value isApart = distance > Value(1e-6f);
+      Value inverse = Value(1) / max(distance, Value(1e-6f));
+      Vector normal(select(isApart, delta.x * inverse, Value(0)),
+                    select(isApart, delta.y * inverse, Value(1)));
+
+      Contact& contact = contacts[0];
+      contact.normal = normal;
+      contact.penetration = Value(radiusA + radiusB) - distance;
+      contact.mask = contact.penetration > Value(0);
+      contact.leverA = normal * Value(radiusA);
+      contact.leverB = contact.leverA - delta;
+      clearContact(contacts[1]);
+   }
+
+   /**
+    * Finds the contact of a Circle, body A, and a Rectangle, body B.
+    */
+   void solveCircleVsRectangle(const Pair& pair, Contact* contacts)
+   {
+      const State& a = mStates[pair.a];
+      const State& b = mStates[pair.b];
+      float radius = mBodies[pair.a].radius;
+      Value halfWidth(mBodies[pair.b].halfWidth);
+      Value halfHeight(mBodies[pair.b].halfHeight);
+
+      //Work in the Rectangle's frame.
+      Vector delta = a.translation - b.translation;
+      Vector local(b.cosine * delta.x + b.sine * delta.y, b.cosine * delta.y - b.sine * delta.x);
+      Vector closest(min(max(local.x, -halfWidth), halfWidth),
+                     min(max(local.y, -halfHeight), halfHeight));
+
+      //Outside, the normal points from the closest point to the center.
+      Vector offset = local - closest;
+      Value distance = offset.getMagnitude();
+      Value inverse = Value(1) / max(distance, Value(1e-6f));
+      Vector outsideNormal = offset * inverse;
+
+      //Inside, it points out of the nearest side.
+      Value depthX = halfWidth - abs(local.x);
+      Value depthY = halfHeight - abs(local.y);
+      Value isNearerX = depthX < depthY;
+      Vector insideNormal(select(isNearerX, sign(local.x), Value(0)),
+                          select(isNearerX, Value(0), sign(local.y)));
+
+      Value isInside = Value(1e-6f) > distance;
+      Vector localNormal(select(isInside, insideNormal.x, outsideNormal.x),
+                         select(isInside, insideNormal.y, outsideNormal.y));
+      Value penetration = select(isInside, Value(radius) + min(depthX, depthY),
+                                 Value(radius) - distance);
+
+      //Back to world space, flipped to point from the Circle to the Rectangle.
+      Vector normal(b.sine * localNormal.y - b.cosine * localNormal.x,
+                    -b.sine * localNormal.x - b.cosine * localNormal.y);
+
+      Contact& contact = contacts[0];
+      contact.normal = normal;
+      contact.penetration = penetration;
+      contact.mask = penetration > Value(0);
+      contact.leverA = normal * Value(radius);
+      contact.leverB = contact.leverA + delta;
+      clearContact(contacts[1]);
+   }
+
+   /**
+    * Finds the contacts of two Rectangles.
+    */
+   void solveRectangleVsRectangle(const Pair& pair, Contact* contacts)
+   {
+      const State& a = mStates[pair.a];
+      const State& b = mStates[pair.b];
+      Value halfWidthA(mBodies[pair.a].halfWidth), halfHeightA(mBodies[pair.a].halfHeight);
+      Value halfWidthB(mBodies[pair.b].halfWidth), halfHeightB(mBodies[pair.b].halfHeight);
+
+      Vector axisAX(a.cosine, a.sine), axisAY(-a.sine, a.cosine);
+      Vector axisBX(b.cosine, b.sine), axisBY(-b.sine, b.cosine);
+      Vector delta = b.translation - a.translation;
+
+      //The overlap along each of the four face normals.
+      Value xx = abs(axisAX * axisBX), xy = abs(axisAX * axisBY);
+      Value yx = abs(axisAY * axisBX), yy = abs(axisAY * axisBY);
+      Value overlapAX = halfWidthA + halfWidthB * xx + halfHeightB * xy - abs(delta * axisAX);
+      Value overlapAY = halfHeightA + halfWidthB * yx + halfHeightB * yy - abs(delta * axisAY);
+      Value overlapBX = halfWidthB + halfWidthA * xx + halfHeightA * yx - abs(delta * axisBX);
+      Value overlapBY = halfHeightB + halfWidthA * xy + halfHeightA * yy - abs(delta * axisBY);
+
+      //Pick the axis of least overlap, favoring A's axes so that the
+      //reference face doesn't flicker between nearly equal choices.
+      Value isAY = overlapAY < overlapAX;
+      Value overlapA = select(isAY, overlapAY, overlapAX);
+      Vector referenceAxisA(select(isAY, axisAY.x, axisAX.x), select(isAY, axisAY.y, axisAX.y));
+      Value referenceExtentA = select(isAY, halfHeightA, halfWidthA);
+      Value tangentExtentA = select(isAY, halfWidthA, halfHeightA);
+      Value isBY = overlapBY < overlapBX;
+      Value overlapB = select(isBY, overlapBY, overlapBX);
+      Vector referenceAxisB(select(isBY, axisBY.x, axisBX.x), select(isBY, axisBY.y, axisBX.y));
+      Value referenceExtentB = select(isBY, halfHeightB, halfWidthB);
+      Value tangentExtentB = select(isBY, halfWidthB, halfHeightB);
+      Value isReferenceB = overlapB * Value(1.05f) + Value(0.001f) < overlapA;
+
+      Vector axis(select(isReferenceB, referenceAxisB.x, referenceAxisA.x),
+                  select(isReferenceB, referenceAxisB.y, referenceAxisA.y));
+      Vector normal = axis * sign(delta * axis);
+      Value hit = min(overlapA, overlapB) > Value(0);
+
+      //The reference face, as a center and a tangent.
+      Value referenceExtent = select(isReferenceB, referenceExtentB, referenceExtentA);
+      Value tangentExtent = select(isReferenceB, tangentExtentB, tangentExtentA);
+      Vector referenceCenter(select(isReferenceB, b.translation.x, a.translation.x),
+                             select(isReferenceB, b.translation.y, a.translation.y));
+      Value towardIncident = select(isReferenceB, Value(-1), Value(1));
+      referenceCenter += normal * (referenceExtent * towardIncident);
+      Vector tangent(-normal.y, normal.x);
+
+      //The incident face is the face of the other Rectangle that faces the
+      //reference face the most.
+      Vector incidentCenter(select(isReferenceB, a.translation.x, b.translation.x),
+                            select(isReferenceB, a.translation.y, b.translation.y));
+      Vector incidentX(select(isReferenceB, axisAX.x, axisBX.x), select(isReferenceB, axisAX.y, axisBX.y));
+      Vector incidentY(select(isReferenceB, axisAY.x, axisBY.x), select(isReferenceB, axisAY.y, axisBY.y));
+      Value incidentWidth = select(isReferenceB, halfWidthA, halfWidthB);
+      Value incidentHeight = select(isReferenceB, halfHeightA, halfHeightB);
+      Vector direction = normal * -towardIncident;
+      Value alongX = incidentX * direction;
+      Value alongY = incidentY * direction;
+      Value isFaceX = abs(alongY) < abs(alongX);
+      Vector faceAxis(select(isFaceX, incidentX.x, incidentY.x), select(isFaceX, incidentX.y, incidentY.y));
+      Vector sideAxis(select(isFaceX, incidentY.x, incidentX.x), select(isFaceX, incidentY.y, incidentX.y));
+      Value faceExtent = select(isFaceX, incidentWidth, incidentHeight) *
+                         sign(select(isFaceX, alongX, alongY));
+      Value sideExtent = select(isFaceX, incidentHeight, incidentWidth);
+      Vector faceCenter = incidentCenter + faceAxis * faceExtent;
+
+      for (unsigned i = 0; i < 2; i++)
+      {
+         Vector vertex = faceCenter + sideAxis * (i == 0 ? sideExtent : -sideExtent);
+         Vector offset = vertex - referenceCenter;
+
+         //Clamp the vertex onto the span of the reference face.
+         Value lateral = offset * tangent;
+         Value clamped = min(max(lateral, -tangentExtent), tangentExtent);
+         Vector point = vertex + tangent * (clamped - lateral);
+
+         Contact& contact = contacts[i];
+         contact.normal = normal;
+         contact.penetration = -(offset * normal) * towardIncident;
+         contact.mask = hit * (contact.penetration > Value(0));
+         contact.leverA = point - a.translation;
+         contact.leverB = point - b.translation;
+      }
+   }
+
+   /**
+    * Applies gravity, forces and torques to the velocities.
+    */
+   void integrateForce()
+   {
+      for (unsigned i = 0; i < mBodies.size(); i++)
+      {
+         const Body& body = mBodies[i];
+         State& state = mStates[i];
+         Value gravityX(mGravity.x * body.gravityScale * mDeltaTime);
+         Value gravityY(mGravity.y * body.gravityScale * mDeltaTime);
+         Value inverseMass(body.forceInverseMass * mDeltaTime);
+         state.velocity.x += gravityX + state.force.x * inverseMass;
+         state.velocity.y += gravityY + state.force.y * inverseMass;
+         state.angularVelocity += state.torque * Value(body.forceInverseInertia * mDeltaTime);
+      }
+   }
+
+   /**
+    * Applies the velocities to the translations and rotations.
+    */
+   void integrateVelocity()
+   {
+      Value deltaTime(mDeltaTime);
+      for (State& state : mStates)
+      {
+         state.translation += state.velocity * deltaTime;
+
+         //Rotate the unit complex number (cosine, sine) by the step's angle,
+         //to second order, then pull it back onto the unit circle.
+         Value delta = state.angularVelocity * deltaTime;
+         Value half = Value(1) - delta * delta * Value(0.5f);
+         Value cosine = state.cosine * half - state.sine * delta;
+         Value sine = state.sine * half + state.cosine * delta;
+         Value length = sqrt(cosine * cosine + sine * sine);
+         state.cosine = cosine / length;
+         state.sine = sine / length;
+         state.angle += delta;
+      }
+   }
+
+   /**
+    * Prepares the masses and restitution targets of the contacts.
+    */
+   void prepareContacts()
+   {
+      for (unsigned p = 0; p < mPairs.size(); p++)
+      {
+         const Pair& pair = mPairs[p];
+         const Body& bodyA = mBodies[pair.a];
+         const Body& bodyB = mBodies[pair.b];
+         const State& a = mStates[pair.a];
+         const State& b = mStates[pair.b];
+         Value inverseMass(bodyA.inverseMass + bodyB.inverseMass);
+         for (unsigned i = 0; i < 2; i++)
+         {
+            Contact& contact = mContacts[2 * p + i];
+            Vector tangent(-contact.normal.y, contact.normal.x);
+            Value normalA = contact.leverA % contact.normal;
+            Value normalB = contact.leverB % contact.normal;
+            Value tangentA = contact.leverA % tangent;
+            Value tangentB = contact.leverB % tangent;
+            contact.normalMass = Value(1) / (inverseMass +
+               normalA * normalA * Value(bodyA.inverseInertia) +
+               normalB * normalB * Value(bodyB.inverseInertia));
+            contact.tangentMass = Value(1) / (inverseMass +
+               tangentA * tangentA * Value(bodyA.inverseInertia) +
+               tangentB * tangentB * Value(bodyB.inverseInertia));
+
+            Vector velocityA(a.velocity.x - a.angularVelocity * contact.leverA.y,
+                             a.velocity.y + a.angularVelocity * contact.leverA.x);
+            Vector velocityB(b.velocity.x - b.angularVelocity * contact.leverB.y,
+                             b.velocity.y + b.angularVelocity * contact.leverB.x);
+            Value approach = (velocityB - velocityA) * contact.normal;
+            contact.bias = max(-approach * Value(pair.restitution), Value(0));
+            contact.normalImpulse = Value(0);
+            contact.tangentImpulse = Value(0);
+         }
+      }
+   }
+
+   /**
+    * Runs one iteration of sequential impulses over every contact.
+    */
+   void solveVelocities()
+   {
+      for (unsigned p = 0; p < mPairs.size(); p++)
+      {
+         const Pair& pair = mPairs[p];
+         const Body& bodyA = mBodies[pair.a];
+         const Body& bodyB = mBodies[pair.b];
+         State& a = mStates[pair.a];
+         State& b = mStates[pair.b];
+         Value inverseMassA(bodyA.inverseMass), inverseInertiaA(bodyA.inverseInertia);
+         Value inverseMassB(bodyB.inverseMass), inverseInertiaB(bodyB.inverseInertia);
+         for (unsigned i = 0; i < 2; i++)
+         {
+            Contact& contact = mContacts[2 * p + i];
+            Vector tangent(-contact.normal.y, contact.normal.x);
+
+            Vector velocityA(a.velocity.x - a.angularVelocity * contact.leverA.y,
+                             a.velocity.y + a.angularVelocity * contact.leverA.x);
+            Vector velocityB(b.velocity.x - b.angularVelocity * contact.leverB.y,
+                             b.velocity.y + b.angularVelocity * contact.leverB.x);
+            Vector relative = velocityB - velocityA;
+
+            //Normal impulse, accumulated and kept pushing.
+            Value impulse = (contact.bias - relative * contact.normal) * contact.normalMass;
+            Value total = max(contact.normalImpulse + impulse, Value(0));
+            impulse = (total - contact.normalImpulse) * contact.mask;
+            contact.normalImpulse += impulse;
+
+            //Friction impulse, bounded by the normal impulse.
+            Value friction = -(relative * tangent) * contact.tangentMass;
+            Value limit = contact.normalImpulse * Value(pair.friction);
+            Value totalFriction = min(max(contact.tangentImpulse + friction, -limit), limit);
+            friction = (totalFriction - contact.tangentImpulse) * contact.mask;
+            contact.tangentImpulse += friction;
+
+            Vector push = contact.normal * impulse + tangent * friction;
+            a.velocity -= push * inverseMassA;
+            a.angularVelocity -= (contact.leverA % push) * inverseInertiaA;
+            b.velocity += push * inverseMassB;
+            b.angularVelocity += (contact.leverB % push) * inverseInertiaB;
+         }
+      }
+   }
+
+   /**
+    * Pushes overlapping bodies apart.
+    */
+   void correctPenetration()
+   {
+      for (unsigned p = 0; p < mPairs.size(); p++)
+      {
+         const Pair& pair = mPairs[p];
+         float inverseMassA = mBodies[pair.a].inverseMass;
+         float inverseMassB = mBodies[pair.b].inverseMass;
+         if (inverseMassA + inverseMassB == 0) continue;
+         Value scale(PENETRATION_SEPERATION_PERCENTAGE / (inverseMassA + inverseMassB));
+         State& a = mStates[pair.a];
+         State& b = mStates[pair.b];
+
+         //Only the deepest contact corrects, so two contacts don't double it.
+         const Contact& first = mContacts[2 * p];
+         const Contact& second = mContacts[2 * p + 1];
+         Value depth = max(first.penetration * first.mask, second.penetration * second.mask);
+         Vector correction = first.normal * (max(depth - Value(PENETRATION_SLOP), Value(0)) * scale);
+         a.translation -= correction * Value(inverseMassA);
+         b.translation += correction * Value(inverseMassB);
+      }
+   }
+public:
+   /**
+    * Creates a LockstepWorld with no bodies.
+    *
+    * @param velocityIterations The number of velocity iterations per step.
+    */
+   LockstepWorld(unsigned velocityIterations = 8) :
+      mDeltaTime(1.0f / 60), mVelocityIterations(velocityIterations) {}
+
+   /**
+    * Takes the bodies, gravity and delta time from a World, and puts its state
+    * in every lane.
+    *
+    * @param  world The World to copy. Every RigidBody must be a Circle or a
+    *               Rectangle.
+    * @return Whether the World could be copied. If not, nothing is changed.
+    */
+   bool setUp(World& world)
+   {
+      std::vector<Body> bodies(world.getNumberOfBodies());
+      for (unsigned i = 0; i < bodies.size(); i++)
+      {
+         RigidBody& rigidBody = world.getBody(i);
+         const Shape& shape = rigidBody.getShape();
+         Body& body = bodies[i];
+         body.shapeType = shape.getType();
+         body.radius = body.halfWidth = body.halfHeight = 0;
+         if (body.shapeType == Shape::CIRCLE) body.radius = shape.getRadius();
+         else if (body.shapeType == Shape::RECTANGLE)
+         {
+            const Rectangle& rectangle = static_cast<const Rectangle&>(shape);
+            body.halfWidth = rectangle.getWidth() / 2;
+            body.halfHeight = rectangle.getHeight() / 2;
+         }
+         else return false;
+
+         const RigidBody::MassData& massData = rigidBody.getMassData();
+         bool isStatic = rigidBody.getType() == RigidBody::STATIC;
+         bool isDynamic = rigidBody.getType() == RigidBody::DYNAMIC;
+         body.inverseMass = isDynamic ? massData.inverseMass : 0;
+         body.inverseInertia = isDynamic ? massData.inverseInertia : 0;
+         body.forceInverseMass = isStatic ? 0 : massData.inverseMass;
+         body.forceInverseInertia = isStatic ? 0 : massData.inverseInertia;
+         body.gravityScale = isStatic ? 0 : 1;
+      }
+
+      std::vector<Pair> pairs;
+      for (unsigned a = 0; a < bodies.size(); a++)
+      {
+         for (unsigned b = a + 1; b < bodies.size(); b++)
+         {
+            RigidBody& bodyA = world.getBody(a);
+            RigidBody& bodyB = world.getBody(b);
+            if (bodies[a].inverseMass == 0 && bodies[b].inverseMass == 0) continue;
+            if (bodyA.getLayer() != bodyB.getLayer()) continue;
+
+            Pair pair;
+            bool isSwapped = bodies[b].shapeType < bodies[a].shapeType;
+            pair.a = isSwapped ? b : a;
+            pair.b = isSwapped ? a : b;
+            const RigidBody::Material& materialA = bodyA.getMaterial();
+            const RigidBody::Material& materialB = bodyB.getMaterial();
+            pair.restitution = std::min(materialA.restitution, materialB.restitution);
+            pair.friction = std::sqrt(materialA.kineticFriction * materialB.kineticFriction);
+            pairs.push_back(pair);
+         }
+      }
+
+      mBodies.swap(bodies);
+      mPairs.swap(pairs);
+      mStates.resize(mBodies.size());
+      mContacts.resize(2 * mPairs.size());
+      mGravity = world.getGravity();
+      mDeltaTime = world.getDeltaTime();
+      for (unsigned lane = 0; lane < N; lane++) load(lane, world);
+      return true;
+   }
+
+   /**
+    * Copies the state of a World into a lane.
+    *
+    * @param  lane  The lane to write.
+    * @param  world A World laid out like the one given to setUp().
+    * @return Whether the World has the same number of RigidBodys.
+    */
+   bool load(unsigned lane, World& world)
+   {
+      if (world.getNumberOfBodies() != mStates.size()) return false;
+      for (unsigned i = 0; i < mStates.size(); i++)
+      {
+         RigidBody& body = world.getBody(i);
+         State& state = mStates[i];
+         Transform& transform = body.getTransform();
+         Vec2f velocity = body.getPush(RigidBody::VELOCITY);
+         Vec2f force = body.getPush(RigidBody::FORCE);
+         float angle = transform.getRotation();
+         state.translation.x[lane] = transform.getTranslation().x;
+         state.translation.y[lane] = transform.getTranslation().y;
+         state.velocity.x[lane] = velocity.x;
+         state.velocity.y[lane] = velocity.y;
+         state.force.x[lane] = force.x;
+         state.force.y[lane] = force.y;
+         state.angle[lane] = angle;
+         state.cosine[lane] = transform.getRotationMatrix().getLeftColumn().x;
+         state.sine[lane] = transform.getRotationMatrix().getLeftColumn().y;
+         state.angularVelocity[lane] = body.getTwist(RigidBody::VELOCITY);
+         state.torque[lane] = body.getTwist(RigidBody::FORCE);
+      }
+      return true;
+   }
+
+   /**
+    * Copies the state of a lane into a World.
+    *
+    * @param  lane  The lane to read.
+    * @param  world A World laid out like the one given to setUp().
+    * @return Whether the World has the same number of RigidBodys.
+    */
+   bool store(unsigned lane, World& world) const
+   {
+      if (world.getNumberOfBodies() != mStates.size()) return false;
+      for (unsigned i = 0; i < mStates.size(); i++)
+      {
+         RigidBody& body = world.getBody(i);
+         const State& state = mStates[i];
+         body.getTransform().setTranslation(Vec2f(state.translation.x[lane],
+                                                  state.translation.y[lane]));
+         body.getTransform().setRotation(state.angle[lane]);
+         body.setPush(Vec2f(state.velocity.x[lane], state.velocity.y[lane]), RigidBody::VELOCITY);
+         body.setTwist(state.angularVelocity[lane], RigidBody::VELOCITY);
+      }
+      return true;
+   }
+
+   /**
+    * Steps every lane.
+    */
+   void step()
+   {
+      integrateForce();
+      for (unsigned p = 0; p < mPairs.size(); p++)
+      {
+         const Pair& pair = mPairs[p];
+         Contact* contacts = &mContacts[2 * p];
+         Shape::ShapeType typeA = mBodies[pair.a].shapeType;
+         Shape::ShapeType typeB = mBodies[pair.b].shapeType;
+         if (typeA == Shape::CIRCLE && typeB == Shape::CIRCLE) solveCircleVsCircle(pair, contacts);
+         else if (typeA == Shape::CIRCLE) solveCircleVsRectangle(pair, contacts);
+         else solveRectangleVsRectangle(pair, contacts);
+      }
+      prepareContacts();
+      for (unsigned i = 0; i < mVelocityIterations; i++) solveVelocities();
+      integrateVelocity();
+      correctPenetration();
+   }
+
+   /**
+    * Returns the number of RigidBodys in each lane.
+    *
+    * @return The number of RigidBodys.
+    */
+   unsigned getNumberOfBodies() const
+   {
+      return mStates.size();
+   }
+
+   /**
+    * Returns the state of a RigidBody in every lane.
+    *
+    * @param  i The index of the RigidBody.
+    * @return A reference to its State, to read or change lanes directly.
+    */
+   State& getState(unsigned i)
+   {
+      return mStates[i];
+   }
+
+   /**
+    * Sets the state of a lane from a flat array, for example to apply an
+    * action. The rotation's cosine and sine are recomputed.
+    *
+    * @param i     The index of the RigidBody.
+    * @param lane  The lane to write.
+    * @param angle The new rotation.
+    */
+   void setRotation(unsigned i, unsigned lane, float angle)
+   {
+      State& state = mStates[i];
+      state.angle[lane] = angle;
+      state.cosine[lane] = std::cos(angle);
+      state.sine[lane] = std::sin(angle);
+   }
+};
+
+}
+
+#endif /*FZX_LOCKSTEP_WORLD_HPP_*/
@@ -26,12 +26,12 @@
 #ifndef FZX_MAT22_HPP_
 #define FZX_MAT22_HPP_
 
+#include <cmath>
+
 #include "Vec2.hpp"
 
 namespace fzx {
 
-#include <cmath>
-
 /**
  * A class that represents a 2-by-2 matrix.
  *
@@ -57,10 +57,15 @@ public:
 	 * Sets the left column to (cos(t), sin(t)) and the right column to
 	 * (-sin(t), cos(t)), where t is the angle of rotation.
 	 *
+	 * The trigonometric functions are looked up by argument, so a scalar type
+	 * like Fixed can supply its own deterministic versions.
+	 *
 	 * @param The angle of rotation of the matrix.
 	 */
 	Mat22(T theta)
 	{
+		using std::cos;
+		using std::sin;
 		mLeftColumn.x = cos(theta);
 		mLeftColumn.y = sin(theta);
 		mRightColumn.x = -mLeftColumn.y;
@@ -256,6 +261,24 @@ public:
 		output.mRightColumn.x = -mRightColumn.x;
 		return output / getDeterminant();
 	}
+
+	/**
+	 * Returns the left column of this matrix.
+	 * @return A constant reference to the left column.
+	 */
+	const Vec2<T>& getLeftColumn() const
+	{
+		return mLeftColumn;
+	}
+
+	/**
+	 * Returns the right column of this matrix.
+	 * @return A constant reference to the right column.
+	 */
+	const Vec2<T>& getRightColumn() const
+	{
+		return mRightColumn;
+	}
 };
 
 typedef Mat22<float> Mat22f;
@@ -0,0 +1,224 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "Memory.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+namespace fzx
+{
+
+namespace
+{
+
+/**
+ * The Allocator used when none was set. Wraps malloc and free, over-allocating
+ * for alignments malloc doesn't guarantee.
+ */
+class DefaultAllocator : public Allocator
+{
+public:
+   void* allocate(std::size_t size, std::size_t alignment)
+   {
+      if (alignment <= alignof(std::max_align_t)) return std::malloc(size);
+
+      //Keep the pointer from malloc right before the aligned block.
+      void* block = std::malloc(size + alignment + sizeof(void*));
+      if (block == nullptr) return nullptr;
+      std::uintptr_t address = reinterpret_cast<std::uintptr_t>(block) + sizeof(void*);
+      address = (address + alignment - 1) & ~(std::uintptr_t)(alignment - 1);
+      reinterpret_cast<void**>(address)[-1] = block;
+      return reinterpret_cast<void*>(address);
+   }
+
+   void deallocate(void* pointer, std::size_t, std::size_t alignment)
+   {
+      if (alignment <= alignof(std::max_align_t)) std::free(pointer);
+      else std::free(static_cast<void**>(pointer)[-1]);
+   }
+};
+
+DefaultAllocator defaultAllocator;
+std::atomic<Allocator*> currentAllocator(&defaultAllocator);
+//Static storage is zero initialized, so every counter starts at zero.
+Memory::Counters counters[Memory::NUMBER_OF_CATEGORIES];
+
+void addBlock(Memory::Counters& counter, std::size_t size)
+{
+   std::size_t current = counter.currentBytes.fetch_add(size, std::memory_order_relaxed) + size;
+   counter.allocations.fetch_add(1, std::memory_order_relaxed);
+   std::size_t peak = counter.peakBytes.load(std::memory_order_relaxed);
+   while (current > peak &&
+          !counter.peakBytes.compare_exchange_weak(peak, current, std::memory_order_relaxed));
+}
+
+void removeBlock(Memory::Counters& counter, std::size_t size)
+{
+   counter.currentBytes.fetch_sub(size, std::memory_order_relaxed);
+   counter.allocations.fetch_sub(1, std::memory_order_relaxed);
+}
+
+Memory::Stats getCounterStats(const Memory::Counters& counter)
+{
+   Memory::Stats stats;
+   stats.currentBytes = counter.currentBytes.load(std::memory_order_relaxed);
+   stats.peakBytes = counter.peakBytes.load(std::memory_order_relaxed);
+   stats.allocations = counter.allocations.load(std::memory_order_relaxed);
+   return stats;
+}
+
+Memory::Stats sumStats(const Memory::Counters* counters)
+{
+   Memory::Stats total = {0, 0, 0};
+   for (unsigned i = 0; i < Memory::NUMBER_OF_CATEGORIES; i++)
+   {
+      Memory::Stats stats = getCounterStats(counters[i]);
+      total.currentBytes += stats.currentBytes;
+      total.peakBytes += stats.peakBytes;
+      total.allocations += stats.allocations;
+   }
+   return total;
+}
+
+/**
+ * Returns where the Account is kept in a block made by allocateTagged().
+ */
+std::size_t getTagOffset(std::size_t size)
+{
+   return (size + alignof(Memory::Account*) - 1) & ~(alignof(Memory::Account*) - 1);
+}
+
+void resetCounterPeaks(Memory::Counters* counters)
+{
+   for (unsigned i = 0; i < Memory::NUMBER_OF_CATEGORIES; i++)
+      counters[i].peakBytes.store(counters[i].currentBytes.load(std::memory_order_relaxed),
+                                  std::memory_order_relaxed);
+}
+
+}
+
+Memory::Account::Account()
+{
+   for (Counters& counter : mCounters)
+   {
+      counter.currentBytes.store(0, std::memory_order_relaxed);
+      counter.peakBytes.store(0, std::memory_order_relaxed);
+      counter.allocations.store(0, std::memory_order_relaxed);
+   }
+}
+
+Memory::Stats Memory::Account::getStats(Category category) const
+{
+   return getCounterStats(mCounters[category]);
+}
+
+Memory::Stats Memory::Account::getTotalStats() const
+{
+   return sumStats(mCounters);
+}
+
+void Memory::Account::resetPeaks()
+{
+   resetCounterPeaks(mCounters);
+}
+
+void Memory::setAllocator(Allocator* allocator)
+{
+   currentAllocator.store(allocator != nullptr ? allocator : &defaultAllocator);
+}
+
+Allocator& Memory::getAllocator()
+{
+   return *currentAllocator.load(std::memory_order_relaxed);
+}
+
+void* Memory::allocate(std::size_t size, Category category, std::size_t alignment,
+                       Account* account)
+{
+   void* pointer = getAllocator().allocate(size, alignment);
+   if (pointer == nullptr) throw std::bad_alloc();
+
+   addBlock(counters[category], size);
+   if (account != nullptr) addBlock(account->mCounters[category], size);
+   return pointer;
+}
+
+void Memory::deallocate(void* pointer, std::size_t size, Category category,
+                        std::size_t alignment, Account* account)
+{
+   if (pointer == nullptr) return;
+   getAllocator().deallocate(pointer, size, alignment);
+
+   removeBlock(counters[category], size);
+   if (account != nullptr) removeBlock(account->mCounters[category], size);
+}
+
+void* Memory::allocateTagged(std::size_t size, Category category, std::size_t alignment,
+                             Account* account)
+{
+   std::size_t tag = getTagOffset(size);
+   char* block = static_cast<char*>(allocate(tag + sizeof(Account*), category, alignment, account));
+   std::memcpy(block + tag, &account, sizeof(Account*));
+   return block;
+}
+
+void Memory::deallocateTagged(void* pointer, std::size_t size, Category category,
+                              std::size_t alignment)
+{
+   if (pointer == nullptr) return;
+   std::size_t tag = getTagOffset(size);
+   Account* account;
+   std::memcpy(&account, static_cast<char*>(pointer) + tag, sizeof(Account*));
+   deallocate(pointer, tag + sizeof(Account*), category, alignment, account);
+}
+
+Memory::Stats Memory::getStats(Category category)
+{
+   return getCounterStats(counters[category]);
+}
+
+Memory::Stats Memory::getTotalStats()
+{
+   return sumStats(counters);
+}
+
+void Memory::resetPeaks()
+{
+   resetCounterPeaks(counters);
+}
+
+const char* Memory::getName(Category category)
+{
+   static const char* const names[NUMBER_OF_CATEGORIES] = {
+      "BODIES", "SHAPES", "VERTICES", "COLLISIONS", "CONTACTS", "BROAD_PHASE",
+      "PARTICLES"
+   };
+   return names[category];
+}
+
+}
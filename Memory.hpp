@@ -0,0 +1,346 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_MEMORY_HPP_
+#define FZX_MEMORY_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+
+namespace fzx
+{
+
+/**
+ * The interface the engine gets its memory from.
+ *
+ * Implement it to route the engine's allocations into a custom heap, then pass
+ * it to Memory::setAllocator().
+ */
+class Allocator
+{
+public:
+   //Destructor made virtual to allow subclasses to override it
+   virtual ~Allocator(){};
+
+   /**
+    * Allocates a block of memory.
+    *
+    * @param  size      The size of the block in bytes.
+    * @param  alignment The alignment of the block, a power of two.
+    * @return A pointer to the block, or null if it couldn't be allocated.
+    */
+   virtual void* allocate(std::size_t size, std::size_t alignment) = 0;
+
+   /**
+    * Frees a block returned by allocate().
+    *
+    * @param pointer   The pointer to the block.
+    * @param size      The size the block was allocated with.
+    * @param alignment The alignment the block was allocated with.
+    */
+   virtual void deallocate(void* pointer, std::size_t size, std::size_t alignment) = 0;
+};
+
+/**
+ * Routes the engine's allocations through an Allocator and accounts for them.
+ *
+ * The accounting is per category. Every allocation counts toward the totals of
+ * the process, and allocations made for an Account, such as the one of a World,
+ * also count toward that Account. It is thread safe.
+ */
+class Memory
+{
+public:
+   /**
+    * The subsystems the engine's memory is accounted to.
+    */
+   enum Category
+   {
+      BODIES, SHAPES, VERTICES, COLLISIONS, CONTACTS, BROAD_PHASE, PARTICLES, NUMBER_OF_CATEGORIES
+   };
+
+   /**
+    * The memory accounted to a Category.
+    */
+   struct Stats
+   {
+      std::size_t currentBytes; ///< The bytes allocated right now.
+      std::size_t peakBytes; ///< The most bytes ever allocated at once.
+      std::size_t allocations; ///< The number of blocks allocated right now.
+   };
+
+   /**
+    * The running counts of a Category.
+    */
+   struct Counters
+   {
+      std::atomic<std::size_t> currentBytes;
+      std::atomic<std::size_t> peakBytes;
+      std::atomic<std::size_t> allocations;
+   };
+
+   /**
+    * Memory accounted to one owner, on top of the totals of the process.
+    *
+    * It must outlive every block allocated for it.
+    */
+   class Account
+   {
+   friend class Memory;
+   private:
+      Counters mCounters[NUMBER_OF_CATEGORIES]; ///< The counts of each Category.
+
+      //The counts belong to the blocks allocated for this Account.
+      Account(const Account&);
+      Account& operator=(const Account&);
+   public:
+      /**
+       * Creates an Account with nothing allocated.
+       */
+      Account();
+
+      /**
+       * Returns the memory of the Account in a Category.
+       *
+       * @param  category The Category to look up.
+       * @return The Stats of the Category.
+       */
+      Stats getStats(Category category) const;
+
+      /**
+       * Returns the memory of the Account in every Category together.
+       *
+       * @return The summed Stats, with the peak summed like
+       *         Memory::getTotalStats().
+       */
+      Stats getTotalStats() const;
+
+      /**
+       * Lowers the peak of every Category to its current usage.
+       */
+      void resetPeaks();
+   };
+
+   /**
+    * Sets the Allocator used by the engine.
+    *
+    * The Allocator must be set before the engine allocates anything, or every
+    * block allocated so far must be freed first, since blocks are always freed
+    * through the current Allocator.
+    *
+    * @param allocator The new Allocator, or null to use the default one that
+    *                  wraps malloc and free. It must outlive every allocation.
+    */
+   static void setAllocator(Allocator* allocator);
+
+   /**
+    * Returns the Allocator used by the engine.
+    *
+    * @return The current Allocator.
+    */
+   static Allocator& getAllocator();
+
+   /**
+    * Allocates memory through the current Allocator and accounts for it.
+    *
+    * @param  size      The size of the block in bytes.
+    * @param  category  The Category the block is accounted to.
+    * @param  alignment The alignment of the block, a power of two.
+    * @param  account   The Account the block is also accounted to, or null.
+    * @return A pointer to the block. Throws std::bad_alloc on failure, like the
+    *         operator new it replaces.
+    */
+   static void* allocate(std::size_t size, Category category,
+                         std::size_t alignment = alignof(std::max_align_t),
+                         Account* account = nullptr);
+
+   /**
+    * Frees memory returned by allocate().
+    *
+    * @param pointer   The pointer to the block. Null is ignored.
+    * @param size      The size the block was allocated with.
+    * @param category  The Category the block was accounted to.
+    * @param alignment The alignment the block was allocated with.
+    * @param account   The Account the block was allocated for, or null.
+    */
+   static void deallocate(void* pointer, std::size_t size, Category category,
+                          std::size_t alignment = alignof(std::max_align_t),
+                          Account* account = nullptr);
+
+   /**
+    * Allocates memory like allocate(), and keeps the Account at the end of the
+    * block so deallocateTagged() can find it. This lets a class-specific
+    * operator delete, which is only given the pointer and size, charge the
+    * right Account.
+    *
+    * @param  size      The size of the object in bytes.
+    * @param  category  The Category the block is accounted to.
+    * @param  alignment The alignment of the block, a power of two.
+    * @param  account   The Account the block is also accounted to, or null.
+    * @return A pointer to the block. Throws std::bad_alloc on failure.
+    */
+   static void* allocateTagged(std::size_t size, Category category, std::size_t alignment,
+                               Account* account);
+
+   /**
+    * Frees memory returned by allocateTagged(), refunding the Account kept in
+    * the block.
+    *
+    * @param pointer   The pointer to the block. Null is ignored.
+    * @param size      The size of the object the block was allocated for.
+    * @param category  The Category the block was accounted to.
+    * @param alignment The alignment the block was allocated with.
+    */
+   static void deallocateTagged(void* pointer, std::size_t size, Category category,
+                                std::size_t alignment);
+
+   /**
+    * Returns the memory accounted to a Category.
+    *
+    * @param  category The Category to look up.
+    * @return The Stats of the Category.
+    */
+   static Stats getStats(Category category);
+
+   /**
+    * Returns the memory accounted to every Category together.
+    *
+    * The peak is the sum of the peaks of each Category, so it may be higher
+    * than the true peak.
+    *
+    * @return The summed Stats.
+    */
+   static Stats getTotalStats();
+
+   /**
+    * Lowers the peak of every Category to its current usage.
+    */
+   static void resetPeaks();
+
+   /**
+    * Returns the name of a Category.
+    *
+    * @param  category The Category.
+    * @return The upper case name of the Category.
+    */
+   static const char* getName(Category category);
+};
+
+/**
+ * A standard library allocator that allocates through Memory.
+ *
+ * Engine containers use it so that their storage is accounted to a Category,
+ * and to the Account of their owner if they are given one. The Account moves
+ * and swaps along with the storage.
+ */
+template <typename T, Memory::Category C>
+class TrackingAllocator
+{
+private:
+   Memory::Account* mAccount; ///< The Account storage is also accounted to, or null.
+public:
+   typedef T value_type;
+   typedef std::true_type propagate_on_container_move_assignment;
+   typedef std::true_type propagate_on_container_swap;
+
+   template <typename U>
+   struct rebind
+   {
+      typedef TrackingAllocator<U, C> other;
+   };
+
+   TrackingAllocator(Memory::Account* account = nullptr) : mAccount(account) {}
+
+   template <typename U>
+   TrackingAllocator(const TrackingAllocator<U, C>& other) : mAccount(other.getAccount()) {}
+
+   Memory::Account* getAccount() const
+   {
+      return mAccount;
+   }
+
+   T* allocate(std::size_t n)
+   {
+      return static_cast<T*>(Memory::allocate(n * sizeof(T), C, alignof(T), mAccount));
+   }
+
+   void deallocate(T* pointer, std::size_t n)
+   {
+      Memory::deallocate(pointer, n * sizeof(T), C, alignof(T), mAccount);
+   }
+
+   template <typename U>
+   bool operator==(const TrackingAllocator<U, C>& other) const
+   {
+      return mAccount == other.getAccount();
+   }
+
+   template <typename U>
+   bool operator!=(const TrackingAllocator<U, C>& other) const
+   {
+      return mAccount != other.getAccount();
+   }
+};
+
+}
+
+/// Declares class-specific operator new and delete that account to a Memory::Category.
+#define FZX_TRACK_ALLOCATIONS(category) \
+   FZX_TRACK_ALIGNED_ALLOCATIONS(category, alignof(std::max_align_t))
+
+/// Like FZX_TRACK_ALLOCATIONS, for classes aligned more strictly than operator new guarantees.
+#define FZX_TRACK_ALIGNED_ALLOCATIONS(category, alignment) \
+   static void* operator new(std::size_t size) \
+   { \
+      return fzx::Memory::allocate(size, fzx::Memory::category, alignment); \
+   } \
+   static void operator delete(void* pointer, std::size_t size) \
+   { \
+      fzx::Memory::deallocate(pointer, size, fzx::Memory::category, alignment); \
+   }
+
+/// Declares class-specific operator new and delete that account to a Memory::Category and,
+/// through new (account) type, to a Memory::Account as well.
+#define FZX_TRACK_ACCOUNTED_ALLOCATIONS(type, category) \
+   static void* operator new(std::size_t size) \
+   { \
+      return fzx::Memory::allocateTagged(size, fzx::Memory::category, alignof(type), nullptr); \
+   } \
+   static void* operator new(std::size_t size, fzx::Memory::Account* account) \
+   { \
+      return fzx::Memory::allocateTagged(size, fzx::Memory::category, alignof(type), account); \
+   } \
+   static void operator delete(void* pointer, std::size_t size) \
+   { \
+      fzx::Memory::deallocateTagged(pointer, size, fzx::Memory::category, alignof(type)); \
+   } \
+   static void operator delete(void* pointer, fzx::Memory::Account*) \
+   { \
+      fzx::Memory::deallocateTagged(pointer, sizeof(type), fzx::Memory::category, alignof(type)); \
+   }
+
+#endif /*FZX_MEMORY_HPP_*/
@@ -0,0 +1,179 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "NameTable.hpp"
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace fzx
+{
+
+namespace
+{
+
+/**
+ * The interned names, by id and by characters.
+ */
+struct Table
+{
+   std::mutex mutex;
+   std::deque<std::string> names; ///< Growing a deque keeps references to names valid.
+   std::deque<unsigned> references; ///< The number of references to each name.
+   std::vector<unsigned> freeIds; ///< Ids of removed names, to be reused.
+   std::unordered_map<std::string, unsigned> ids;
+
+   Table() : names(1), references(1) {}
+};
+
+Table& getTable()
+{
+   //Never destroyed, so names stay valid for bodies destroyed during static destruction.
+   static Table* table = new Table;
+   return *table;
+}
+
+}
+
+unsigned NameTable::intern(const std::string& name)
+{
+   if (name.empty()) return NO_NAME;
+
+   Table& table = getTable();
+   std::lock_guard<std::mutex> lock(table.mutex);
+   auto entry = table.ids.find(name);
+   if (entry != table.ids.end())
+   {
+      table.references[entry->second]++;
+      return entry->second;
+   }
+
+   unsigned id;
+   if (table.freeIds.empty())
+   {
+      id = table.names.size();
+      table.names.push_back(name);
+      table.references.push_back(1);
+   }
+   else
+   {
+      id = table.freeIds.back();
+      table.freeIds.pop_back();
+      table.names[id] = name;
+      table.references[id] = 1;
+   }
+   table.ids.emplace(name, id);
+   return id;
+}
+
+void NameTable::retain(unsigned id)
+{
+   if (id == NO_NAME) return;
+
+   Table& table = getTable();
+   std::lock_guard<std::mutex> lock(table.mutex);
+   table.references[id]++;
+}
+
+void NameTable::release(unsigned id)
+{
+   if (id == NO_NAME) return;
+
+   Table& table = getTable();
+   std::lock_guard<std::mutex> lock(table.mutex);
+   if (--table.references[id] > 0) return;
+
+   table.ids.erase(table.names[id]);
+   std::string().swap(table.names[id]);
+   table.freeIds.push_back(id);
+}
+
+bool NameTable::find(const std::string& name, unsigned& id)
+{
+   if (name.empty())
+   {
+      id = NO_NAME;
+      return true;
+   }
+
+   Table& table = getTable();
+   std::lock_guard<std::mutex> lock(table.mutex);
+   auto entry = table.ids.find(name);
+   if (entry == table.ids.end()) return false;
+   id = entry->second;
+   return true;
+}
+
+const std::string& NameTable::getName(unsigned id)
+{
+   Table& table = getTable();
+   std::lock_guard<std::mutex> lock(table.mutex);
+   return table.names[id];
+}
+
+unsigned NameTable::getNumberOfNames()
+{
+   Table& table = getTable();
+   std::lock_guard<std::mutex> lock(table.mutex);
+   return table.ids.size() + 1;
+}
+
+NameTable::Reference::Reference(const std::string& name)
+   : mId(intern(name))
+{
+}
+
+NameTable::Reference::Reference(const Reference& other)
+   : mId(other.mId)
+{
+   retain(mId);
+}
+
+NameTable::Reference& NameTable::Reference::operator=(const Reference& other)
+{
+   retain(other.mId);
+   release(mId);
+   mId = other.mId;
+   return *this;
+}
+
+NameTable::Reference::~Reference()
+{
+   release(mId);
+}
+
+unsigned NameTable::Reference::getId() const
+{
+   return mId;
+}
+
+const std::string& NameTable::Reference::getName() const
+{
+   return NameTable::getName(mId);
+}
+
+}
@@ -0,0 +1,135 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_NAME_TABLE_HPP_
+#define FZX_NAME_TABLE_HPP_
+
+#include <string>
+
+namespace fzx
+{
+
+/**
+ * Interns the names of RigidBodys as small integer ids.
+ *
+ * A body stores only the id of its name, so the characters live once in this
+ * table no matter how many bodies share them, and comparing names is comparing
+ * ids. Each name counts its references, and is removed when the last one is
+ * released, so its id can be given to another name. The table is thread safe.
+ */
+class NameTable
+{
+public:
+   static const unsigned NO_NAME = 0; ///< The id of the empty name.
+
+   /**
+    * Holds one reference to an interned name, and releases it when destroyed.
+    *
+    * Copies hold references of their own.
+    */
+   class Reference
+   {
+   public:
+      /**
+       * Interns a name and holds a reference to it.
+       *
+       * @param name The name, the empty name by default.
+       */
+      explicit Reference(const std::string& name = "");
+
+      Reference(const Reference& other);
+      Reference& operator=(const Reference& other);
+      ~Reference();
+
+      /**
+       * Returns the id of the name.
+       *
+       * @return The id, NO_NAME for the empty name.
+       */
+      unsigned getId() const;
+
+      /**
+       * Returns the name.
+       *
+       * @return The name, which stays valid while this Reference holds it.
+       */
+      const std::string& getName() const;
+   private:
+      unsigned mId; ///< The id of the name held.
+   };
+
+   /**
+    * Returns the id of a name, adding the name if it is new.
+    *
+    * The caller holds one reference to the name, to be given back with
+    * release().
+    *
+    * @param  name The name.
+    * @return The id of the name, NO_NAME for the empty name.
+    */
+   static unsigned intern(const std::string& name);
+
+   /**
+    * Adds a reference to an interned name.
+    *
+    * @param id An id returned by intern().
+    */
+   static void retain(unsigned id);
+
+   /**
+    * Gives back a reference to a name, removing the name if it was the last.
+    *
+    * @param id An id returned by intern() or passed to retain().
+    */
+   static void release(unsigned id);
+
+   /**
+    * Returns the id of a name without adding it.
+    *
+    * @param  name The name.
+    * @param  id Set to the id of the name if it was found.
+    * @return True if the name has been interned.
+    */
+   static bool find(const std::string& name, unsigned& id);
+
+   /**
+    * Returns the name with an id.
+    *
+    * @param  id The id of a name that is still referenced.
+    * @return The name, which stays valid until its last reference is released.
+    */
+   static const std::string& getName(unsigned id);
+
+   /**
+    * Returns the number of names in use, counting the empty name.
+    *
+    * @return The number of names.
+    */
+   static unsigned getNumberOfNames();
+};
+
+}
+
+#endif /*FZX_NAME_TABLE_HPP_*/
@@ -0,0 +1,537 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "ParticleSystem.hpp"
+#include "World.hpp"
+#include "Collision.hpp"
+#include "Lanes.hpp"
+#include "ShapeCache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace fzx
+{
+
+namespace
+{
+
+const unsigned LANE_WIDTH = 8; ///< The number of neighbours handled at once.
+const float EPSILON = 1e-6f;
+const float PI = 3.14159265f;
+const float RELAXATION = 1.5f; ///< Scales the averaged corrections of an iteration.
+const float STACKING = 2; ///< Mass ratio between a particle and one resting a diameter above it.
+const float MAXIMUM_STACKING = 20; ///< Cap on the logarithm of the mass scale.
+
+typedef Lanes<LANE_WIDTH> Lane;
+
+/**
+ * The sorted particle arrays, as seen by the kernel.
+ */
+struct Arrays
+{
+   const float* x;
+   const float* y;
+   const float* previousX;
+   const float* previousY;
+   const float* radius;
+   const float* inverseMass;
+};
+
+Lane load(const float* values)
+{
+   Lane lane;
+   for (unsigned k = 0; k < LANE_WIDTH; k++) lane.v[k] = values[k];
+   return lane;
+}
+
+float sum(const Lane& lane)
+{
+   float total = 0;
+   for (unsigned k = 0; k < LANE_WIDTH; k++) total += lane.v[k];
+   return total;
+}
+
+/**
+ * Sums how far particle a must move to stop overlapping the particles of
+ * [begin, end), and to undo the sliding friction stops.
+ *
+ * Each overlap is split between the two particles by their inverse masses.
+ */
+void accumulateCorrections(const Arrays& arrays, unsigned a, unsigned begin, unsigned end,
+                           float friction, Lane& deltaX, Lane& deltaY, Lane& contacts)
+{
+   Lane self((float)a);
+   Lane x(arrays.x[a]), y(arrays.y[a]), radius(arrays.radius[a]), inverseMass(arrays.inverseMass[a]);
+   Lane movedX = x - Lane(arrays.previousX[a]), movedY = y - Lane(arrays.previousY[a]);
+   for (unsigned j = begin; j < end; j += LANE_WIDTH)
+   {
+      Lane index;
+      for (unsigned k = 0; k < LANE_WIDTH; k++) index.v[k] = (float)(j + k);
+
+      Lane otherX = load(arrays.x + j), otherY = load(arrays.y + j);
+      Lane dx = x - otherX, dy = y - otherY;
+      Lane distanceSquared = dx * dx + dy * dy;
+      Lane reach = radius + load(arrays.radius + j);
+      //Lanes past the end of the run hold other cells, and one of them may be a itself.
+      Lane isTouching = (index < Lane((float)end)) * (abs(index - self) > Lane(.5f))
+                        * (distanceSquared < reach * reach);
+      if (sum(isTouching) == 0) continue;
+
+      //Particles on top of each other are pushed apart along x, in index order.
+      Lane distance = sqrt(distanceSquared);
+      Lane inverseDistance = Lane(1) / max(distance, Lane(EPSILON));
+      Lane isApart = distance > Lane(EPSILON);
+      Lane normalX = select(isApart, dx * inverseDistance, sign(self - index));
+      Lane normalY = select(isApart, dy * inverseDistance, Lane(0));
+      Lane overlap = reach - distance;
+      Lane share = inverseMass / max(inverseMass + load(arrays.inverseMass + j), Lane(EPSILON))
+                   * isTouching;
+
+      //Sliding this step, along the tangent, is cancelled up to the friction limit.
+      Lane slideX = movedX - (otherX - load(arrays.previousX + j));
+      Lane slideY = movedY - (otherY - load(arrays.previousY + j));
+      Lane slide = slideY * normalX - slideX * normalY;
+      Lane limit = friction * overlap;
+      Lane stop = max(-limit, min(slide, limit));
+
+      deltaX += share * (overlap * normalX + stop * normalY);
+      deltaY += share * (overlap * normalY - stop * normalX);
+      contacts += isTouching;
+   }
+}
+
+/**
+ * Returns the column or row of a coordinate relative to the grid, clamped to it.
+ */
+unsigned getCellCoordinate(float offset, float cellSize, unsigned count)
+{
+   float coordinate = offset / cellSize;
+   if (!(coordinate > 0)) return 0;
+   if (coordinate >= count - 1) return count - 1;
+   return (unsigned)coordinate;
+}
+
+}
+
+ParticleSystem::ParticleSystem()
+   : mProxy(new RigidBody())
+{
+   mMaterial = RigidBody::Material{1, .5f, .4f, .1f};
+   mCoupling = TWO_WAY;
+   mIterations = 4;
+   mMaximumRadius = 0;
+   mCellSize = 1;
+   mGridX = mGridY = 0;
+   mColumns = mRows = 0;
+   mProxy->setMaterial(mMaterial);
+}
+
+float ParticleSystem::getInverseMass(float radius) const
+{
+   float mass = PI * radius * radius * mMaterial.density;
+   return mass > 0 ? 1 / mass : 0;
+}
+
+void ParticleSystem::setProxyRadius(float radius)
+{
+   std::shared_ptr<const Shape>& shape = mProxyShapes[radius];
+   if (!shape) shape = ShapeCache::getCircle(radius);
+   mProxy->setShape(shape);
+}
+
+void ParticleSystem::buildCells(float deltaTime, const Vec2f& gravity)
+{
+   unsigned n = mX.size();
+   mDeltaX.resize(n);
+   mDeltaY.resize(n);
+   for (unsigned i = 0; i < n; i++)
+   {
+      mDeltaX[i] = mX[i] + mVelocityX[i] * deltaTime;
+      mDeltaY[i] = mY[i] + mVelocityY[i] * deltaTime;
+   }
+
+   float minimumX = mDeltaX[0], minimumY = mDeltaY[0], maximumX = mDeltaX[0], maximumY = mDeltaY[0];
+   for (unsigned i = 1; i < n; i++)
+   {
+      minimumX = std::min(minimumX, mDeltaX[i]);
+      minimumY = std::min(minimumY, mDeltaY[i]);
+      maximumX = std::max(maximumX, mDeltaX[i]);
+      maximumY = std::max(maximumY, mDeltaY[i]);
+   }
+
+   //Cells as wide as the largest particle keep every contact within the
+   //neighbouring cells. They grow when particles are too spread out for the
+   //grid to stay in proportion to their number.
+   mCellSize = std::max(2 * mMaximumRadius, EPSILON);
+   while (true)
+   {
+      mColumns = (unsigned)std::min((maximumX - minimumX) / mCellSize, 65535.f) + 1;
+      mRows = (unsigned)std::min((maximumY - minimumY) / mCellSize, 65535.f) + 1;
+      if ((uint64_t)mColumns * mRows <= 8 * (uint64_t)n + 64) break;
+      mCellSize *= 2;
+   }
+   mGridX = minimumX;
+   mGridY = minimumY;
+
+   //Counting sort by cell. Each start ends up at the end of its cell, then
+   //everything is shifted back by one.
+   mCell.resize(n);
+   mCellStart.assign(mColumns * mRows + 1, 0);
+   for (unsigned i = 0; i < n; i++)
+   {
+      mCell[i] = getCellCoordinate(mDeltaY[i] - mGridY, mCellSize, mRows) * mColumns
+                 + getCellCoordinate(mDeltaX[i] - mGridX, mCellSize, mColumns);
+      mCellStart[mCell[i] + 1]++;
+   }
+   for (unsigned c = 1; c < mCellStart.size(); c++) mCellStart[c] += mCellStart[c - 1];
+   mOrder.resize(n);
+   for (unsigned i = 0; i < n; i++) mOrder[mCellStart[mCell[i]]++] = i;
+   for (unsigned c = mCellStart.size() - 1; c > 0; c--) mCellStart[c] = mCellStart[c - 1];
+   mCellStart[0] = 0;
+
+   FloatList* sorted[] = {&mSorted.x, &mSorted.y, &mSorted.previousX, &mSorted.previousY,
+                          &mSorted.radius, &mSorted.inverseMass};
+   const FloatList* source[] = {&mDeltaX, &mDeltaY, &mX, &mY, &mRadius, &mInverseMass};
+   for (unsigned list = 0; list < 6; list++)
+   {
+      //The padding lets the last lanes be loaded whole.
+      sorted[list]->assign(n + LANE_WIDTH, 0);
+      for (unsigned position = 0; position < n; position++)
+         (*sorted[list])[position] = (*source[list])[mOrder[position]];
+   }
+
+   //Mass scaling: a particle is treated as STACKING times heavier than one
+   //resting a diameter above it, so the particle solve carries a pile's
+   //weight down in a few iterations instead of one layer per iteration.
+   float length = std::sqrt(gravity * gravity);
+   if (length == 0 || mMaximumRadius <= 0)
+      return;
+   Vec2f up = gravity * (-1 / length);
+   float lowest = std::min(minimumX * up.x, maximumX * up.x) +
+                  std::min(minimumY * up.y, maximumY * up.y);
+   float rate = std::log(STACKING) / (2 * mMaximumRadius);
+   for (unsigned position = 0; position < n; position++)
+   {
+      float height = mSorted.x[position] * up.x + mSorted.y[position] * up.y - lowest;
+      mSorted.inverseMass[position] *= std::exp(std::min(rate * height, MAXIMUM_STACKING));
+   }
+}
+
+void ParticleSystem::findBodyContacts(World& world)
+{
+   mBodyContacts.clear();
+   RigidBody* proxy = mProxy.get();
+   bool hasRadius = false;
+   float gridWidth = mColumns * mCellSize, gridHeight = mRows * mCellSize;
+   for (unsigned b = 0; b < world.getNumberOfBodies(); b++)
+   {
+      RigidBody& body = world.getBody(b);
+      Shape::BoundingBox box = body.getShape().getBoundingBox(body.getTransform());
+      float lowX = box.lowerLeft.x - mMaximumRadius - mGridX;
+      float lowY = box.lowerLeft.y - mMaximumRadius - mGridY;
+      float highX = box.upperRight.x + mMaximumRadius - mGridX;
+      float highY = box.upperRight.y + mMaximumRadius - mGridY;
+      if (highX < 0 || highY < 0 || lowX > gridWidth || lowY > gridHeight) continue;
+
+      unsigned firstColumn = getCellCoordinate(lowX, mCellSize, mColumns);
+      unsigned lastColumn = getCellCoordinate(highX, mCellSize, mColumns);
+      unsigned firstRow = getCellCoordinate(lowY, mCellSize, mRows);
+      unsigned lastRow = getCellCoordinate(highY, mCellSize, mRows);
+      for (unsigned r = firstRow; r <= lastRow; r++)
+      {
+         unsigned end = mCellStart[r * mColumns + lastColumn + 1];
+         for (unsigned p = mCellStart[r * mColumns + firstColumn]; p < end; p++)
+         {
+            //One proxy stands in for every particle; its Shape only changes
+            //with the radius.
+            if (!hasRadius || proxy->getShape().getRadius() != mSorted.radius[p])
+            {
+               setProxyRadius(mSorted.radius[p]);
+               hasRadius = true;
+            }
+            Vec2f center(mSorted.x[p], mSorted.y[p]);
+            proxy->getTransform().setTranslation(center);
+            if (!Collision::checkBoundingBoxes(proxy, &body)) continue;
+
+            Collision collision(proxy, &body);
+            collision.solve();
+            for (unsigned i = 0; i < collision.getNumberOfContacts(); i++)
+            {
+               const Collision::ContactData& data = collision.getContactData(i);
+               BodyContact contact;
+               contact.body = &body;
+               contact.particle = p;
+               //Collision's normal points from the particle into the body.
+               contact.normal = data.normal * -1;
+               contact.lever = data.location - body.getTransform().getTranslation();
+               contact.particlePosition = center;
+               contact.bodyPosition = body.getTransform().getTranslation();
+               contact.penetration = data.penetration;
+               contact.friction = collision.getMixedKineticFriction();
+               mBodyContacts.push_back(contact);
+            }
+         }
+      }
+   }
+   //Only the radii of this step are kept, so removed particles free theirs.
+   mProxyShapes.clear();
+}
+
+void ParticleSystem::solveParticleContacts()
+{
+   unsigned n = mOrder.size();
+   Arrays arrays = {mSorted.x.data(), mSorted.y.data(), mSorted.previousX.data(),
+                    mSorted.previousY.data(), mSorted.radius.data(), mSorted.inverseMass.data()};
+
+   for (unsigned a = 0; a < n; a++)
+   {
+      unsigned cell = mCell[mOrder[a]];
+      unsigned column = cell % mColumns, row = cell / mColumns;
+      unsigned firstColumn = column > 0 ? column - 1 : 0;
+      unsigned lastColumn = std::min(column + 1, mColumns - 1);
+
+      //The neighbouring cells of a row are next to each other in cell order.
+      Lane deltaX(0), deltaY(0), contacts(0);
+      for (unsigned r = row > 0 ? row - 1 : 0; r <= std::min(row + 1, mRows - 1); r++)
+         accumulateCorrections(arrays, a, mCellStart[r * mColumns + firstColumn],
+                               mCellStart[r * mColumns + lastColumn + 1],
+                               mMaterial.kineticFriction, deltaX, deltaY, contacts);
+
+      //Each particle moves by the average of its corrections, over-relaxed,
+      //so that every particle can be corrected independently of the others.
+      float scale = RELAXATION / std::max(sum(contacts), RELAXATION);
+      mDeltaX[a] = sum(deltaX) * scale;
+      mDeltaY[a] = sum(deltaY) * scale;
+   }
+   for (unsigned a = 0; a < n; a++)
+   {
+      mSorted.x[a] += mDeltaX[a];
+      mSorted.y[a] += mDeltaY[a];
+   }
+}
+
+void ParticleSystem::solveBodyContacts(float deltaTime)
+{
+   for (BodyContact& contact : mBodyContacts)
+   {
+      RigidBody& body = *contact.body;
+      unsigned p = contact.particle;
+      Vec2f position(mSorted.x[p], mSorted.y[p]);
+      Vec2f bodyPosition = body.getTransform().getTranslation();
+
+      //The penetration found, less how far the two moved apart since.
+      Vec2f separation = position - contact.particlePosition - (bodyPosition - contact.bodyPosition);
+      float penetration = contact.penetration - separation * contact.normal;
+      if (penetration <= 0) continue;
+
+      //Only DYNAMIC bodies are pushed back, and only with TWO_WAY coupling.
+      float share = 1;
+      if (mCoupling == TWO_WAY && body.getType() == RigidBody::DYNAMIC)
+      {
+         float leverNormal = contact.lever % contact.normal;
+         float bodyInverseMass = body.getMassData().inverseMass
+                                 + leverNormal * leverNormal * body.getMassData().inverseInertia;
+         //The true mass here: the stacked one only holds between particles.
+         float inverseMass = mInverseMass[mOrder[p]];
+         share = inverseMass / std::max(inverseMass + bodyInverseMass, EPSILON);
+      }
+
+      //Sliding over the surface this step is cancelled up to the friction limit.
+      Vec2f surfaceVelocity = body.getPush(RigidBody::VELOCITY)
+                              + Vec2f(-contact.lever.y, contact.lever.x) * body.getTwist(RigidBody::VELOCITY);
+      Vec2f slide = position - Vec2f(mSorted.previousX[p], mSorted.previousY[p]) - surfaceVelocity * deltaTime;
+      Vec2f tangent(-contact.normal.y, contact.normal.x);
+      float limit = contact.friction * penetration;
+      float stop = std::max(-limit, std::min(slide * tangent, limit));
+
+      Vec2f push = (contact.normal * penetration - tangent * stop) * share;
+      mSorted.x[p] += push.x;
+      mSorted.y[p] += push.y;
+      contact.push += push;
+   }
+}
+
+void ParticleSystem::pushBodies(float deltaTime)
+{
+   for (const BodyContact& contact : mBodyContacts)
+   {
+      RigidBody& body = *contact.body;
+      if (body.getType() != RigidBody::DYNAMIC) continue;
+
+      //The momentum the particle gained from the body, given back to the body.
+      float inverseMass = mInverseMass[mOrder[contact.particle]];
+      if (inverseMass == 0 || contact.push * contact.push == 0) continue;
+      Vec2f impulse = contact.push * (-1 / (inverseMass * deltaTime));
+      body.applyPush(impulse);
+      body.applyTwist(contact.lever % impulse);
+   }
+}
+
+void ParticleSystem::step(World& world)
+{
+   unsigned n = mX.size();
+   if (n == 0) return;
+
+   float deltaTime = world.getDeltaTime();
+   Vec2f gravity = world.getGravity() * deltaTime;
+   for (unsigned i = 0; i < n; i++)
+   {
+      mVelocityX[i] += gravity.x;
+      mVelocityY[i] += gravity.y;
+   }
+
+   buildCells(deltaTime, world.getGravity());
+   mBodyContacts.clear();
+   if (mCoupling != NONE) findBodyContacts(world);
+   for (unsigned iteration = 0; iteration < mIterations; iteration++)
+   {
+      solveParticleContacts();
+      solveBodyContacts(deltaTime);
+   }
+   if (mCoupling == TWO_WAY) pushBodies(deltaTime);
+
+   float inverseDeltaTime = 1 / deltaTime;
+   for (unsigned a = 0; a < n; a++)
+   {
+      unsigned i = mOrder[a];
+      mVelocityX[i] = (mSorted.x[a] - mSorted.previousX[a]) * inverseDeltaTime;
+      mVelocityY[i] = (mSorted.y[a] - mSorted.previousY[a]) * inverseDeltaTime;
+      mX[i] = mSorted.x[a];
+      mY[i] = mSorted.y[a];
+   }
+}
+
+unsigned ParticleSystem::addParticle(const Vec2f& position, float radius, const Vec2f& velocity)
+{
+   mX.push_back(position.x);
+   mY.push_back(position.y);
+   mVelocityX.push_back(velocity.x);
+   mVelocityY.push_back(velocity.y);
+   mRadius.push_back(radius);
+   mInverseMass.push_back(getInverseMass(radius));
+   mMaximumRadius = std::max(mMaximumRadius, radius);
+   return mX.size() - 1;
+}
+
+void ParticleSystem::removeParticle(unsigned i)
+{
+   FloatList* lists[] = {&mX, &mY, &mVelocityX, &mVelocityY, &mRadius, &mInverseMass};
+   for (FloatList* list : lists)
+   {
+      (*list)[i] = list->back();
+      list->pop_back();
+   }
+}
+
+void ParticleSystem::clear()
+{
+   FloatList* lists[] = {&mX, &mY, &mVelocityX, &mVelocityY, &mRadius, &mInverseMass};
+   for (FloatList* list : lists) list->clear();
+   mProxyShapes.clear();
+   mMaximumRadius = 0;
+}
+
+unsigned ParticleSystem::getNumberOfParticles() const
+{
+   return mX.size();
+}
+
+Vec2f ParticleSystem::getPosition(unsigned i) const
+{
+   return Vec2f(mX[i], mY[i]);
+}
+
+Vec2f ParticleSystem::getVelocity(unsigned i) const
+{
+   return Vec2f(mVelocityX[i], mVelocityY[i]);
+}
+
+float ParticleSystem::getRadius(unsigned i) const
+{
+   return mRadius[i];
+}
+
+const float* ParticleSystem::getPositionsX() const
+{
+   return mX.data();
+}
+
+const float* ParticleSystem::getPositionsY() const
+{
+   return mY.data();
+}
+
+const float* ParticleSystem::getRadii() const
+{
+   return mRadius.data();
+}
+
+void ParticleSystem::setPosition(unsigned i, const Vec2f& position)
+{
+   mX[i] = position.x;
+   mY[i] = position.y;
+}
+
+void ParticleSystem::setVelocity(unsigned i, const Vec2f& velocity)
+{
+   mVelocityX[i] = velocity.x;
+   mVelocityY[i] = velocity.y;
+}
+
+const RigidBody::Material& ParticleSystem::getMaterial() const
+{
+   return mMaterial;
+}
+
+void ParticleSystem::setMaterial(const RigidBody::Material& material)
+{
+   mMaterial = material;
+   mProxy->setMaterial(material);
+   for (unsigned i = 0; i < mRadius.size(); i++) mInverseMass[i] = getInverseMass(mRadius[i]);
+}
+
+ParticleSystem::Coupling ParticleSystem::getCoupling() const
+{
+   return mCoupling;
+}
+
+void ParticleSystem::setCoupling(Coupling coupling)
+{
+   mCoupling = coupling;
+}
+
+unsigned ParticleSystem::getIterations() const
+{
+   return mIterations;
+}
+
+void ParticleSystem::setIterations(unsigned iterations)
+{
+   mIterations = iterations;
+}
+
+}
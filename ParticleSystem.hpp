@@ -0,0 +1,322 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_PARTICLE_SYSTEM_HPP_
+#define FZX_PARTICLE_SYSTEM_HPP_
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "Memory.hpp"
+#include "RigidBody.hpp"
+#include "Vec2.hpp"
+
+namespace fzx
+{
+
+class World;
+
+/**
+ * A large number of small circles that don't rotate, for granular media such
+ * as sand, debris or coins.
+ *
+ * Particles are stored as arrays of positions, velocities and radii rather than
+ * as RigidBodys. Each step they are sorted into a grid of cells as wide as the
+ * largest particle, so a particle only looks at the particles of its own and
+ * the eight surrounding cells, which lie in three runs of the sorted arrays.
+ *
+ * Contacts are solved on positions: particles are moved to where their
+ * velocity takes them, pulled out of each other and of RigidBodys a few times,
+ * and given the velocity that got them there. Overlaps between particles are
+ * measured several lanes at a time. Contacts with the RigidBodys of a World are
+ * found by Collision, as for a Circle body. Between particles, lower ones
+ * count as heavier than the ones resting on them, so the weight of a pile
+ * reaches its bottom in fewer iterations.
+ *
+ * All particles share one Material. Collisions between particles are
+ * inelastic, so its restitution is unused.
+ */
+class ParticleSystem
+{
+public:
+   /**
+    * How particles and RigidBodys affect each other.
+    *
+    * NONE means particles pass through RigidBodys.
+    *
+    * ONE_WAY means RigidBodys push particles but particles don't push back.
+    *
+    * TWO_WAY means both push each other.
+    */
+   enum Coupling
+   {
+      NONE, ONE_WAY, TWO_WAY
+   };
+
+   typedef std::vector<float, TrackingAllocator<float, Memory::PARTICLES>> FloatList;
+   typedef std::vector<unsigned, TrackingAllocator<unsigned, Memory::PARTICLES>> IndexList;
+private:
+   /**
+    * The particles in cell order, padded so a whole set of lanes can always
+    * be loaded.
+    */
+   struct Sorted
+   {
+      FloatList x, y; ///< The positions being solved for.
+      FloatList previousX, previousY; ///< The positions at the start of the step.
+      FloatList radius, inverseMass;
+   };
+
+   /**
+    * A contact between a particle and a RigidBody, found by Collision.
+    */
+   struct BodyContact
+   {
+      RigidBody* body; ///< The RigidBody touched.
+      unsigned particle; ///< The particle, by position in cell order.
+      Vec2f normal; ///< The unit vector from the body towards the particle.
+      Vec2f lever; ///< The vector from the center of the body to the contact.
+      Vec2f particlePosition; ///< The position of the particle when the contact was found.
+      Vec2f bodyPosition; ///< The position of the body when the contact was found.
+      Vec2f push; ///< The total displacement the body gave the particle this step.
+      float penetration; ///< How deep the particle was in the body.
+      float friction; ///< The mixed kinetic friction of the two materials.
+   };
+
+   FloatList mX; ///< The x position of each particle.
+   FloatList mY; ///< The y position of each particle.
+   FloatList mVelocityX; ///< The x velocity of each particle.
+   FloatList mVelocityY; ///< The y velocity of each particle.
+   FloatList mRadius; ///< The radius of each particle.
+   FloatList mInverseMass; ///< The inverse mass of each particle.
+
+   Sorted mSorted; ///< The particles in cell order, during a step.
+   IndexList mOrder; ///< The particle at each position of the cell order.
+   IndexList mCell; ///< The cell of each particle.
+   IndexList mCellStart; ///< The first position of each cell in cell order, and the end.
+   FloatList mDeltaX; ///< The change in x accumulated by an iteration.
+   FloatList mDeltaY; ///< The change in y accumulated by an iteration.
+   std::vector<BodyContact, TrackingAllocator<BodyContact, Memory::PARTICLES>> mBodyContacts; ///< The contacts with RigidBodys this step.
+
+   RigidBody::Material mMaterial; ///< The material of every particle.
+   std::unique_ptr<RigidBody> mProxy; ///< Stands in for a particle in a Collision with a RigidBody.
+   std::map<float, std::shared_ptr<const Shape>> mProxyShapes; ///< The proxy's Shape for each radius met in findBodyContacts.
+   Coupling mCoupling; ///< How particles and RigidBodys affect each other.
+   unsigned mIterations; ///< The number of solver iterations per step.
+   float mMaximumRadius; ///< The radius of the largest particle.
+   float mCellSize; ///< The width of a cell.
+   float mGridX, mGridY; ///< The lower left corner of the grid.
+   unsigned mColumns, mRows; ///< The size of the grid.
+
+   /**
+    * Calculates the inverse mass of a particle from its radius.
+    */
+   float getInverseMass(float radius) const;
+
+   /**
+    * Gives the proxy the Shape of a particle of a radius.
+    */
+   void setProxyRadius(float radius);
+
+   /**
+    * Sorts the particles into cells by the positions they are headed to.
+    */
+   void buildCells(float deltaTime, const Vec2f& gravity);
+
+   /**
+    * Finds the contacts between the particles and the RigidBodys of a World.
+    */
+   void findBodyContacts(World& world);
+
+   /**
+    * Moves overlapping particles apart, once.
+    */
+   void solveParticleContacts();
+
+   /**
+    * Moves particles out of the RigidBodys they overlap, once.
+    */
+   void solveBodyContacts(float deltaTime);
+
+   /**
+    * Pushes the RigidBodys back, with TWO_WAY coupling.
+    */
+   void pushBodies(float deltaTime);
+public:
+   /**
+    * Creates an empty ParticleSystem.
+    *
+    * The material has a density of 1, some friction and little bounce. The
+    * coupling is TWO_WAY, with 4 iterations per step.
+    */
+   ParticleSystem();
+
+   /**
+    * Steps the particles forward by the World's delta time.
+    *
+    * Applies the World's gravity and collides the particles with each other and
+    * with the World's RigidBodys. Call it after each World::step().
+    *
+    * @param world The World the particles live in.
+    */
+   void step(World& world);
+
+   /**
+    * Adds a particle.
+    *
+    * @param  position The position of the particle.
+    * @param  radius The radius of the particle, more than zero.
+    * @param  velocity The velocity of the particle.
+    * @return The index of the particle.
+    */
+   unsigned addParticle(const Vec2f& position, float radius, const Vec2f& velocity = Vec2f());
+
+   /**
+    * Removes a particle by moving the last particle into its place.
+    *
+    * @param i The index of the particle.
+    */
+   void removeParticle(unsigned i);
+
+   /**
+    * Removes every particle.
+    */
+   void clear();
+
+   /**
+    * Returns the number of particles.
+    *
+    * @return The number of particles.
+    */
+   unsigned getNumberOfParticles() const;
+
+   /**
+    * Returns the position of a particle.
+    *
+    * @param  i The index of the particle.
+    * @return The position of the particle.
+    */
+   Vec2f getPosition(unsigned i) const;
+
+   /**
+    * Returns the velocity of a particle.
+    *
+    * @param  i The index of the particle.
+    * @return The velocity of the particle.
+    */
+   Vec2f getVelocity(unsigned i) const;
+
+   /**
+    * Returns the radius of a particle.
+    *
+    * @param  i The index of the particle.
+    * @return The radius of the particle.
+    */
+   float getRadius(unsigned i) const;
+
+   /**
+    * Returns the x positions of every particle, for drawing many at once.
+    *
+    * @return An array of getNumberOfParticles() floats.
+    */
+   const float* getPositionsX() const;
+
+   /**
+    * Returns the y positions of every particle, for drawing many at once.
+    *
+    * @return An array of getNumberOfParticles() floats.
+    */
+   const float* getPositionsY() const;
+
+   /**
+    * Returns the radii of every particle, for drawing many at once.
+    *
+    * @return An array of getNumberOfParticles() floats.
+    */
+   const float* getRadii() const;
+
+   /**
+    * Sets the position of a particle.
+    *
+    * @param i The index of the particle.
+    * @param position The new position.
+    */
+   void setPosition(unsigned i, const Vec2f& position);
+
+   /**
+    * Sets the velocity of a particle.
+    *
+    * @param i The index of the particle.
+    * @param velocity The new velocity.
+    */
+   void setVelocity(unsigned i, const Vec2f& velocity);
+
+   /**
+    * Returns the material shared by every particle.
+    *
+    * @return A constant reference to the Material.
+    */
+   const RigidBody::Material& getMaterial() const;
+
+   /**
+    * Sets the material shared by every particle, and updates their masses.
+    *
+    * @param material The new Material.
+    */
+   void setMaterial(const RigidBody::Material& material);
+
+   /**
+    * Returns how particles and RigidBodys affect each other.
+    *
+    * @return The Coupling.
+    */
+   Coupling getCoupling() const;
+
+   /**
+    * Sets how particles and RigidBodys affect each other.
+    *
+    * @param coupling The new Coupling.
+    */
+   void setCoupling(Coupling coupling);
+
+   /**
+    * Returns the number of solver iterations per step.
+    *
+    * @return The number of iterations.
+    */
+   unsigned getIterations() const;
+
+   /**
+    * Sets the number of solver iterations per step.
+    *
+    * @param iterations The new number of iterations.
+    */
+   void setIterations(unsigned iterations);
+};
+
+}
+
+#endif /*FZX_PARTICLE_SYSTEM_HPP_*/
@@ -0,0 +1,204 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "PerfCounters.hpp"
+
+#ifdef __linux__
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace fzx
+{
+
+namespace
+{
+
+/**
+ * Subtracts two totals, giving zero instead of wrapping around when the
+ * scaling of a multiplexed reading made the later total smaller.
+ */
+uint64_t subtract(uint64_t a, uint64_t b)
+{
+   return a > b ? a - b : 0;
+}
+
+}
+
+HardwareCounters HardwareCounters::operator-(const HardwareCounters& other) const
+{
+   HardwareCounters output;
+   output.cycles = subtract(cycles, other.cycles);
+   output.instructions = subtract(instructions, other.instructions);
+   output.l1Misses = subtract(l1Misses, other.l1Misses);
+   output.llcMisses = subtract(llcMisses, other.llcMisses);
+   output.branchMisses = subtract(branchMisses, other.branchMisses);
+   return output;
+}
+
+HardwareCounters& HardwareCounters::operator+=(const HardwareCounters& other)
+{
+   cycles += other.cycles;
+   instructions += other.instructions;
+   l1Misses += other.l1Misses;
+   llcMisses += other.llcMisses;
+   branchMisses += other.branchMisses;
+   return *this;
+}
+
+PerfCounters::PerfCounters() : mLeader(-1)
+{
+   for (int& file : mFiles) file = -1;
+}
+
+PerfCounters::~PerfCounters()
+{
+   close();
+}
+
+#ifdef __linux__
+
+namespace
+{
+
+/**
+ * Opens a counter in the group of a leader, or as the disabled leader of a
+ * new group if there is none yet.
+ */
+int openCounter(uint32_t type, uint64_t config, int leader)
+{
+   perf_event_attr attributes;
+   std::memset(&attributes, 0, sizeof(attributes));
+   attributes.size = sizeof(attributes);
+   attributes.type = type;
+   attributes.config = config;
+   attributes.disabled = leader < 0;
+   attributes.exclude_kernel = 1;
+   attributes.exclude_hv = 1;
+   attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                            PERF_FORMAT_TOTAL_TIME_RUNNING;
+   //Count the calling thread on whichever CPU it runs.
+   return (int)syscall(__NR_perf_event_open, &attributes, 0, -1, leader, 0);
+}
+
+}
+
+bool PerfCounters::open()
+{
+   close();
+   const uint64_t l1ReadMisses = PERF_COUNT_HW_CACHE_L1D |
+                                 (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                 (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+   const uint32_t types[NUMBER_OF_COUNTERS] = {PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                                PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE,
+                                                PERF_TYPE_HARDWARE};
+   const uint64_t configs[NUMBER_OF_COUNTERS] = {PERF_COUNT_HW_CPU_CYCLES,
+                                                 PERF_COUNT_HW_INSTRUCTIONS, l1ReadMisses,
+                                                 PERF_COUNT_HW_CACHE_MISSES,
+                                                 PERF_COUNT_HW_BRANCH_MISSES};
+   //Counters that can't be opened are left out of the group, so the group
+   //reads the open ones in the order of Counter.
+   for (unsigned i = 0; i < NUMBER_OF_COUNTERS; i++)
+   {
+      mFiles[i] = openCounter(types[i], configs[i], mLeader);
+      if (mLeader < 0) mLeader = mFiles[i];
+   }
+   if (mLeader < 0) return false;
+
+   ioctl(mLeader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+   ioctl(mLeader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+   return true;
+}
+
+void PerfCounters::close()
+{
+   for (int& file : mFiles)
+   {
+      if (file >= 0) ::close(file);
+      file = -1;
+   }
+   mLeader = -1;
+}
+
+HardwareCounters PerfCounters::read() const
+{
+   uint64_t totals[NUMBER_OF_COUNTERS] = {};
+   //The number of counters, the time enabled and the time actually
+   //counting, then the value of each counter in the group.
+   uint64_t values[3 + NUMBER_OF_COUNTERS];
+   ssize_t size = mLeader < 0 ? -1 : ::read(mLeader, values, sizeof(values));
+   if (size >= (ssize_t)(3 * sizeof(uint64_t)) && values[2] > 0 &&
+       size == (ssize_t)((3 + values[0]) * sizeof(uint64_t)))
+   {
+      double scale = values[2] < values[1] ? (double)values[1] / values[2] : 1;
+      unsigned value = 3;
+      for (unsigned i = 0; i < NUMBER_OF_COUNTERS; i++)
+      {
+         if (mFiles[i] < 0) continue;
+         totals[i] = scale == 1 ? values[value] : (uint64_t)(values[value] * scale);
+         value++;
+      }
+   }
+
+   HardwareCounters output;
+   output.cycles = totals[CYCLES];
+   output.instructions = totals[INSTRUCTIONS];
+   output.l1Misses = totals[L1_MISSES];
+   output.llcMisses = totals[LLC_MISSES];
+   output.branchMisses = totals[BRANCH_MISSES];
+   return output;
+}
+
+#else
+
+bool PerfCounters::open()
+{
+   return false;
+}
+
+void PerfCounters::close() {}
+
+HardwareCounters PerfCounters::read() const
+{
+   return HardwareCounters();
+}
+
+#endif
+
+bool PerfCounters::isAvailable() const
+{
+   for (int file : mFiles) if (file >= 0) return true;
+   return false;
+}
+
+bool PerfCounters::isAvailable(Counter counter) const
+{
+   return mFiles[counter] >= 0;
+}
+
+}
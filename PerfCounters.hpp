@@ -0,0 +1,132 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_PERF_COUNTERS_HPP_
+#define FZX_PERF_COUNTERS_HPP_
+
+#include <cstdint>
+
+namespace fzx
+{
+
+/**
+ * The values of the hardware performance counters over some span of code.
+ */
+struct HardwareCounters
+{
+   uint64_t cycles; ///< CPU cycles.
+   uint64_t instructions; ///< Instructions retired.
+   uint64_t l1Misses; ///< Level 1 data cache read misses.
+   uint64_t llcMisses; ///< Last level cache misses.
+   uint64_t branchMisses; ///< Mispredicted branches.
+
+   /**
+    * Creates a HardwareCounters with every counter at zero.
+    */
+   HardwareCounters() : cycles(0), instructions(0), l1Misses(0), llcMisses(0), branchMisses(0) {}
+
+   HardwareCounters operator-(const HardwareCounters& other) const;
+   HardwareCounters& operator+=(const HardwareCounters& other);
+};
+
+/**
+ * Reads the hardware performance counters of the calling thread through Linux
+ * perf_event_open.
+ *
+ * Counters are often unavailable, for example in restricted containers,
+ * virtual machines or on other operating systems. Each counter that can't be
+ * opened simply reads as zero, and isAvailable() tells whether any could.
+ */
+class PerfCounters
+{
+public:
+   /**
+    * The counters that are read.
+    */
+   enum Counter
+   {
+      CYCLES, INSTRUCTIONS, L1_MISSES, LLC_MISSES, BRANCH_MISSES, NUMBER_OF_COUNTERS
+   };
+private:
+   int mFiles[NUMBER_OF_COUNTERS]; ///< The file descriptor of each counter, or -1.
+   int mLeader; ///< The first counter opened, which reads the whole group, or -1.
+
+   //The file descriptors can't be shared between copies.
+   PerfCounters(const PerfCounters&);
+   PerfCounters& operator=(const PerfCounters&);
+public:
+   /**
+    * Creates a PerfCounters with no counters open.
+    */
+   PerfCounters();
+
+   /**
+    * Closes the counters.
+    */
+   ~PerfCounters();
+
+   /**
+    * Opens and starts the counters for the calling thread.
+    *
+    * @return Whether at least one counter could be opened.
+    */
+   bool open();
+
+   /**
+    * Closes every counter.
+    */
+   void close();
+
+   /**
+    * Checks whether at least one counter is open.
+    *
+    * @return Whether any counter is available.
+    */
+   bool isAvailable() const;
+
+   /**
+    * Checks whether a specific counter is open.
+    *
+    * @param  counter The counter to check.
+    * @return Whether the counter is available.
+    */
+   bool isAvailable(Counter counter) const;
+
+   /**
+    * Reads the running totals of every counter.
+    *
+    * The counters are one group, so they count over the same span and are
+    * read together. Totals are scaled up when the kernel had to multiplex
+    * the group. Subtract two readings to get the counts of the code between
+    * them.
+    *
+    * @return The current totals, with unavailable counters at zero.
+    */
+   HardwareCounters read() const;
+};
+
+}
+
+#endif /*FZX_PERF_COUNTERS_HPP_*/
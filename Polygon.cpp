@@ -6,7 +6,7 @@ namespace fzx
 
 Polygon::Polygon(std::vector<Vec2f> vertices)
 {
-   mVertices = vertices;
+   mVertices.assign(vertices.begin(), vertices.end());
 
    if(mVertices.size() < 3) mVertices.push_back(Vec2f(-1, -1));
    if(mVertices.size() < 3) mVertices.push_back(Vec2f(2, -1));
@@ -33,6 +33,7 @@ Polygon::Polygon(std::vector<Vec2f> vertices)
    for (Vec2f vector : mVertices) vector -= sum;
 
    calculateNormals();
+   calculateProperties();
 }
 
 Polygon::Polygon()
@@ -42,6 +43,7 @@ Polygon::Polygon()
    mVertices.push_back(Vec2f(-1, 2));
 
    calculateNormals();
+   calculateProperties();
 }
 
 void Polygon::calculateNormals()
@@ -59,47 +61,23 @@ void Polygon::calculateNormals()
    }
 }
 
-float Polygon::getRadius() const
+void Polygon::calculateProperties()
 {
    float largestSquareMagnitude = 0;
    for (Vec2f vector : mVertices)
       if (largestSquareMagnitude < vector.getMagnitudeSquared())
          largestSquareMagnitude = vector.getMagnitudeSquared();
-   return std::sqrt(largestSquareMagnitude);
-}
+   mRadius = std::sqrt(largestSquareMagnitude);
 
-float Polygon::getArea() const
-{
    float area = 0;
-
    for (unsigned i = 1; i < mVertices.size(); i++)
    {
       area += std::abs(mVertices[i] % mVertices[i-1]);
    }
    area += std::abs(mVertices[0] % mVertices[mVertices.size() - 1]);
+   mArea = area / 2;
 
-   return area / 2;
-}
-
-const Vec2f& Polygon::getVertix(unsigned index) const
-{
-   return mVertices[index];
-}
-
-const Vec2f& Polygon::getNormal(unsigned index) const
-{
-   return mNormals[index];
-}
-
-unsigned int Polygon::getNumberOfVertices() const
-{
-   return mVertices.size();
-}
-
-float Polygon::getInertiaPerMass() const
-{
    float moment = 0;
-
    for (unsigned i = 1; i <= mVertices.size(); i++)
    {
       Vec2f vertexA, vertexB;
@@ -129,13 +107,44 @@ float Polygon::getInertiaPerMass() const
 
       moment += std::abs(partialMoment);
    }
+   mInertiaPerMass = moment;
+}
 
-   return moment;
+float Polygon::getRadius() const
+{
+   return mRadius;
+}
+
+float Polygon::getArea() const
+{
+   return mArea;
+}
+
+const Vec2f& Polygon::getVertix(unsigned index) const
+{
+   return mVertices[index];
+}
+
+const Vec2f& Polygon::getNormal(unsigned index) const
+{
+   return mNormals[index];
+}
+
+unsigned int Polygon::getNumberOfVertices() const
+{
+   return mVertices.size();
+}
+
+float Polygon::getInertiaPerMass() const
+{
+   return mInertiaPerMass;
 }
 
 Shape::BoundingBox Polygon::getBoundingBox(const Transform& transform) const
 {
+   //Start from a vertex, the default box would always include the origin.
    BoundingBox boundry;
+   boundry.lowerLeft = boundry.upperRight = transform.apply(mVertices[0]);
    for (Vec2f vertex : mVertices)
    {
       vertex = transform.apply(vertex);
@@ -27,6 +27,7 @@
 #define FZX_POLYGON_HPP_
 
 #include <vector>
+#include "Memory.hpp"
 #include "Shape.hpp"
 
 namespace fzx
@@ -37,14 +38,25 @@ namespace fzx
  */
 class Polygon : public Shape
 {
+public:
+   typedef std::vector<Vec2f, TrackingAllocator<Vec2f, Memory::VERTICES>> VertexList;
 private:
-   std::vector<Vec2f> mVertices; ///< The vertices of the shape in counterclockwise order.
-   std::vector<Vec2f> mNormals; ///< The normals of all the sides.
+   VertexList mVertices; ///< The vertices of the shape in counterclockwise order.
+   VertexList mNormals; ///< The normals of all the sides.
+   float mRadius; ///< The distance to the farthest vertex.
+   float mArea; ///< The area enclosed by the vertices.
+   float mInertiaPerMass; ///< The moment of inertia per mass.
 
    /**
     * Calculates the normals of the sides.
     */
    void calculateNormals();
+
+   /**
+    * Calculates the radius, area and inertia per mass once, since the
+    * vertices never change after construction.
+    */
+   void calculateProperties();
 public:
    /**
     * Creates a Polygon with the given vertices.
@@ -0,0 +1,217 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "Profiler.hpp"
+
+#include <algorithm>
+
+namespace fzx
+{
+
+StepStats::StepStats() :
+   stepTime(0), candidatePairs(0), collisions(0), contacts(0), awakeBodies(0)
+{
+   std::fill(phaseTimes, phaseTimes + NUMBER_OF_PHASES, 0.0);
+   std::fill(pairTimes, pairTimes + NUMBER_OF_PAIRS, 0.0);
+   std::fill(pairCounts, pairCounts + NUMBER_OF_PAIRS, 0u);
+}
+
+StepStats::Pair StepStats::getPair(Shape::ShapeType a, Shape::ShapeType b)
+{
+   if (a > b) std::swap(a, b);
+   if (a == Shape::CIRCLE)
+   {
+      if (b == Shape::CIRCLE) return CIRCLE_VS_CIRCLE;
+      if (b == Shape::RECTANGLE) return CIRCLE_VS_RECTANGLE;
+      return CIRCLE_VS_POLYGON;
+   }
+   if (a == Shape::RECTANGLE)
+   {
+      if (b == Shape::RECTANGLE) return RECTANGLE_VS_RECTANGLE;
+      return RECTANGLE_VS_POLYGON;
+   }
+   return POLYGON_VS_POLYGON;
+}
+
+StepProfiler::StepProfiler(unsigned historySize) :
+   mHistorySize(historySize > 0 ? historySize : 1), mNext(0), mNumberOfSteps(0), mCounters(0),
+   mDepth(0) {}
+
+void StepProfiler::setPerfCounters(const PerfCounters* counters)
+{
+   mCounters = counters;
+}
+
+const PerfCounters* StepProfiler::getPerfCounters() const
+{
+   if (mCounters != 0 && mCounters->isAvailable()) return mCounters;
+   return 0;
+}
+
+void StepProfiler::beginStep()
+{
+   if (mDepth++ > 0) return;
+   mCurrent = StepStats();
+   mStepStart = Clock::now();
+}
+
+void StepProfiler::endStep()
+{
+   if (mDepth == 0 || --mDepth > 0) return;
+   mCurrent.stepTime = std::chrono::duration<double, std::micro>(
+      Clock::now() - mStepStart).count();
+   if (mHistory.empty()) mHistory.resize(mHistorySize);
+   mHistory[mNext] = mCurrent;
+   mNext = (mNext + 1) % mHistory.size();
+   if (mNumberOfSteps < mHistory.size()) mNumberOfSteps++;
+}
+
+StepStats& StepProfiler::getCurrent()
+{
+   return mCurrent;
+}
+
+const StepStats& StepProfiler::getLast() const
+{
+   static const StepStats empty;
+   if (mNumberOfSteps == 0) return empty;
+   return getHistory(0);
+}
+
+const StepStats& StepProfiler::getHistory(unsigned age) const
+{
+   unsigned size = mHistory.size();
+   if (size == 0) return getLast();
+   return mHistory[(mNext + size - 1 - age % size) % size];
+}
+
+unsigned StepProfiler::getNumberOfSteps() const
+{
+   return mNumberOfSteps;
+}
+
+StepStats StepProfiler::getAverage() const
+{
+   StepStats average;
+   if (mNumberOfSteps == 0) return average;
+
+   double stepTime = 0;
+   double candidatePairs = 0, collisions = 0, contacts = 0, awakeBodies = 0;
+   double pairCounts[StepStats::NUMBER_OF_PAIRS] = {};
+   HardwareCounters phaseCounters[StepStats::NUMBER_OF_PHASES];
+   for (unsigned age = 0; age < mNumberOfSteps; age++)
+   {
+      const StepStats& stats = getHistory(age);
+      stepTime += stats.stepTime;
+      for (unsigned i = 0; i < StepStats::NUMBER_OF_PHASES; i++)
+      {
+         average.phaseTimes[i] += stats.phaseTimes[i] / mNumberOfSteps;
+         phaseCounters[i] += stats.phaseCounters[i];
+      }
+      for (unsigned i = 0; i < StepStats::NUMBER_OF_PAIRS; i++)
+      {
+         average.pairTimes[i] += stats.pairTimes[i] / mNumberOfSteps;
+         pairCounts[i] += stats.pairCounts[i];
+      }
+      candidatePairs += stats.candidatePairs;
+      collisions += stats.collisions;
+      contacts += stats.contacts;
+      awakeBodies += stats.awakeBodies;
+   }
+
+   average.stepTime = stepTime / mNumberOfSteps;
+   for (unsigned i = 0; i < StepStats::NUMBER_OF_PHASES; i++)
+   {
+      HardwareCounters& counters = average.phaseCounters[i];
+      counters.cycles = phaseCounters[i].cycles / mNumberOfSteps;
+      counters.instructions = phaseCounters[i].instructions / mNumberOfSteps;
+      counters.l1Misses = phaseCounters[i].l1Misses / mNumberOfSteps;
+      counters.llcMisses = phaseCounters[i].llcMisses / mNumberOfSteps;
+      counters.branchMisses = phaseCounters[i].branchMisses / mNumberOfSteps;
+   }
+   for (unsigned i = 0; i < StepStats::NUMBER_OF_PAIRS; i++)
+      average.pairCounts[i] = pairCounts[i] / mNumberOfSteps;
+   average.candidatePairs = candidatePairs / mNumberOfSteps;
+   average.collisions = collisions / mNumberOfSteps;
+   average.contacts = contacts / mNumberOfSteps;
+   average.awakeBodies = awakeBodies / mNumberOfSteps;
+   return average;
+}
+
+StepStats StepProfiler::getMaximum() const
+{
+   StepStats maximum;
+   for (unsigned age = 0; age < mNumberOfSteps; age++)
+   {
+      const StepStats& stats = getHistory(age);
+      maximum.stepTime = std::max(maximum.stepTime, stats.stepTime);
+      for (unsigned i = 0; i < StepStats::NUMBER_OF_PHASES; i++)
+      {
+         maximum.phaseTimes[i] = std::max(maximum.phaseTimes[i], stats.phaseTimes[i]);
+         HardwareCounters& counters = maximum.phaseCounters[i];
+         const HardwareCounters& other = stats.phaseCounters[i];
+         counters.cycles = std::max(counters.cycles, other.cycles);
+         counters.instructions = std::max(counters.instructions, other.instructions);
+         counters.l1Misses = std::max(counters.l1Misses, other.l1Misses);
+         counters.llcMisses = std::max(counters.llcMisses, other.llcMisses);
+         counters.branchMisses = std::max(counters.branchMisses, other.branchMisses);
+      }
+      for (unsigned i = 0; i < StepStats::NUMBER_OF_PAIRS; i++)
+      {
+         maximum.pairTimes[i] = std::max(maximum.pairTimes[i], stats.pairTimes[i]);
+         maximum.pairCounts[i] = std::max(maximum.pairCounts[i], stats.pairCounts[i]);
+      }
+      maximum.candidatePairs = std::max(maximum.candidatePairs, stats.candidatePairs);
+      maximum.collisions = std::max(maximum.collisions, stats.collisions);
+      maximum.contacts = std::max(maximum.contacts, stats.contacts);
+      maximum.awakeBodies = std::max(maximum.awakeBodies, stats.awakeBodies);
+   }
+   return maximum;
+}
+
+void StepProfiler::clear()
+{
+   mNext = 0;
+   mNumberOfSteps = 0;
+}
+
+ScopedPhaseProfile::ScopedPhaseProfile(StepProfiler& profiler, StepStats::Phase phase) :
+   mProfiler(profiler), mPhase(phase)
+{
+   if (const PerfCounters* counters = profiler.getPerfCounters())
+      mStartCounters = counters->read();
+   mStart = StepProfiler::Clock::now();
+}
+
+ScopedPhaseProfile::~ScopedPhaseProfile()
+{
+   StepStats& stats = mProfiler.getCurrent();
+   stats.phaseTimes[mPhase] += std::chrono::duration<double, std::micro>(
+      StepProfiler::Clock::now() - mStart).count();
+   if (const PerfCounters* counters = mProfiler.getPerfCounters())
+      stats.phaseCounters[mPhase] += counters->read() - mStartCounters;
+}
+
+}
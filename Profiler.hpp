@@ -0,0 +1,290 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_PROFILER_HPP_
+#define FZX_PROFILER_HPP_
+
+#include <chrono>
+#include <vector>
+
+#include "PerfCounters.hpp"
+#include "Shape.hpp"
+
+namespace fzx
+{
+
+/**
+ * The timings and counters of one World::step().
+ *
+ * Times are in microseconds. The hardware counters stay at zero unless the
+ * StepProfiler was given open PerfCounters.
+ */
+struct StepStats
+{
+   /**
+    * The phases of a step.
+    */
+   enum Phase
+   {
+      BROAD_PHASE, NARROW_PHASE, VELOCITY_ITERATIONS, POSITION_CORRECTION, INTEGRATION,
+      NUMBER_OF_PHASES
+   };
+
+   /**
+    * The shape pair routines of the narrow phase.
+    */
+   enum Pair
+   {
+      CIRCLE_VS_CIRCLE, CIRCLE_VS_RECTANGLE, CIRCLE_VS_POLYGON,
+      RECTANGLE_VS_RECTANGLE, RECTANGLE_VS_POLYGON, POLYGON_VS_POLYGON,
+      NUMBER_OF_PAIRS
+   };
+
+   double stepTime; ///< The time of the whole step.
+   double phaseTimes[NUMBER_OF_PHASES]; ///< The time spent in each phase.
+   HardwareCounters phaseCounters[NUMBER_OF_PHASES]; ///< The hardware counts of each phase.
+   double pairTimes[NUMBER_OF_PAIRS]; ///< The time spent in each pair routine.
+   unsigned pairCounts[NUMBER_OF_PAIRS]; ///< The number of calls to each pair routine.
+   unsigned candidatePairs; ///< The pairs the broad phase let through.
+   unsigned collisions; ///< The pairs the narrow phase confirmed.
+   unsigned contacts; ///< The contact points of the confirmed pairs.
+   unsigned awakeBodies; ///< The bodies that were integrated.
+
+   /**
+    * Creates a StepStats with every time and counter at zero.
+    */
+   StepStats();
+
+   /**
+    * Returns the pair routine used for two ShapeTypes, in either order.
+    *
+    * @param  a The ShapeType of the first Shape.
+    * @param  b The ShapeType of the second Shape.
+    * @return The Pair of the two types.
+    */
+   static Pair getPair(Shape::ShapeType a, Shape::ShapeType b);
+};
+
+/**
+ * Collects StepStats for every step and keeps a rolling history of them.
+ *
+ * The World calls it through the FZX_PROFILE_* macros, which compile to
+ * nothing unless FZX_PROFILE is defined.
+ */
+class StepProfiler
+{
+public:
+   typedef std::chrono::steady_clock Clock;
+private:
+   std::vector<StepStats> mHistory; ///< The finished steps, as a ring, allocated by the first one.
+   unsigned mHistorySize; ///< The number of steps kept in the history.
+   StepStats mCurrent; ///< The step being profiled.
+   Clock::time_point mStepStart; ///< When the current step began.
+   unsigned mNext; ///< The slot of mHistory the next step goes in.
+   unsigned mNumberOfSteps; ///< The number of finished steps in mHistory.
+   const PerfCounters* mCounters; ///< The counters read around each phase, or null.
+   unsigned mDepth; ///< The beginStep() calls not yet matched by an endStep().
+public:
+   /**
+    * Creates a StepProfiler that remembers a given number of steps.
+    *
+    * Nothing is allocated until the first step ends, so a World that isn't
+    * profiled only pays for the StepProfiler itself.
+    *
+    * @param historySize The number of steps kept in the history.
+    */
+   StepProfiler(unsigned historySize = 120);
+
+   /**
+    * Sets the hardware counters read around each phase.
+    *
+    * @param counters Open PerfCounters of the stepping thread, or null to stop
+    *                 reading counters. They must outlive the StepProfiler.
+    */
+   void setPerfCounters(const PerfCounters* counters);
+
+   /**
+    * Returns the hardware counters read around each phase.
+    *
+    * @return The PerfCounters, or null if none are available.
+    */
+   const PerfCounters* getPerfCounters() const;
+
+   /**
+    * Starts profiling a step.
+    *
+    * Calls may nest, so code that steps a World can bracket the step whether
+    * or not the step brackets itself. Only the outermost pair is recorded.
+    */
+   void beginStep();
+
+   /**
+    * Finishes profiling a step and moves it into the history, if it matches
+    * the outermost beginStep().
+    */
+   void endStep();
+
+   /**
+    * Returns the StepStats of the step being profiled, to update counters.
+    *
+    * @return A reference to the current StepStats.
+    */
+   StepStats& getCurrent();
+
+   /**
+    * Returns the StepStats of the last finished step.
+    *
+    * @return The StepStats of the last step, or empty stats if there is none.
+    */
+   const StepStats& getLast() const;
+
+   /**
+    * Returns a step from the history.
+    *
+    * @param  age How many steps ago it finished, 0 being the last step.
+    * @return The StepStats of that step.
+    */
+   const StepStats& getHistory(unsigned age) const;
+
+   /**
+    * Returns the number of steps in the history.
+    *
+    * @return The number of steps in the history.
+    */
+   unsigned getNumberOfSteps() const;
+
+   /**
+    * Returns the average of every time and counter over the history.
+    *
+    * @return The averaged StepStats. Counters are rounded down.
+    */
+   StepStats getAverage() const;
+
+   /**
+    * Returns the highest of every time and counter over the history.
+    *
+    * @return The StepStats made of each field's maximum.
+    */
+   StepStats getMaximum() const;
+
+   /**
+    * Removes every step from the history.
+    */
+   void clear();
+};
+
+/**
+ * Adds the time between its construction and destruction to a phase or a pair
+ * routine of the current step.
+ */
+class ScopedStepTimer
+{
+private:
+   double& mTarget; ///< The time the duration is added to.
+   StepProfiler::Clock::time_point mStart; ///< When the timer was created.
+public:
+   /**
+    * Starts timing.
+    *
+    * @param target The time, in microseconds, that the duration is added to.
+    */
+   ScopedStepTimer(double& target) : mTarget(target), mStart(StepProfiler::Clock::now()) {}
+
+   /**
+    * Counts a call and starts timing it.
+    *
+    * @param target The time, in microseconds, that the duration is added to.
+    * @param count  The number of calls, which is incremented.
+    */
+   ScopedStepTimer(double& target, unsigned& count) :
+      mTarget(target), mStart(StepProfiler::Clock::now())
+   {
+      ++count;
+   }
+
+   /**
+    * Stops timing and adds the duration to the target.
+    */
+   ~ScopedStepTimer()
+   {
+      mTarget += std::chrono::duration<double, std::micro>(
+         StepProfiler::Clock::now() - mStart).count();
+   }
+};
+
+/**
+ * Adds the time and hardware counts between its construction and destruction to
+ * a phase of the current step.
+ */
+class ScopedPhaseProfile
+{
+private:
+   StepProfiler& mProfiler; ///< The profiler of the step.
+   StepStats::Phase mPhase; ///< The phase being profiled.
+   HardwareCounters mStartCounters; ///< The counters when the phase began.
+   StepProfiler::Clock::time_point mStart; ///< When the phase began.
+public:
+   /**
+    * Starts profiling a phase.
+    *
+    * @param profiler The StepProfiler of the current step.
+    * @param phase    The phase being profiled.
+    */
+   ScopedPhaseProfile(StepProfiler& profiler, StepStats::Phase phase);
+
+   /**
+    * Stops profiling and adds the time and counts to the phase.
+    */
+   ~ScopedPhaseProfile();
+};
+
+}
+
+#define FZX_PROFILE_CONCATENATE_(a, b) a##b
+#define FZX_PROFILE_CONCATENATE(a, b) FZX_PROFILE_CONCATENATE_(a, b)
+
+#ifdef FZX_PROFILE
+/// Times and counts the rest of the enclosing scope as a StepStats::Phase.
+#define FZX_PROFILE_PHASE(profiler, phase) \
+   fzx::ScopedPhaseProfile FZX_PROFILE_CONCATENATE(fzxTimer, __LINE__)( \
+      (profiler), fzx::StepStats::phase)
+/// Times the rest of the enclosing scope as a call to a StepStats::Pair routine.
+#define FZX_PROFILE_PAIR(profiler, pair) \
+   fzx::ScopedStepTimer FZX_PROFILE_CONCATENATE(fzxTimer, __LINE__)( \
+      (profiler).getCurrent().pairTimes[pair], (profiler).getCurrent().pairCounts[pair])
+/// Adds an amount to one of the StepStats counters.
+#define FZX_PROFILE_COUNT(profiler, counter, amount) \
+   ((profiler).getCurrent().counter += (amount))
+#define FZX_PROFILE_BEGIN_STEP(profiler) (profiler).beginStep()
+#define FZX_PROFILE_END_STEP(profiler) (profiler).endStep()
+#else
+#define FZX_PROFILE_PHASE(profiler, phase)
+#define FZX_PROFILE_PAIR(profiler, pair)
+#define FZX_PROFILE_COUNT(profiler, counter, amount)
+#define FZX_PROFILE_BEGIN_STEP(profiler)
+#define FZX_PROFILE_END_STEP(profiler)
+#endif
+
+#endif /*FZX_PROFILER_HPP_*/
@@ -30,6 +30,60 @@
 namespace fzx
 {
 
+namespace
+{
+
+const float RELATIVE_TOLERANCE = 0.95f; ///< How much deeper B's axis must be to be picked over A's.
+const float ABSOLUTE_TOLERANCE = 0.01f; ///< Keeps the choice of axis from flickering when both are equal.
+
+/**
+ * A vertex of the incident face while it is clipped.
+ */
+struct ClipVertex
+{
+   Vec2f location;
+   unsigned featureId;
+};
+
+/**
+ * Returns a corner of a Rectangle in local space. Corner i starts side i, and
+ * the sides face +x, +y, -x and -y in that order, counterclockwise.
+ */
+Vec2f getCorner(const float halfSize[2], unsigned i)
+{
+   return Vec2f(i == 0 || i == 1 ? halfSize[0] : -halfSize[0],
+                i == 1 || i == 2 ? halfSize[1] : -halfSize[1]);
+}
+
+/**
+ * Clips a segment to the side of a line where location * normal <= offset.
+ *
+ * A vertex that is moved onto the line takes the side it was clipped by into
+ * the second byte of its feature id.
+ *
+ * @return The number of vertices left, two unless the segment is outside.
+ */
+unsigned clip(ClipVertex output[2], const ClipVertex input[2], const Vec2f& normal, float offset, unsigned side)
+{
+   float distance0 = normal * input[0].location - offset;
+   float distance1 = normal * input[1].location - offset;
+
+   unsigned count = 0;
+   if (distance0 <= 0) output[count++] = input[0];
+   if (distance1 <= 0) output[count++] = input[1];
+   if (distance0 * distance1 < 0)
+   {
+      float t = distance0 / (distance0 - distance1);
+      output[count].location = input[0].location + (input[1].location - input[0].location) * t;
+      output[count].featureId = (distance0 > 0 ? input[0].featureId : input[1].featureId) & 0xFF;
+      output[count].featureId |= (side + 1) << 8;
+      count++;
+   }
+   return count;
+}
+
+}
+
 Rectangle::Rectangle(float width, float height) : mWidth(width), mHeight(height) {}
 Rectangle::Rectangle() : mWidth(1.0f), mHeight(1.0f) {}
 
@@ -91,27 +145,105 @@ Shape::BoundingBox Rectangle::getBoundingBox(const Transform& transform) const
 
 Vec2f Rectangle::getSupport(const Vec2f& direction, const Transform& transform) const
 {
-   Vec2f upperRight = Vec2f(mWidth / 2, mHeight / 2);
-   Vec2f lowerRight = Vec2f(mWidth / 2, -mHeight / 2);
-
-   //Apply the transform, but remove the translation so only rotation is left.
-	upperRight = transform.apply(upperRight) - transform.getTranslation();
-	lowerRight = transform.apply(lowerRight) - transform.getTranslation();
-
-	float dot1 = direction * upperRight;
-	float dot2 = direction * lowerRight;
+   //The farthest corner is on the side of each axis the direction points to.
+   //Like before, the corner is relative to the center.
+   const Vec2f& axisX = transform.getRotationMatrix().getLeftColumn();
+   const Vec2f& axisY = transform.getRotationMatrix().getRightColumn();
+   float x = direction * axisX < 0 ? -mWidth / 2 : mWidth / 2;
+   float y = direction * axisY < 0 ? -mHeight / 2 : mHeight / 2;
+   return axisX * x + axisY * y;
+}
 
-   //The higher dot product means that it's more in the same direction.
-	if (std::abs(dot1) > std::abs(dot2))
+bool Rectangle::collide(const Rectangle& a, const Transform& transformA,
+                        const Rectangle& b, const Transform& transformB, Manifold& manifold)
+{
+   manifold.numberOfContacts = 0;
+   const float halfA[2] = {a.mWidth / 2, a.mHeight / 2};
+   const float halfB[2] = {b.mWidth / 2, b.mHeight / 2};
+   const Vec2f axesA[2] = {transformA.getRotationMatrix().getLeftColumn(),
+                           transformA.getRotationMatrix().getRightColumn()};
+   const Vec2f axesB[2] = {transformB.getRotationMatrix().getLeftColumn(),
+                           transformB.getRotationMatrix().getRightColumn()};
+   Vec2f offset = transformB.getTranslation() - transformA.getTranslation();
+
+   //How much of each axis of B lies along each axis of A.
+   float overlap[2][2];
+   for (unsigned i = 0; i < 2; i++)
+      for (unsigned j = 0; j < 2; j++)
+         overlap[i][j] = std::abs(axesA[i] * axesB[j]);
+
+   //The separation along each axis is the distance between the centers less
+   //both half widths along it. Any positive one separates the Rectangles.
+   float separationA[2], separationB[2];
+   for (unsigned i = 0; i < 2; i++)
+   {
+      separationA[i] = std::abs(offset * axesA[i]) - halfA[i]
+                       - (halfB[0] * overlap[i][0] + halfB[1] * overlap[i][1]);
+      if (separationA[i] > 0) return false;
+   }
+   for (unsigned j = 0; j < 2; j++)
+   {
+      separationB[j] = std::abs(offset * axesB[j]) - halfB[j]
+                       - (halfA[0] * overlap[0][j] + halfA[1] * overlap[1][j]);
+      if (separationB[j] > 0) return false;
+   }
+
+   //The least penetrated axis gives the reference face. A is preferred, so
+   //resting Rectangles don't swap faces between steps.
+   unsigned axisA = separationA[1] > separationA[0] ? 1 : 0;
+   unsigned axisB = separationB[1] > separationB[0] ? 1 : 0;
+   bool isFlipped = separationB[axisB] > RELATIVE_TOLERANCE * separationA[axisA] + ABSOLUTE_TOLERANCE;
+
+   const float* halfReference = isFlipped ? halfB : halfA;
+   const float* halfIncident = isFlipped ? halfA : halfB;
+   const Vec2f* axesReference = isFlipped ? axesB : axesA;
+   const Vec2f* axesIncident = isFlipped ? axesA : axesB;
+   const Transform& reference = isFlipped ? transformB : transformA;
+   const Transform& incident = isFlipped ? transformA : transformB;
+   unsigned axis = isFlipped ? axisB : axisA;
+   if (isFlipped) offset = offset * -1;
+
+   bool isPositive = offset * axesReference[axis] >= 0;
+   Vec2f normal = isPositive ? axesReference[axis] : axesReference[axis] * -1;
+   unsigned referenceFace = axis + (isPositive ? 0 : 2);
+
+   //The incident face is the one facing most against the reference normal.
+   float normalX = normal * axesIncident[0];
+   float normalY = normal * axesIncident[1];
+   unsigned incidentFace;
+   if (std::abs(normalX) > std::abs(normalY)) incidentFace = normalX > 0 ? 2 : 0;
+   else incidentFace = normalY > 0 ? 3 : 1;
+
+   ClipVertex incidentEdge[2];
+   for (unsigned i = 0; i < 2; i++)
    {
-		if (dot1 < 0) return upperRight * -1; //LowerLeft
-		else return upperRight;
-	}
-   else
+      unsigned corner = (incidentFace + i) & 3;
+      incidentEdge[i].location = incident.apply(getCorner(halfIncident, corner));
+      incidentEdge[i].featureId = corner;
+   }
+
+   //Clip the incident face to the two sides of the reference face.
+   unsigned sideAxis = 1 - axis;
+   const Vec2f& side = axesReference[sideAxis];
+   float sideCenter = side * reference.getTranslation();
+   ClipVertex clipped[2], contacts[2];
+   if (clip(clipped, incidentEdge, side, sideCenter + halfReference[sideAxis], sideAxis) < 2) return false;
+   if (clip(contacts, clipped, side * -1, halfReference[sideAxis] - sideCenter, sideAxis + 2) < 2) return false;
+
+   //Keep the vertices that are below the reference face.
+   float faceOffset = normal * reference.getTranslation() + halfReference[axis];
+   for (unsigned i = 0; i < 2; i++)
    {
-		if (dot2 < 0) return lowerRight * -1; //UpperLeft
-		else return lowerRight;
-	}
+      float separation = normal * contacts[i].location - faceOffset;
+      if (separation > 0) continue;
+
+      unsigned count = manifold.numberOfContacts++;
+      manifold.locations[count] = contacts[i].location;
+      manifold.penetrations[count] = -separation;
+      manifold.featureIds[count] = contacts[i].featureId | referenceFace << 16 | (isFlipped ? 1u : 0u) << 24;
+   }
+   manifold.normal = isFlipped ? normal * -1 : normal;
+   return manifold.numberOfContacts > 0;
 }
 
 Shape::ShapeType Rectangle::getType() const
@@ -38,6 +38,22 @@ namespace fzx
  */
 class Rectangle : public Shape
 {
+public:
+   /**
+    * The contacts between two Rectangles found by collide().
+    *
+    * Each contact is given a feature id naming the faces and vertices that
+    * produced it, which stays the same from step to step while the Rectangles
+    * rest on each other, so impulses can be carried over to the next step.
+    */
+   struct Manifold
+   {
+      Vec2f normal; ///< The normal of the contact, pointing from the first Rectangle to the second.
+      Vec2f locations[2]; ///< The contacts in real space, on the surface of the incident Rectangle.
+      float penetrations[2]; ///< How far each contact is inside the reference Rectangle.
+      unsigned featureIds[2]; ///< The incident corner, the reference side that clipped it plus one, the reference face, and 1 if the second Rectangle holds the reference face, a byte each.
+      unsigned numberOfContacts; ///< The number of contacts found, up to two.
+   };
 private:
    float mWidth; ///< The width of this Rectangle.
    float mHeight; ///< The height of this Rectangle.
@@ -83,6 +99,25 @@ public:
     */
    void setHeight(float height);
 
+   /**
+    * Finds the contacts between two Rectangles.
+    *
+    * A Rectangle has only two axes, so the separating axis test needs just the
+    * four axes of the two rotation matrices and leaves as soon as one
+    * separates. The face of the least penetrated axis is the reference face,
+    * and the face of the other Rectangle most opposed to it is clipped against
+    * its sides, giving at most two contacts.
+    *
+    * @param  a          The first Rectangle.
+    * @param  transformA The transform of the first Rectangle.
+    * @param  b          The second Rectangle.
+    * @param  transformB The transform of the second Rectangle.
+    * @param  manifold   Set to the contacts found.
+    * @return Whether the Rectangles are touching.
+    */
+   static bool collide(const Rectangle& a, const Transform& transformA,
+                       const Rectangle& b, const Transform& transformB, Manifold& manifold);
+
    //The rest of the methods are overrides. Documentation is inherited.
    float getRadius() const;
    float getArea() const;
@@ -0,0 +1,392 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "Replication.hpp"
+#include "World.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace fzx
+{
+
+namespace
+{
+
+const float TWO_PI = 6.2831853f;
+
+enum ChangeFlag
+{
+   X_CHANGED = 1, Y_CHANGED = 2, VELOCITY_X_CHANGED = 4, VELOCITY_Y_CHANGED = 8,
+   ANGULAR_VELOCITY_CHANGED = 16, ANGLE_CHANGED = 32, IS_SLEEPING = 64
+};
+
+uint32_t toZigZag(int32_t value)
+{
+   return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+int32_t fromZigZag(uint32_t value)
+{
+   return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+void writeVarint(std::vector<unsigned char>& packet, uint32_t value)
+{
+   while (value >= 0x80)
+   {
+      packet.push_back((unsigned char)(value | 0x80));
+      value >>= 7;
+   }
+   packet.push_back((unsigned char)value);
+}
+
+/**
+ * Reads variable-length integers from a packet, remembering if it ran out.
+ */
+struct Reader
+{
+   const unsigned char* data;
+   std::size_t size;
+   std::size_t position;
+   bool hasFailed;
+
+   uint32_t readVarint()
+   {
+      uint32_t value = 0;
+      for (unsigned shift = 0; shift < 35; shift += 7)
+      {
+         if (position >= size)
+         {
+            hasFailed = true;
+            return 0;
+         }
+         unsigned char byte = data[position++];
+         value |= (uint32_t)(byte & 0x7F) << shift;
+         if (!(byte & 0x80)) return value;
+      }
+      hasFailed = true;
+      return 0;
+   }
+
+   int32_t readSigned()
+   {
+      return fromZigZag(readVarint());
+   }
+};
+
+/**
+ * Adds with wraparound instead of overflowing, so a delta written with
+ * subtract() always restores the value exactly.
+ */
+int32_t add(int32_t a, int32_t b)
+{
+   return (int32_t)((uint32_t)a + (uint32_t)b);
+}
+
+int32_t subtract(int32_t a, int32_t b)
+{
+   return (int32_t)((uint32_t)a - (uint32_t)b);
+}
+
+/**
+ * Rounds a value to a whole number of steps.
+ *
+ * @return Whether the value was finite and the steps fit in 32 bits.
+ */
+bool quantize(float value, float precision, int32_t& steps)
+{
+   float rounded = std::floor(value / precision + .5f);
+   if (!(rounded >= -2147483648.0f && rounded < 2147483648.0f)) return false;
+   steps = (int32_t)rounded;
+   return true;
+}
+
+bool quantizeBody(RigidBody& body, const Quantization& quantization, QuantizedState& state)
+{
+   Transform& transform = body.getTransform();
+   Vec2f velocity = body.getPush(RigidBody::VELOCITY);
+   uint32_t turn = 1u << quantization.angleBits;
+
+   float angle = std::fmod(transform.getRotation(), TWO_PI);
+   if (angle < 0) angle += TWO_PI;
+   if (!(angle >= 0 && angle <= TWO_PI)) return false;
+
+   state.angle = (uint32_t)(angle / TWO_PI * turn + .5f) & (turn - 1);
+   state.isSleeping = body.isSleeping();
+   return quantize(transform.getTranslation().x, quantization.positionPrecision, state.x) &&
+          quantize(transform.getTranslation().y, quantization.positionPrecision, state.y) &&
+          quantize(velocity.x, quantization.velocityPrecision, state.velocityX) &&
+          quantize(velocity.y, quantization.velocityPrecision, state.velocityY) &&
+          quantize(body.getTwist(RigidBody::VELOCITY), quantization.angularVelocityPrecision,
+                   state.angularVelocity);
+}
+
+bool isPrecision(float precision)
+{
+   return precision > 0 && precision <= std::numeric_limits<float>::max();
+}
+
+/**
+ * Returns the shortest signed step between two angles on a circle of a given
+ * number of bits.
+ */
+int32_t getAngleDelta(uint32_t from, uint32_t to, unsigned angleBits)
+{
+   uint32_t difference = (to - from) & ((1u << angleBits) - 1);
+   if (difference >= 1u << (angleBits - 1)) return (int32_t)difference - (1 << angleBits);
+   return (int32_t)difference;
+}
+
+}
+
+bool Quantization::isValid() const
+{
+   return isPrecision(positionPrecision) && isPrecision(velocityPrecision) &&
+          isPrecision(angularVelocityPrecision) && angleBits >= 1 && angleBits <= 24;
+}
+
+StateEncoder::StateEncoder(const Quantization& quantization) :
+   mQuantization(quantization), mFrame(0), mNeedsKeyframe(true) {}
+
+bool StateEncoder::encode(World& world, std::vector<unsigned char>& packet)
+{
+   packet.clear();
+   if (!mQuantization.isValid()) return false;
+
+   unsigned numberOfBodies = world.getNumberOfBodies();
+   bool isKeyframe = mNeedsKeyframe || mLast.size() != numberOfBodies ||
+                     mQuantization.keyframeInterval == 0 ||
+                     mFrame % mQuantization.keyframeInterval == 0;
+   mNeedsKeyframe = false;
+   mLast.resize(numberOfBodies);
+
+   writeVarint(packet, mFrame++);
+   packet.push_back(isKeyframe ? 1 : 0);
+   writeVarint(packet, numberOfBodies);
+
+   if (isKeyframe)
+   {
+      for (unsigned i = 0; i < numberOfBodies; i++)
+      {
+         QuantizedState state;
+         if (!quantizeBody(world.getBody(i), mQuantization, state)) return fail(packet);
+         writeVarint(packet, toZigZag(state.x));
+         writeVarint(packet, toZigZag(state.y));
+         writeVarint(packet, toZigZag(state.velocityX));
+         writeVarint(packet, toZigZag(state.velocityY));
+         writeVarint(packet, toZigZag(state.angularVelocity));
+         writeVarint(packet, state.angle << 1 | (state.isSleeping ? 1 : 0));
+         mLast[i] = state;
+      }
+      return true;
+   }
+
+   //The number of changes is only known at the end, so leave room for it.
+   std::size_t countPosition = packet.size();
+   packet.resize(countPosition + 5);
+   uint32_t numberOfChanges = 0;
+   unsigned lastIndex = 0;
+
+   for (unsigned i = 0; i < numberOfBodies; i++)
+   {
+      RigidBody& body = world.getBody(i);
+      QuantizedState& last = mLast[i];
+      if (last.isSleeping && body.isSleeping()) continue;
+
+      QuantizedState state;
+      if (!quantizeBody(body, mQuantization, state)) return fail(packet);
+      unsigned flags = 0;
+      if (state.x != last.x) flags |= X_CHANGED;
+      if (state.y != last.y) flags |= Y_CHANGED;
+      if (state.velocityX != last.velocityX) flags |= VELOCITY_X_CHANGED;
+      if (state.velocityY != last.velocityY) flags |= VELOCITY_Y_CHANGED;
+      if (state.angularVelocity != last.angularVelocity) flags |= ANGULAR_VELOCITY_CHANGED;
+      if (state.angle != last.angle) flags |= ANGLE_CHANGED;
+      if (flags == 0 && state.isSleeping == last.isSleeping) continue;
+      if (state.isSleeping) flags |= IS_SLEEPING;
+
+      writeVarint(packet, i - lastIndex);
+      packet.push_back((unsigned char)flags);
+      if (flags & X_CHANGED) writeVarint(packet, toZigZag(subtract(state.x, last.x)));
+      if (flags & Y_CHANGED) writeVarint(packet, toZigZag(subtract(state.y, last.y)));
+      if (flags & VELOCITY_X_CHANGED)
+         writeVarint(packet, toZigZag(subtract(state.velocityX, last.velocityX)));
+      if (flags & VELOCITY_Y_CHANGED)
+         writeVarint(packet, toZigZag(subtract(state.velocityY, last.velocityY)));
+      if (flags & ANGULAR_VELOCITY_CHANGED)
+         writeVarint(packet, toZigZag(subtract(state.angularVelocity, last.angularVelocity)));
+      if (flags & ANGLE_CHANGED)
+         writeVarint(packet, toZigZag(getAngleDelta(last.angle, state.angle,
+                                                    mQuantization.angleBits)));
+      last = state;
+      lastIndex = i;
+      numberOfChanges++;
+   }
+
+   //Write the count as a fixed five byte varint so nothing has to move.
+   for (unsigned j = 0; j < 5; j++)
+   {
+      unsigned char byte = (numberOfChanges >> (7 * j)) & 0x7F;
+      packet[countPosition + j] = j < 4 ? byte | 0x80 : byte;
+   }
+   return true;
+}
+
+bool StateEncoder::fail(std::vector<unsigned char>& packet)
+{
+   //Some bodies may already have been stored as sent.
+   packet.clear();
+   mNeedsKeyframe = true;
+   return false;
+}
+
+void StateEncoder::requestKeyframe()
+{
+   mNeedsKeyframe = true;
+}
+
+StateDecoder::StateDecoder(const Quantization& quantization) :
+   mQuantization(quantization), mFrame(0), mHasKeyframe(false), mHasFrame(false) {}
+
+bool StateDecoder::decode(const unsigned char* data, std::size_t size)
+{
+   if (!mQuantization.isValid()) return false;
+   Reader reader = {data, size, 0, false};
+   uint32_t frame = reader.readVarint();
+   if (reader.position >= size) return false;
+   bool isKeyframe = data[reader.position++] & 1;
+   uint32_t numberOfBodies = reader.readVarint();
+   if (reader.hasFailed) return false;
+
+   if (isKeyframe)
+   {
+      if (mHasFrame && (int32_t)(frame - mFrame) <= 0) return false;
+
+      //Each body takes at least six bytes, which bounds a bogus count.
+      if (numberOfBodies > (size - reader.position) / 6) return false;
+      std::vector<QuantizedState> states(numberOfBodies);
+      for (QuantizedState& state : states)
+      {
+         state.x = reader.readSigned();
+         state.y = reader.readSigned();
+         state.velocityX = reader.readSigned();
+         state.velocityY = reader.readSigned();
+         state.angularVelocity = reader.readSigned();
+         uint32_t angle = reader.readVarint();
+         state.angle = angle >> 1;
+         state.isSleeping = angle & 1;
+      }
+      if (reader.hasFailed) return false;
+      mStates.swap(states);
+      mFrame = frame;
+      mHasKeyframe = true;
+      mHasFrame = true;
+      return true;
+   }
+
+   if (!mHasKeyframe || frame != mFrame + 1 || numberOfBodies != mStates.size())
+   {
+      mHasKeyframe = false;
+      return false;
+   }
+
+   //Deltas are applied to a copy only if the whole packet is valid.
+   std::vector<QuantizedState> states(mStates);
+   uint32_t numberOfChanges = reader.readVarint();
+   uint32_t turnMask = (1u << mQuantization.angleBits) - 1;
+   unsigned index = 0;
+   for (uint32_t j = 0; j < numberOfChanges && !reader.hasFailed; j++)
+   {
+      index += reader.readVarint();
+      if (index >= numberOfBodies || reader.position >= size) return false;
+      unsigned flags = data[reader.position++];
+      QuantizedState& state = states[index];
+      if (flags & X_CHANGED) state.x = add(state.x, reader.readSigned());
+      if (flags & Y_CHANGED) state.y = add(state.y, reader.readSigned());
+      if (flags & VELOCITY_X_CHANGED) state.velocityX = add(state.velocityX, reader.readSigned());
+      if (flags & VELOCITY_Y_CHANGED) state.velocityY = add(state.velocityY, reader.readSigned());
+      if (flags & ANGULAR_VELOCITY_CHANGED)
+         state.angularVelocity = add(state.angularVelocity, reader.readSigned());
+      if (flags & ANGLE_CHANGED) state.angle = (state.angle + (uint32_t)reader.readSigned()) & turnMask;
+      state.isSleeping = (flags & IS_SLEEPING) != 0;
+   }
+   if (reader.hasFailed) return false;
+   mStates.swap(states);
+   mFrame = frame;
+   return true;
+}
+
+void StateDecoder::apply(World& world) const
+{
+   unsigned numberOfBodies = world.getNumberOfBodies();
+   if (numberOfBodies > mStates.size()) numberOfBodies = mStates.size();
+   for (unsigned i = 0; i < numberOfBodies; i++)
+   {
+      RigidBody& body = world.getBody(i);
+      body.getTransform().setTranslation(getTranslation(i));
+      body.getTransform().setRotation(getRotation(i));
+      body.setPush(getVelocity(i), RigidBody::VELOCITY);
+      body.setTwist(getAngularVelocity(i), RigidBody::VELOCITY);
+      body.setSleeping(mStates[i].isSleeping);
+   }
+}
+
+uint32_t StateDecoder::getFrame() const
+{
+   return mFrame;
+}
+
+unsigned StateDecoder::getNumberOfBodies() const
+{
+   return mStates.size();
+}
+
+Vec2f StateDecoder::getTranslation(unsigned i) const
+{
+   return Vec2f(mStates[i].x, mStates[i].y) * mQuantization.positionPrecision;
+}
+
+float StateDecoder::getRotation(unsigned i) const
+{
+   return mStates[i].angle * (TWO_PI / (1u << mQuantization.angleBits));
+}
+
+Vec2f StateDecoder::getVelocity(unsigned i) const
+{
+   return Vec2f(mStates[i].velocityX, mStates[i].velocityY) * mQuantization.velocityPrecision;
+}
+
+float StateDecoder::getAngularVelocity(unsigned i) const
+{
+   return mStates[i].angularVelocity * mQuantization.angularVelocityPrecision;
+}
+
+bool StateDecoder::isSleeping(unsigned i) const
+{
+   return mStates[i].isSleeping;
+}
+
+}
@@ -0,0 +1,226 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_REPLICATION_HPP_
+#define FZX_REPLICATION_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Vec2.hpp"
+
+namespace fzx
+{
+
+class World;
+
+/**
+ * The precision used to quantize RigidBody states for replication.
+ */
+struct Quantization
+{
+   float positionPrecision; ///< The smallest position step, in world units.
+   float velocityPrecision; ///< The smallest velocity step, in world units per second.
+   float angularVelocityPrecision; ///< The smallest angular velocity step, in radians per second.
+   unsigned angleBits; ///< The number of bits a full turn is divided into, from 1 to 24.
+   unsigned keyframeInterval; ///< The number of frames between keyframes.
+
+   /**
+    * Checks that the precisions are positive and finite and that angleBits is
+    * in range.
+    *
+    * @return Whether a stream can use the Quantization.
+    */
+   bool isValid() const;
+};
+
+/**
+ * The quantized state of one RigidBody, as sent over the wire.
+ */
+struct QuantizedState
+{
+   int32_t x, y; ///< The translation, in positionPrecision steps.
+   int32_t velocityX, velocityY; ///< The velocity, in velocityPrecision steps.
+   int32_t angularVelocity; ///< The angular velocity, in angularVelocityPrecision steps.
+   uint32_t angle; ///< The angle, in 1/2^angleBits of a turn.
+   bool isSleeping;
+};
+
+/**
+ * Encodes the RigidBodys of a World into a stream of compact packets.
+ *
+ * Every keyframeInterval frames a keyframe with every body is emitted. The
+ * frames between only hold the bodies whose quantized state changed since the
+ * last packet, each field as a variable-length delta. Bodies that were asleep
+ * and stay asleep are skipped without being looked at further.
+ *
+ * Deltas are relative to the previous packet, so they expect in-order
+ * delivery, and a lost packet is recovered at the next keyframe. The only
+ * memory kept is one QuantizedState per body.
+ */
+class StateEncoder
+{
+private:
+   Quantization mQuantization; ///< The precision of the stream.
+   std::vector<QuantizedState> mLast; ///< The state sent last for each body.
+   uint32_t mFrame; ///< The frame of the next packet.
+   bool mNeedsKeyframe; ///< Whether the next packet must be a keyframe.
+
+   /**
+    * Abandons a packet that couldn't be encoded.
+    *
+    * @return False.
+    */
+   bool fail(std::vector<unsigned char>& packet);
+public:
+   /**
+    * Creates a StateEncoder with a given precision.
+    *
+    * @param quantization The precision of the stream.
+    */
+   StateEncoder(const Quantization& quantization);
+
+   /**
+    * Encodes the current state of a World.
+    *
+    * Fails if the Quantization isn't valid, or if a value is not finite or
+    * too large to quantize into 32 bits. The packet is left empty then, and
+    * the next packet is a keyframe.
+    *
+    * @param  world The World to encode.
+    * @param  packet The buffer the packet is written to. Its previous content
+    *         is replaced, but its storage is reused.
+    * @return Whether the packet was encoded.
+    */
+   bool encode(World& world, std::vector<unsigned char>& packet);
+
+   /**
+    * Makes the next packet a keyframe, for example when a client joins.
+    */
+   void requestKeyframe();
+};
+
+/**
+ * Decodes a stream of packets made by a StateEncoder.
+ */
+class StateDecoder
+{
+private:
+   Quantization mQuantization; ///< The precision of the stream.
+   std::vector<QuantizedState> mStates; ///< The decoded state of each body.
+   uint32_t mFrame; ///< The frame of the last packet decoded.
+   bool mHasKeyframe; ///< Whether a keyframe was decoded since the stream broke.
+   bool mHasFrame; ///< Whether any packet was decoded, so mFrame holds a frame of the stream.
+public:
+   /**
+    * Creates a StateDecoder with a given precision.
+    *
+    * @param quantization The precision of the stream. Must match the encoder.
+    */
+   StateDecoder(const Quantization& quantization);
+
+   /**
+    * Decodes a packet.
+    *
+    * A delta that doesn't follow the last decoded frame is rejected, and
+    * deltas keep being rejected until the next keyframe arrives. A keyframe
+    * that isn't newer than the last decoded frame is rejected too, so a late
+    * packet can't roll the states back. Frames are compared modulo 2^32, so
+    * the counter may wrap. Every packet is rejected if the Quantization isn't
+    * valid.
+    *
+    * @param  data A pointer to the packet.
+    * @param  size The size of the packet in bytes.
+    * @return Whether the packet was decoded.
+    */
+   bool decode(const unsigned char* data, std::size_t size);
+
+   /**
+    * Writes the decoded states to the RigidBodys of a World with the same
+    * bodies as the encoder's.
+    *
+    * @param world The World to update.
+    */
+   void apply(World& world) const;
+
+   /**
+    * Returns the frame of the last packet decoded.
+    *
+    * @return The frame of the last packet decoded.
+    */
+   uint32_t getFrame() const;
+
+   /**
+    * Returns the number of bodies in the stream.
+    *
+    * @return The number of bodies in the stream.
+    */
+   unsigned getNumberOfBodies() const;
+
+   /**
+    * Returns the translation of a body.
+    *
+    * @param  i The index of the body.
+    * @return The dequantized translation.
+    */
+   Vec2f getTranslation(unsigned i) const;
+
+   /**
+    * Returns the angle of a body.
+    *
+    * @param  i The index of the body.
+    * @return The dequantized angle, in the range [0, 2pi).
+    */
+   float getRotation(unsigned i) const;
+
+   /**
+    * Returns the velocity of a body.
+    *
+    * @param  i The index of the body.
+    * @return The dequantized velocity.
+    */
+   Vec2f getVelocity(unsigned i) const;
+
+   /**
+    * Returns the angular velocity of a body.
+    *
+    * @param  i The index of the body.
+    * @return The dequantized angular velocity.
+    */
+   float getAngularVelocity(unsigned i) const;
+
+   /**
+    * Returns whether a body is asleep.
+    *
+    * @param  i The index of the body.
+    * @return Whether the body is asleep.
+    */
+   bool isSleeping(unsigned i) const;
+};
+
+}
+
+#endif /*FZX_REPLICATION_HPP_*/
@@ -3,26 +3,34 @@
 #include "Rectangle.hpp"
 #include "Polygon.hpp"
 #include "Settings.hpp"
+#include "ShapeCache.hpp"
+
+#include <atomic>
+#include <cstddef>
 
 namespace fzx
 {
 
 RigidBody::RigidBody(std::string name)
+   : mName(name)
 {
-   mName = name;
+   //The per-step fields must share the first cache line of every RigidBody.
+   static_assert(offsetof(RigidBody, mIsSleeping) < 64, "The hot fields must fit one cache line");
+
    mBodyType = DYNAMIC;
    mMaterial = Material{1, 0, 0, 1};
-   mShape = new Circle(1);
+   mShape = ShapeCache::getCircle(1);
    mAngularVelocity = 0;
    mTorque = 0;
    mLayer = 0;
    mIsSleeping= false;
+   mChanges = 0;
+   mIndex = 0;
+   static std::atomic<uint64_t> lastId(0);
+   mId = ++lastId;
    calculateMassData();
 }
-RigidBody::~RigidBody()
-{
-   delete mShape;
-}
+RigidBody::~RigidBody() {}
 
 void RigidBody::calculateMassData()
 {
@@ -43,6 +51,7 @@ bool RigidBody::canSleep()
 
 void RigidBody::applyPush(const Vec2f& push, RigidBody::ForceType forceType)
 {
+   mChanges++;
    if (mBodyType == STATIC) return;
    if (forceType == RigidBody::VELOCITY) mVelocity += push;
    if (forceType == RigidBody::ACCELERATION) mForce += push * mMassData.mass;
@@ -54,6 +63,7 @@ void RigidBody::applyPush(const Vec2f& push, RigidBody::ForceType forceType)
 
 void RigidBody::applyTwist(float twist, RigidBody::ForceType forceType)
 {
+   mChanges++;
    if (mBodyType == STATIC) return;
    if (forceType == RigidBody::VELOCITY) mAngularVelocity += twist;
    if (forceType == RigidBody::ACCELERATION) mTorque += twist * mMassData.inertia;
@@ -65,6 +75,7 @@ void RigidBody::applyTwist(float twist, RigidBody::ForceType forceType)
 
 void RigidBody::stop()
 {
+   mChanges++;
    mVelocity = Vec2f(0, 0);
    mAngularVelocity = 0;
    mForce = Vec2f(0, 0);
@@ -89,6 +100,7 @@ float RigidBody::getTwist(ForceType forceType) const
 
 void RigidBody::setPush(const Vec2f& push, ForceType forceType)
 {
+   mChanges++;
    if (mBodyType == STATIC) return;
    if (forceType == RigidBody::VELOCITY) mVelocity = push;
    if (forceType == RigidBody::ACCELERATION) mForce = push * mMassData.mass;
@@ -99,6 +111,7 @@ void RigidBody::setPush(const Vec2f& push, ForceType forceType)
 
 void RigidBody::setTwist(float twist, ForceType forceType)
 {
+   mChanges++;
    if (mBodyType == STATIC) return;
    if (forceType == RigidBody::VELOCITY) mAngularVelocity = twist;
    if (forceType == RigidBody::ACCELERATION) mTorque = twist * mMassData.inertia;
@@ -124,17 +137,33 @@ const RigidBody::Material& RigidBody::getMaterial() const
 
 Transform& RigidBody::getTransform()
 {
+   mChanges++;
    return mTransform;
 }
 
-const Shape& RigidBody::getShape()
+const Transform& RigidBody::getTransform() const
+{
+   return mTransform;
+}
+
+const Shape& RigidBody::getShape() const
 {
    return *mShape;
 }
 
 const std::string& RigidBody::getName()
 {
-   return mName;
+   return mName.getName();
+}
+
+unsigned RigidBody::getNameId() const
+{
+   return mName.getId();
+}
+
+uint64_t RigidBody::getId() const
+{
+   return mId;
 }
 
 int RigidBody::getLayer() const
@@ -161,7 +190,7 @@ void RigidBody::setMaterial(Material material)
 
 void RigidBody::setName(std::string name)
 {
-   mName = name;
+   mName = NameTable::Reference(name);
 }
 
 void RigidBody::setLayer(int layer)
@@ -171,28 +200,29 @@ void RigidBody::setLayer(int layer)
 
 void RigidBody::setSleeping(bool isSleeping)
 {
+   mChanges++;
    mIsSleeping = isSleeping;
 }
 
-void RigidBody::setShapeToCircle(float radius)
+void RigidBody::setShape(std::shared_ptr<const Shape> shape)
 {
-   delete mShape;
-   mShape = new Circle(radius);
+   mShape = std::move(shape);
    calculateMassData();
 }
 
+void RigidBody::setShapeToCircle(float radius)
+{
+   setShape(ShapeCache::getCircle(radius));
+}
+
 void RigidBody::setShapeToRectangle(float width, float height)
 {
-   delete mShape;
-   mShape = new Rectangle(width, height);
-   calculateMassData();
+   setShape(ShapeCache::getRectangle(width, height));
 }
 
 void RigidBody::setShapeToPolygon(std::vector<Vec2f> vertices)
 {
-   delete mShape;
-   mShape = new Polygon(vertices);
-   calculateMassData();
+   setShape(ShapeCache::getPolygon(vertices));
 }
 
 }
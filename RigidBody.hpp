@@ -26,9 +26,13 @@
 #ifndef RIGID_BODY_HPP
 #define RIGID_BODY_HPP
 
+#include <cstdint>
+#include <memory>
 #include <vector>
 #include <string>
 
+#include "Memory.hpp"
+#include "NameTable.hpp"
 #include "Shape.hpp"
 #include "Circle.hpp"
 #include "Vec2.hpp"
@@ -36,12 +40,19 @@
 namespace fzx {
 
 class World;
+class WorldSerializer;
+class RollbackBuffer;
+struct RigidBodyFields;
 
 /**
  * A class that represents a rigid body in 2D space.
  */
 class RigidBody {
 friend class World;
+friend class WorldSerializer;
+friend class RollbackBuffer;
+friend class IslandSolver;
+friend struct RigidBodyFields; //Lets LayoutBenchmarks run World's loops on RigidBody itself.
 public:
 	/**
 	 * The type of RigidBody.
@@ -54,7 +65,7 @@ public:
 	 *
 	 * DYNAMIC means that is completely interacts with it's enviroment.
 	 */
-	enum BodyType
+	enum BodyType : unsigned char
 	{
 		STATIC, KINEMATIC, DYNAMIC
 	};
@@ -88,24 +99,35 @@ public:
 		float mass, inverseMass, inertia, inverseInertia;
 	};
 private:
-	BodyType mBodyType; ///< The Type of the RigidBody
-	MassData mMassData; ///< Data on the RigidBody's mass and inertia.
-	Material mMaterial; ///< The material that composes the RigidBody.
-	Shape* mShape; ///< The Shape of the RigidBody
-	std::string mName;
-	Transform mTransform; ///< The geometrical transformation of the RigidBody.
+	//The fields the solver reads and writes every step come first and fill
+	//one cache line, so integrating or solving a body touches only that line.
+	//The rest is only read when setting up collisions or by the user.
+	alignas(64) Transform mTransform; ///< The geometrical transformation of the RigidBody.
 	Vec2f mVelocity; ///< The translational velocity of the RigidBody.
-	Vec2f mForce; ///< The constant force on the RigidBody.
 	float mAngularVelocity; ///< The rotational velocity of the RigidBody.
+	MassData mMassData; ///< Data on the RigidBody's mass and inertia.
+	BodyType mBodyType; ///< The Type of the RigidBody
+	bool mIsSleeping; ///< Whether the RigidBody is asleep.
+
+	Vec2f mForce; ///< The constant force on the RigidBody.
 	float mTorque; ///< The Torque of the RigidBody.
+	Material mMaterial; ///< The material that composes the RigidBody.
 	int mLayer; ///< The layer the RigidBody resides on.
-	bool mIsSleeping;
+	NameTable::Reference mName; ///< The RigidBody's name, interned in the NameTable.
+	unsigned mChanges; ///< Counts the calls that could change the state, so a changed sleeping body can be noticed.
+	unsigned mIndex; ///< The position of the RigidBody in its World, as numbered by the last IslandSolver step.
+	uint64_t mId; ///< Tells the RigidBody apart from every other one made in the process.
+	std::shared_ptr<const Shape> mShape; ///< The Shape of the RigidBody, possibly shared with others.
 
 	/**
 	 * Calculates the data for the MassData strucutre.
 	 */
 	void calculateMassData();
 public:
+	//RigidBodys are accounted to Memory::BODIES, and to the Account of their
+	//World when made with new (account) RigidBody.
+	FZX_TRACK_ACCOUNTED_ALLOCATIONS(RigidBody, BODIES)
+
 	/**
 	 * Creates a RigidBody at the origin with a given name.
 	 *
@@ -116,14 +138,15 @@ public:
 	 * It has no velocity or forces acting on it.
 	 * It is on layer 0.
 	 *
-	 * @param The RigidBody's std::string name.
+	 * @param The RigidBody's std::string name, empty for none.
 	 */
-	RigidBody(std::string name);
+	RigidBody(std::string name = "");
 
 	/**
 	 * Destroys the RigidBody.
 	 *
-	 * Deletes the Shape memeber.
+	 * Releases the Shape memeber, which is deleted if no other RigidBody
+	 * shares it.
 	 */
 	~RigidBody();
 
@@ -234,16 +257,26 @@ public:
 	/**
 	 * Returns a reference to this RigidBody's Transform.
 	 *
+	 * The RigidBody counts it as changed, even if it is asleep, since the
+	 * Transform can be moved through the reference.
+	 *
 	 * @return A reference to this RigidBody's Transform
 	 */
 	Transform& getTransform();
 
+	/**
+	 * Returns a constant reference to this RigidBody's Transform.
+	 *
+	 * @return A constant reference to this RigidBody's Transform
+	 */
+	const Transform& getTransform() const;
+
 	/**
 	 * Returns a reference to this RigidBody's Shape.
 	 *
 	 * @return A reference to this RigidBody's Shape.
 	 */
-	const Shape& getShape();
+	const Shape& getShape() const;
 
 	/**
 	 * Returns the name of the RigidBody
@@ -252,6 +285,25 @@ public:
 	 */
 	const std::string& getName();
 
+	/**
+	 * Returns the id of the RigidBody's name in the NameTable.
+	 *
+	 * Bodies with equal names have equal ids.
+	 *
+	 * @return The id of the name, NameTable::NO_NAME if it has none.
+	 */
+	unsigned getNameId() const;
+
+	/**
+	 * Returns the id of the RigidBody.
+	 *
+	 * Ids count up from 1 in the order RigidBodys are made and are never
+	 * reused, unlike addresses. A copy keeps the id of the original.
+	 *
+	 * @return The id of the RigidBody.
+	 */
+	uint64_t getId() const;
+
 	/**
 	 * Returns the layer this RigidBody is on.
 	 *
@@ -303,10 +355,21 @@ public:
 	 */
 	void setSleeping(bool isSleeping);
 
+	/**
+	 * Set's this RigidBody's Shape to a Shape that may be shared.
+	 *
+	 * Shapes are immutable once shared, so any number of RigidBodys can use the
+	 * same one.
+	 *
+	 * @param shape The new Shape. Must not be null.
+	 */
+	void setShape(std::shared_ptr<const Shape> shape);
+
 	/**
 	 * Set's this RigidBody's Shape to a Circle with a given radius.
 	 *
-	 * See Circle for more details.
+	 * The Circle is shared with every RigidBody of the same radius, see
+	 * ShapeCache. See Circle for more details.
 	 *
 	 * @param radius The float radius of this new Circle.
 	 */
@@ -315,7 +378,8 @@ public:
 	/**
 	 * Set's this RigidBody's Shape to a Rectangle with given dimensions..
 	 *
-	 * See Rectangle for more details.
+	 * The Rectangle is shared with every RigidBody of the same dimensions,
+	 * see ShapeCache. See Rectangle for more details.
 	 *
 	 * @param width The float width of this new Rectangle
 	 * @param height The float height of this new Rectangle
@@ -325,7 +389,8 @@ public:
 	/**
 	 * Set's this RigidBody's Shape to a Polygon with a given vertices.
 	 *
-	 * See Polygon for more details.
+	 * The Polygon is shared with every RigidBody given the same vertices, see
+	 * ShapeCache. See Polygon for more details.
 	 *
 	 * @param vertices The Vec2f vertices of this new Polygon.
 	 */
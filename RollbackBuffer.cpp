@@ -0,0 +1,169 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "RollbackBuffer.hpp"
+#include "World.hpp"
+
+namespace fzx
+{
+
+RollbackBuffer::RollbackBuffer(World& world, unsigned capacity) :
+   mWorld(world), mFrames(capacity > 0 ? capacity : 1), mFrame(0), mOldestFrame(0)
+{
+   reset();
+}
+
+RollbackBuffer::BodyState RollbackBuffer::getState(const RigidBody& body)
+{
+   BodyState state;
+   state.transform = body.mTransform;
+   state.velocity = body.mVelocity;
+   state.force = body.mForce;
+   state.angularVelocity = body.mAngularVelocity;
+   state.torque = body.mTorque;
+   state.isSleeping = body.mIsSleeping;
+   return state;
+}
+
+void RollbackBuffer::setState(RigidBody& body, const BodyState& state)
+{
+   body.mTransform = state.transform;
+   body.mVelocity = state.velocity;
+   body.mForce = state.force;
+   body.mAngularVelocity = state.angularVelocity;
+   body.mTorque = state.torque;
+   body.mIsSleeping = state.isSleeping;
+}
+
+bool RollbackBuffer::isEqual(const BodyState& a, const BodyState& b)
+{
+   const Vec2f& translationA = a.transform.getTranslation();
+   const Vec2f& translationB = b.transform.getTranslation();
+   const Vec2f& rotationA = a.transform.getRotationMatrix().getLeftColumn();
+   const Vec2f& rotationB = b.transform.getRotationMatrix().getLeftColumn();
+   //The angle counts whole turns the matrix can't tell apart.
+   return translationA.x == translationB.x && translationA.y == translationB.y &&
+          rotationA.x == rotationB.x && rotationA.y == rotationB.y &&
+          a.transform.mAngle == b.transform.mAngle &&
+          a.transform.mIsAngleStale == b.transform.mIsAngleStale &&
+          a.velocity.x == b.velocity.x && a.velocity.y == b.velocity.y &&
+          a.force.x == b.force.x && a.force.y == b.force.y &&
+          a.angularVelocity == b.angularVelocity &&
+          a.torque == b.torque && a.isSleeping == b.isSleeping;
+}
+
+void RollbackBuffer::reset()
+{
+   mFrame = mOldestFrame = 0;
+   for (std::vector<Change>& changes : mFrames) changes.clear();
+   mCurrent.resize(mWorld.getNumberOfBodies());
+   mChangeCounts.resize(mCurrent.size());
+   for (unsigned i = 0; i < mCurrent.size(); i++)
+   {
+      mCurrent[i] = getState(mWorld.getBody(i));
+      mChangeCounts[i] = mWorld.getBody(i).mChanges;
+   }
+}
+
+void RollbackBuffer::record()
+{
+   if (mCurrent.size() != mWorld.getNumberOfBodies())
+   {
+      reset();
+      return;
+   }
+
+   mFrame++;
+   if (mFrame - mOldestFrame > mFrames.size()) mOldestFrame++;
+   std::vector<Change>& changes = mFrames[mFrame % mFrames.size()];
+   changes.clear();
+
+   for (unsigned i = 0; i < mCurrent.size(); i++)
+   {
+      const RigidBody& body = mWorld.getBody(i);
+      //A body that slept through the whole step can't have changed, unless
+      //it was moved or pushed through its setters without waking.
+      if (body.mIsSleeping && mCurrent[i].isSleeping && body.mChanges == mChangeCounts[i]) continue;
+      mChangeCounts[i] = body.mChanges;
+
+      BodyState state = getState(body);
+      if (isEqual(state, mCurrent[i])) continue;
+      changes.push_back(Change{i, mCurrent[i]});
+      mCurrent[i] = state;
+   }
+}
+
+bool RollbackBuffer::restore(unsigned frame)
+{
+   if (frame < mOldestFrame || frame > mFrame) return false;
+   if (mCurrent.size() != mWorld.getNumberOfBodies()) return false;
+
+   //Undo the frames from newest to oldest so the earliest state wins.
+   for (; mFrame > frame; mFrame--)
+   {
+      std::vector<Change>& changes = mFrames[mFrame % mFrames.size()];
+      for (const Change& change : changes)
+      {
+         setState(mWorld.getBody(change.index), change.state);
+         mCurrent[change.index] = change.state;
+      }
+      changes.clear();
+   }
+   return true;
+}
+
+bool RollbackBuffer::resimulate(unsigned fromFrame,
+                                const std::function<void(World&, unsigned)>& applyInput)
+{
+   unsigned targetFrame = mFrame;
+   if (!restore(fromFrame)) return false;
+
+   while (mFrame < targetFrame)
+   {
+      if (applyInput) applyInput(mWorld, mFrame + 1);
+      FZX_PROFILE_BEGIN_STEP(mWorld.getProfiler());
+      mWorld.step();
+      FZX_PROFILE_END_STEP(mWorld.getProfiler());
+      record();
+   }
+   return true;
+}
+
+unsigned RollbackBuffer::getFrame() const
+{
+   return mFrame;
+}
+
+unsigned RollbackBuffer::getOldestFrame() const
+{
+   return mOldestFrame;
+}
+
+unsigned RollbackBuffer::getNumberOfChanges(unsigned frame) const
+{
+   return mFrames[frame % mFrames.size()].size();
+}
+
+}
@@ -0,0 +1,171 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_ROLLBACK_BUFFER_HPP_
+#define FZX_ROLLBACK_BUFFER_HPP_
+
+#include <functional>
+#include <vector>
+
+#include "Transform.hpp"
+#include "Vec2.hpp"
+
+namespace fzx
+{
+
+class World;
+class RigidBody;
+
+/**
+ * A ring buffer of per-step changes that lets a World be rewound and
+ * resimulated, for rollback netcode.
+ *
+ * After every step the buffer compares the awake RigidBodys to the state they
+ * had at the previous frame and keeps the old state of those that changed.
+ * Sleeping bodies that stayed asleep are skipped, so they cost nothing to
+ * record or restore, unless a setter or getTransform() was called on them,
+ * since that can move them without waking them. Rewinding applies those
+ * changes backwards, which costs O(changed bodies) per frame.
+ *
+ * Bodies are identified by index, so adding or removing bodies starts a new
+ * history. Collisions aren't recorded since they are rebuilt every step.
+ */
+class RollbackBuffer
+{
+public:
+   /**
+    * The part of a RigidBody's state that changes while stepping.
+    */
+   struct BodyState
+   {
+      Transform transform; ///< Copied whole, so the rotation matrix is restored bit for bit.
+      Vec2f velocity;
+      Vec2f force;
+      float angularVelocity;
+      float torque;
+      bool isSleeping;
+   };
+private:
+   /**
+    * The state a RigidBody had before a step changed it.
+    */
+   struct Change
+   {
+      unsigned index;
+      BodyState state;
+   };
+
+   World& mWorld; ///< The World being recorded.
+   std::vector<BodyState> mCurrent; ///< The state of every body at mFrame.
+   std::vector<unsigned> mChangeCounts; ///< The change count of every body when it was last compared.
+   std::vector<std::vector<Change>> mFrames; ///< The changes of each frame, as a ring.
+   unsigned mFrame; ///< The frame the World is at.
+   unsigned mOldestFrame; ///< The oldest frame that can be restored.
+
+   /**
+    * Reads the state of a RigidBody.
+    */
+   static BodyState getState(const RigidBody& body);
+
+   /**
+    * Writes a state to a RigidBody.
+    */
+   static void setState(RigidBody& body, const BodyState& state);
+
+   /**
+    * Checks whether two states are identical.
+    */
+   static bool isEqual(const BodyState& a, const BodyState& b);
+public:
+   /**
+    * Creates a RollbackBuffer for a World.
+    *
+    * The current state of the World becomes frame 0.
+    *
+    * @param world The World that will be recorded.
+    * @param capacity The number of frames that can be rolled back.
+    */
+   RollbackBuffer(World& world, unsigned capacity);
+
+   /**
+    * Discards the history and makes the current state of the World frame 0.
+    */
+   void reset();
+
+   /**
+    * Records the changes of the step that was just taken and advances the
+    * frame. Should be called after every World::step().
+    */
+   void record();
+
+   /**
+    * Rewinds the World to a previous frame.
+    *
+    * The frames after it are discarded.
+    *
+    * @param  frame The frame to go back to.
+    * @return Whether the frame was still in the buffer.
+    */
+   bool restore(unsigned frame);
+
+   /**
+    * Rewinds the World to a previous frame and steps it back to the current
+    * frame, recording as it goes.
+    *
+    * @param  fromFrame The frame to resimulate from.
+    * @param  applyInput A function called before each step with the World and
+    * the frame the step will produce, so corrected inputs can be applied. Can
+    * be empty.
+    * @return Whether the frame was still in the buffer.
+    */
+   bool resimulate(unsigned fromFrame,
+                   const std::function<void(World&, unsigned)>& applyInput = nullptr);
+
+   /**
+    * Returns the frame the World is at.
+    *
+    * @return The current frame.
+    */
+   unsigned getFrame() const;
+
+   /**
+    * Returns the oldest frame that can still be restored.
+    *
+    * @return The oldest frame in the buffer.
+    */
+   unsigned getOldestFrame() const;
+
+   /**
+    * Returns the number of bodies that changed during a frame's step.
+    *
+    * @param  frame A frame in the buffer, newer than the oldest frame.
+    * @return The number of changes recorded for that frame.
+    */
+   unsigned getNumberOfChanges(unsigned frame) const;
+};
+
+}
+
+#endif /*FZX_ROLLBACK_BUFFER_HPP_*/
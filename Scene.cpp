@@ -0,0 +1,336 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "Scene.hpp"
+#include "World.hpp"
+#include "Rectangle.hpp"
+#include "Polygon.hpp"
+#include "ShapeCache.hpp"
+
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fzx
+{
+
+namespace
+{
+
+/**
+ * The header at the start of a scene file. Offsets are in bytes from the start.
+ */
+struct Header
+{
+   uint32_t magic, version;
+   uint32_t numberOfBodies, numberOfVertices, numberOfNodes;
+   uint32_t bodyOffset, vertexOffset, normalOffset, nodeOffset;
+   uint32_t fileSize;
+};
+
+bool isLittleEndian()
+{
+   const uint32_t one = 1;
+   unsigned char firstByte;
+   std::memcpy(&firstByte, &one, 1);
+   return firstByte == 1;
+}
+
+bool overlaps(const Shape::BoundingBox& a, const Shape::BoundingBox& b)
+{
+   return a.lowerLeft.x <= b.upperRight.x && b.lowerLeft.x <= a.upperRight.x &&
+          a.lowerLeft.y <= b.upperRight.y && b.lowerLeft.y <= a.upperRight.y;
+}
+
+}
+
+Scene::Scene() :
+   mData(nullptr), mSize(0), mBodies(nullptr), mVertices(nullptr), mNormals(nullptr),
+   mNodes(nullptr), mNumberOfBodies(0), mNumberOfVertices(0), mNumberOfNodes(0) {}
+
+Scene::~Scene()
+{
+   close();
+}
+
+bool Scene::write(const std::string& path, World& world)
+{
+   std::vector<Body> bodies;
+   std::vector<Vec2f> vertices;
+   std::vector<Vec2f> normals;
+
+   for (unsigned i = 0; i < world.getNumberOfBodies(); i++)
+   {
+      const RigidBody& rigidBody = world.getBody(i);
+      if (rigidBody.getType() != RigidBody::STATIC) continue;
+
+      const Shape& shape = rigidBody.getShape();
+      const Transform& transform = rigidBody.getTransform();
+      const RigidBody::Material& material = rigidBody.getMaterial();
+      const RigidBody::MassData& massData = rigidBody.getMassData();
+
+      Body body;
+      body.shapeType = shape.getType();
+      body.firstVertex = vertices.size();
+      body.numberOfVertices = 0;
+      body.layer = rigidBody.getLayer();
+      body.width = body.height = 0;
+      if (body.shapeType == Shape::RECTANGLE)
+      {
+         body.width = static_cast<const Rectangle&>(shape).getWidth();
+         body.height = static_cast<const Rectangle&>(shape).getHeight();
+      }
+      else if (body.shapeType == Shape::POLYGON)
+      {
+         const Polygon& polygon = static_cast<const Polygon&>(shape);
+         body.numberOfVertices = polygon.getNumberOfVertices();
+         for (unsigned j = 0; j < body.numberOfVertices; j++)
+         {
+            vertices.push_back(polygon.getVertix(j));
+            normals.push_back(polygon.getNormal(j));
+         }
+      }
+      body.radius = shape.getRadius();
+      body.x = transform.getTranslation().x;
+      body.y = transform.getTranslation().y;
+      //The matrix is stored as it is, since cos and sin of the angle would
+      //round differently from what the integration left.
+      body.angle = transform.getRotation();
+      body.cosine = transform.getRotationMatrix().getLeftColumn().x;
+      body.sine = transform.getRotationMatrix().getLeftColumn().y;
+      body.boundingBox = shape.getBoundingBox(transform);
+      body.density = material.density;
+      body.staticFriction = material.staticFriction;
+      body.kineticFriction = material.kineticFriction;
+      body.restitution = material.restitution;
+      body.mass = massData.mass;
+      body.inverseMass = massData.inverseMass;
+      body.inertia = massData.inertia;
+      body.inverseInertia = massData.inverseInertia;
+      bodies.push_back(body);
+   }
+
+   //The bodies are stored in the tree's leaf order, so every leaf is a
+   //contiguous range of them.
+   std::vector<Shape::BoundingBox> boxes(bodies.size());
+   for (unsigned i = 0; i < bodies.size(); i++) boxes[i] = bodies[i].boundingBox;
+   StaticTree tree;
+   tree.build(boxes.data(), boxes.size());
+   std::vector<Body> orderedBodies(bodies.size());
+   for (unsigned i = 0; i < bodies.size(); i++) orderedBodies[i] = bodies[tree.getItem(i)];
+   bodies.swap(orderedBodies);
+   std::vector<Node> nodes(tree.getNumberOfNodes());
+   for (unsigned i = 0; i < nodes.size(); i++) nodes[i] = tree.getNode(i);
+
+   uint64_t fileSize = sizeof(Header) + bodies.size() * sizeof(Body) +
+                       2 * vertices.size() * sizeof(Vec2f) + nodes.size() * sizeof(Node);
+   if (fileSize > UINT32_MAX) return false;
+
+   Header header;
+   header.magic = MAGIC;
+   header.version = VERSION;
+   header.numberOfBodies = bodies.size();
+   header.numberOfVertices = vertices.size();
+   header.numberOfNodes = nodes.size();
+   header.bodyOffset = sizeof(Header);
+   header.vertexOffset = header.bodyOffset + bodies.size() * sizeof(Body);
+   header.normalOffset = header.vertexOffset + vertices.size() * sizeof(Vec2f);
+   header.nodeOffset = header.normalOffset + normals.size() * sizeof(Vec2f);
+   header.fileSize = header.nodeOffset + nodes.size() * sizeof(Node);
+
+   std::FILE* file = std::fopen(path.c_str(), "wb");
+   if (!file) return false;
+   bool isWritten = std::fwrite(&header, sizeof(Header), 1, file) == 1;
+   isWritten = isWritten && std::fwrite(bodies.data(), sizeof(Body), bodies.size(), file) == bodies.size();
+   isWritten = isWritten && std::fwrite(vertices.data(), sizeof(Vec2f), vertices.size(), file) == vertices.size();
+   isWritten = isWritten && std::fwrite(normals.data(), sizeof(Vec2f), normals.size(), file) == normals.size();
+   isWritten = isWritten && std::fwrite(nodes.data(), sizeof(Node), nodes.size(), file) == nodes.size();
+   return std::fclose(file) == 0 && isWritten;
+}
+
+bool Scene::open(const std::string& path)
+{
+   close();
+   if (!isLittleEndian()) return false;
+
+   int file = ::open(path.c_str(), O_RDONLY);
+   if (file < 0) return false;
+   struct stat status;
+   if (fstat(file, &status) != 0 || (std::size_t)status.st_size < sizeof(Header))
+   {
+      ::close(file);
+      return false;
+   }
+   void* data = mmap(nullptr, status.st_size, PROT_READ, MAP_SHARED, file, 0);
+   ::close(file);
+   if (data == MAP_FAILED) return false;
+   mData = static_cast<const unsigned char*>(data);
+   mSize = status.st_size;
+
+   const Header& header = *reinterpret_cast<const Header*>(mData);
+   bool isValid = header.magic == MAGIC && header.version == VERSION &&
+      header.fileSize <= mSize &&
+      header.bodyOffset + (uint64_t)header.numberOfBodies * sizeof(Body) <= header.vertexOffset &&
+      header.vertexOffset + (uint64_t)header.numberOfVertices * sizeof(Vec2f) <= header.normalOffset &&
+      header.normalOffset + (uint64_t)header.numberOfVertices * sizeof(Vec2f) <= header.nodeOffset &&
+      header.nodeOffset + (uint64_t)header.numberOfNodes * sizeof(Node) <= header.fileSize &&
+      header.bodyOffset % 4 == 0 && header.vertexOffset % 4 == 0 &&
+      header.normalOffset % 4 == 0 && header.nodeOffset % 4 == 0;
+   if (!isValid)
+   {
+      close();
+      return false;
+   }
+
+   //The bodies and nodes aren't looked at here, so a large file opens without
+   //being paged in. Their ranges are checked when they are used.
+   mBodies = reinterpret_cast<const Body*>(mData + header.bodyOffset);
+   mVertices = reinterpret_cast<const Vec2f*>(mData + header.vertexOffset);
+   mNormals = reinterpret_cast<const Vec2f*>(mData + header.normalOffset);
+   mNodes = reinterpret_cast<const Node*>(mData + header.nodeOffset);
+   mNumberOfBodies = header.numberOfBodies;
+   mNumberOfVertices = header.numberOfVertices;
+   mNumberOfNodes = header.numberOfNodes;
+   return true;
+}
+
+void Scene::close()
+{
+   if (mData) munmap(const_cast<unsigned char*>(mData), mSize);
+   mData = nullptr;
+   mSize = 0;
+   mBodies = nullptr;
+   mVertices = mNormals = nullptr;
+   mNodes = nullptr;
+   mNumberOfBodies = mNumberOfVertices = mNumberOfNodes = 0;
+}
+
+bool Scene::isOpen() const
+{
+   return mData != nullptr;
+}
+
+unsigned Scene::getNumberOfBodies() const
+{
+   return mNumberOfBodies;
+}
+
+const Scene::Body& Scene::getBody(unsigned i) const
+{
+   return mBodies[i];
+}
+
+const Vec2f* Scene::getVertices(const Body& body) const
+{
+   if ((uint64_t)body.firstVertex + body.numberOfVertices > mNumberOfVertices) return nullptr;
+   return mVertices + body.firstVertex;
+}
+
+const Vec2f* Scene::getNormals(const Body& body) const
+{
+   if ((uint64_t)body.firstVertex + body.numberOfVertices > mNumberOfVertices) return nullptr;
+   return mNormals + body.firstVertex;
+}
+
+unsigned Scene::getNumberOfNodes() const
+{
+   return mNumberOfNodes;
+}
+
+const Scene::Node& Scene::getNode(unsigned i) const
+{
+   return mNodes[i];
+}
+
+bool Scene::query(const Shape::BoundingBox& boundingBox, std::vector<unsigned>& bodies) const
+{
+   if (mNumberOfNodes == 0) return true;
+
+   //Each level leaves at most one sibling waiting on the stack, so a tree no
+   //deeper than MAX_DEPTH always fits.
+   unsigned stack[StaticTree::MAX_DEPTH + 1];
+   unsigned stackSize = 0;
+   stack[stackSize++] = 0;
+   while (stackSize > 0)
+   {
+      unsigned index = stack[--stackSize];
+      const Node& node = mNodes[index];
+      if (!overlaps(node.boundingBox, boundingBox)) continue;
+
+      if (node.count > 0)
+      {
+         if ((uint64_t)node.first + node.count > mNumberOfBodies) return false;
+         for (unsigned i = node.first; i < node.first + node.count; i++)
+            if (overlaps(mBodies[i].boundingBox, boundingBox)) bodies.push_back(i);
+         continue;
+      }
+
+      //Children come after their parent, so the tree can't loop.
+      if (node.first <= index || (uint64_t)node.first + 1 >= mNumberOfNodes) return false;
+      if (stackSize + 2 > StaticTree::MAX_DEPTH + 1) return false;
+      stack[stackSize++] = node.first;
+      stack[stackSize++] = node.first + 1;
+   }
+   return true;
+}
+
+bool Scene::addBodies(World& world, const std::string& name) const
+{
+   bool isComplete = true;
+   for (unsigned i = 0; i < mNumberOfBodies; i++)
+   {
+      const Body& body = mBodies[i];
+      const Vec2f* vertices = getVertices(body);
+      std::shared_ptr<const Shape> shape;
+      if (body.shapeType == Shape::CIRCLE) shape = ShapeCache::getCircle(body.radius);
+      else if (body.shapeType == Shape::RECTANGLE) shape = ShapeCache::getRectangle(body.width, body.height);
+      else if (body.shapeType == Shape::POLYGON && vertices)
+         shape = ShapeCache::getPolygon(std::vector<Vec2f>(vertices, vertices + body.numberOfVertices));
+      if (!shape)
+      {
+         isComplete = false;
+         continue;
+      }
+
+      RigidBody& rigidBody = world.addBody(name);
+      rigidBody.setBodyType(RigidBody::STATIC);
+      rigidBody.setLayer(body.layer);
+      rigidBody.setMaterial(RigidBody::Material{body.density, body.staticFriction,
+                                                body.kineticFriction, body.restitution});
+      rigidBody.setShape(shape);
+      Transform& transform = rigidBody.getTransform();
+      transform.setTranslation(Vec2f(body.x, body.y));
+      transform.mRotationMatrix = Mat22f(body.cosine, body.sine, -body.sine, body.cosine);
+      transform.mAngle = body.angle;
+      transform.mIsAngleStale = false;
+   }
+   return isComplete;
+}
+
+}
@@ -0,0 +1,231 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_SCENE_HPP_
+#define FZX_SCENE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Shape.hpp"
+#include "StaticTree.hpp"
+
+namespace fzx
+{
+
+class World;
+
+/**
+ * A read-only file of static geometry that is memory-mapped and used in place.
+ *
+ * The file holds the shape, transform, bounding box, material and mass data of
+ * every static RigidBody, the vertices and normals of their Polygons, and a
+ * prebuilt bounding volume tree over them. Opening a Scene doesn't parse or
+ * copy anything, and since the mapping is read-only and shared, any number of
+ * Worlds in a process can use the same Scene. addBodies() puts the bodies in a
+ * World, so the World collides with them.
+ *
+ * open() only checks the header, so opening touches one page whatever the size
+ * of the file. The ranges of the nodes are checked as query() visits them, and
+ * those of the vertices by getVertices() and getNormals().
+ *
+ * The file is little-endian and can only be opened on little-endian machines.
+ */
+class Scene
+{
+public:
+   static const uint32_t MAGIC = 0x53585A46; ///< "FZXS" in little-endian.
+   static const uint32_t VERSION = 1; ///< The version of the layout written.
+
+   /**
+    * The data of one static body, with everything the broad and narrow phases
+    * need already computed.
+    */
+   struct Body
+   {
+      uint32_t shapeType; ///< The Shape::ShapeType of the body.
+      uint32_t firstVertex; ///< The index of the first vertex of a Polygon.
+      uint32_t numberOfVertices; ///< The number of vertices of a Polygon.
+      int32_t layer; ///< The layer the body resides on.
+      float width, height; ///< The dimensions of a Rectangle.
+      float radius; ///< The radius of the circle that sorrounds the Shape.
+      float x, y; ///< The translation of the body.
+      float angle, cosine, sine; ///< The rotation of the body, with the exact matrix it had.
+      Shape::BoundingBox boundingBox; ///< The world-space BoundingBox.
+      float density, staticFriction, kineticFriction, restitution;
+      float mass, inverseMass, inertia, inverseInertia;
+   };
+
+   /**
+    * A node of the bounding volume tree, laid out as a StaticTree::Node.
+    *
+    * Internal nodes have two children stored next to each other starting at
+    * first. Leaves have a count of bodies, which are stored contiguously
+    * starting at first.
+    */
+   typedef StaticTree::Node Node;
+private:
+   const unsigned char* mData; ///< The start of the mapping.
+   std::size_t mSize; ///< The size of the mapping in bytes.
+   const Body* mBodies; ///< The bodies, in tree order.
+   const Vec2f* mVertices; ///< The local vertices of all the Polygons.
+   const Vec2f* mNormals; ///< The local normals of all the Polygons.
+   const Node* mNodes; ///< The tree, with the root at index 0.
+   uint32_t mNumberOfBodies; ///< The number of bodies in the Scene.
+   uint32_t mNumberOfVertices; ///< The number of Polygon vertices.
+   uint32_t mNumberOfNodes; ///< The number of nodes in the tree.
+
+   //A mapping can't be shared by copying the object that owns it.
+   Scene(const Scene&);
+   Scene& operator=(const Scene&);
+public:
+   /**
+    * Creates an empty Scene.
+    */
+   Scene();
+
+   /**
+    * Destroys the Scene and unmaps its file.
+    */
+   ~Scene();
+
+   /**
+    * Writes every STATIC RigidBody of a World into a scene file.
+    *
+    * This is the expensive part: the tree is built and everything is
+    * precomputed here, so that opening the file costs nothing. The tree is no
+    * deeper than StaticTree::MAX_DEPTH.
+    *
+    * @param  path The path of the file to write.
+    * @param  world The World whose static bodies will be written.
+    * @return Whether the file was written. False if the file would be larger
+    *         than the 32-bit offsets can address.
+    */
+   static bool write(const std::string& path, World& world);
+
+   /**
+    * Memory-maps a scene file.
+    *
+    * Any file the Scene already had open is closed first.
+    *
+    * @param  path The path of the file to open.
+    * @return Whether the file was mapped and its header is valid.
+    */
+   bool open(const std::string& path);
+
+   /**
+    * Unmaps the scene file. The Scene is empty afterwards.
+    */
+   void close();
+
+   /**
+    * Checks whether a file is mapped.
+    *
+    * @return Whether the Scene has a file open.
+    */
+   bool isOpen() const;
+
+   /**
+    * Returns the number of bodies in the Scene.
+    *
+    * @return The number of bodies in the Scene.
+    */
+   unsigned getNumberOfBodies() const;
+
+   /**
+    * Returns a body given an index.
+    *
+    * @param  i The index of the body.
+    * @return A constant reference to the body.
+    */
+   const Body& getBody(unsigned i) const;
+
+   /**
+    * Returns the local vertices of a Polygon body.
+    *
+    * @param  body The body, which must have a Polygon shape.
+    * @return A pointer to body.numberOfVertices vertices, or null if the
+    *         file puts them out of range.
+    */
+   const Vec2f* getVertices(const Body& body) const;
+
+   /**
+    * Returns the local normals of a Polygon body.
+    *
+    * @param  body The body, which must have a Polygon shape.
+    * @return A pointer to body.numberOfVertices normals, or null if the file
+    *         puts them out of range.
+    */
+   const Vec2f* getNormals(const Body& body) const;
+
+   /**
+    * Returns the number of nodes in the tree.
+    *
+    * @return The number of nodes in the tree.
+    */
+   unsigned getNumberOfNodes() const;
+
+   /**
+    * Returns a node of the tree given an index. The root is at index 0.
+    *
+    * @param  i The index of the node.
+    * @return A constant reference to the node.
+    */
+   const Node& getNode(unsigned i) const;
+
+   /**
+    * Finds the bodies whose BoundingBoxes intersect a given BoundingBox.
+    *
+    * The search stops at the first node out of range, or deeper than
+    * StaticTree::MAX_DEPTH, which only a file not made by write() can hold.
+    *
+    * @param  boundingBox The BoundingBox to test against.
+    * @param  bodies The list the indices of the intersecting bodies are
+    *         appended to.
+    * @return Whether the whole tree could be searched. If not, bodies may be
+    *         missing.
+    */
+   bool query(const Shape::BoundingBox& boundingBox, std::vector<unsigned>& bodies) const;
+
+   /**
+    * Adds a STATIC RigidBody to a World for every body of the Scene.
+    *
+    * The bodies get the exact translation and rotation matrix that were
+    * written, and their Shapes come from the ShapeCache, so every World the
+    * Scene is added to shares one instance of each Shape.
+    *
+    * @param  world The World the bodies are added to.
+    * @param  name The name of the new RigidBodys.
+    * @return Whether every body was added. Bodies with an unknown shape type
+    *         or vertices out of range are skipped.
+    */
+   bool addBodies(World& world, const std::string& name) const;
+};
+
+}
+
+#endif /*FZX_SCENE_HPP_*/
@@ -0,0 +1,206 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "SeparatingAxisCache.hpp"
+#include "Circle.hpp"
+#include "Polygon.hpp"
+#include "Rectangle.hpp"
+#include "RigidBody.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace fzx
+{
+
+namespace
+{
+
+/**
+ * Returns the number of faces of a Shape: the sides of a Rectangle or a
+ * Polygon, and none for a Circle.
+ */
+unsigned getNumberOfFaces(const Shape& shape)
+{
+   if (shape.getType() == Shape::RECTANGLE) return 4;
+   if (shape.getType() == Shape::POLYGON) return static_cast<const Polygon&>(shape).getNumberOfVertices();
+   return 0;
+}
+
+/**
+ * Finds the outward normal of a face in real space, and how far the face is
+ * along it. The sides of a Rectangle face +x, +y, -x and -y in that order,
+ * like in Rectangle::collide().
+ */
+void getFace(const Shape& shape, const Transform& transform, unsigned face, Vec2f& normal, float& offset)
+{
+   const Mat22f& rotation = transform.getRotationMatrix();
+   if (shape.getType() == Shape::RECTANGLE)
+   {
+      const Rectangle& rectangle = static_cast<const Rectangle&>(shape);
+      bool isX = face % 2 == 0;
+      normal = isX ? rotation.getLeftColumn() : rotation.getRightColumn();
+      if (face >= 2) normal = normal * -1;
+      offset = normal * transform.getTranslation() + (isX ? rectangle.getWidth() : rectangle.getHeight()) / 2;
+      return;
+   }
+
+   //Polygons keep their vertices in the order given, so the normal is turned
+   //around if the vertex after the face is in front of it.
+   const Polygon& polygon = static_cast<const Polygon&>(shape);
+   unsigned count = polygon.getNumberOfVertices();
+   const Vec2f& vertex = polygon.getVertix(face);
+   normal = polygon.getNormal(face);
+   if (normal * (polygon.getVertix((face + 2) % count) - vertex) > 0) normal = normal * -1;
+   normal = rotation * normal;
+   offset = normal * transform.apply(vertex);
+}
+
+/**
+ * Returns the lowest projection of a Shape onto a unit direction.
+ */
+float getLowest(const Shape& shape, const Transform& transform, const Vec2f& direction)
+{
+   const Mat22f& rotation = transform.getRotationMatrix();
+   float center = direction * transform.getTranslation();
+   if (shape.getType() == Shape::CIRCLE) return center - shape.getRadius();
+
+   //The direction in the Shape's own space.
+   Vec2f local(direction * rotation.getLeftColumn(), direction * rotation.getRightColumn());
+   if (shape.getType() == Shape::RECTANGLE)
+   {
+      const Rectangle& rectangle = static_cast<const Rectangle&>(shape);
+      return center - (rectangle.getWidth() * std::abs(local.x) + rectangle.getHeight() * std::abs(local.y)) / 2;
+   }
+
+   const Polygon& polygon = static_cast<const Polygon&>(shape);
+   float lowest = polygon.getVertix(0) * local;
+   for (unsigned i = 1; i < polygon.getNumberOfVertices(); i++)
+      lowest = std::min(lowest, polygon.getVertix(i) * local);
+   return center + lowest;
+}
+
+/**
+ * Returns how far a RigidBody is outside a face of another one, negative if
+ * some of it is behind the face.
+ */
+float getSeparation(const RigidBody& owner, const RigidBody& other, unsigned face)
+{
+   Vec2f normal;
+   float offset;
+   getFace(owner.getShape(), owner.getTransform(), face, normal, offset);
+   return getLowest(other.getShape(), other.getTransform(), normal) - offset;
+}
+
+}
+
+SeparatingAxisCache::SeparatingAxisCache() : mStep(0), mStats(), mLastStats() {}
+
+bool SeparatingAxisCache::isSeparated(RigidBody& bodyA, RigidBody& bodyB)
+{
+   //Circles have no faces, so two of them can't be found apart here.
+   if (getNumberOfFaces(bodyA.getShape()) == 0 && getNumberOfFaces(bodyB.getShape()) == 0) return false;
+   mStats.checks++;
+
+   //Pairs are kept by id, so the order they come in doesn't matter.
+   bool isSwapped = bodyB.getId() < bodyA.getId();
+   RigidBody* bodies[2] = {isSwapped ? &bodyB : &bodyA, isSwapped ? &bodyA : &bodyB};
+   Key key(bodies[0]->getId(), bodies[1]->getId());
+
+   //Most of the time the face that separated the pair last step still does.
+   unsigned cachedFace = 0, cachedOwner = 2;
+   AxisMap::iterator cached = mAxes.find(key);
+   if (cached != mAxes.end()
+       && cached->second.face >= getNumberOfFaces(bodies[cached->second.isOnSecond ? 1 : 0]->getShape()))
+   {
+      //The owner's shape was changed to one with fewer faces.
+      mAxes.erase(cached);
+      cached = mAxes.end();
+   }
+   if (cached != mAxes.end())
+   {
+      cachedFace = cached->second.face;
+      cachedOwner = cached->second.isOnSecond ? 1 : 0;
+      if (getSeparation(*bodies[cachedOwner], *bodies[1 - cachedOwner], cachedFace) > 0)
+      {
+         cached->second.step = mStep;
+         mStats.hits++;
+         mStats.separated++;
+         return true;
+      }
+   }
+
+   mStats.searches++;
+   for (unsigned owner = 0; owner < 2; owner++)
+   {
+      unsigned numberOfFaces = getNumberOfFaces(bodies[owner]->getShape());
+      for (unsigned face = 0; face < numberOfFaces; face++)
+      {
+         if (owner == cachedOwner && face == cachedFace) continue;
+         if (getSeparation(*bodies[owner], *bodies[1 - owner], face) <= 0) continue;
+
+         Axis& axis = mAxes[key];
+         axis.face = face;
+         axis.isOnSecond = owner == 1;
+         axis.step = mStep;
+         mStats.separated++;
+         return true;
+      }
+   }
+
+   if (cached != mAxes.end()) mAxes.erase(cached);
+   return false;
+}
+
+void SeparatingAxisCache::endStep()
+{
+   for (AxisMap::iterator axis = mAxes.begin(); axis != mAxes.end();)
+   {
+      if (axis->second.step != mStep) axis = mAxes.erase(axis);
+      else ++axis;
+   }
+   mStep++;
+   mLastStats = mStats;
+   mStats = Stats();
+}
+
+void SeparatingAxisCache::clear()
+{
+   mAxes.clear();
+   mStats = Stats();
+   mLastStats = Stats();
+}
+
+const SeparatingAxisCache::Stats& SeparatingAxisCache::getStats() const
+{
+   return mLastStats;
+}
+
+unsigned SeparatingAxisCache::getNumberOfPairs() const
+{
+   return mAxes.size();
+}
+
+}
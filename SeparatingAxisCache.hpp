@@ -0,0 +1,152 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_SEPARATING_AXIS_CACHE_HPP_
+#define FZX_SEPARATING_AXIS_CACHE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+
+#include "Memory.hpp"
+
+namespace fzx
+{
+
+class RigidBody;
+
+/**
+ * Remembers, for each pair of RigidBodys that was apart, the face that
+ * separated them, so the next step can try that face first.
+ *
+ * A face of a Rectangle or Polygon separates two bodies when the other body
+ * lies entirely outside of it. Bodies rarely move far in one step, so a face
+ * that separated them usually still does, and a pair that overlaps in the
+ * broad phase without touching costs one projection instead of a full
+ * separating axis test. Only when the cached face fails are all the faces of
+ * both bodies searched. Circles have no faces, so two Circles are never
+ * found apart here and are left to the Collision.
+ *
+ * Call isSeparated() for each pair from the broad phase, skip the Collision of
+ * the pairs it returns true for, and call endStep() once after each step.
+ * BroadPhase does this for the pairs it reports.
+ */
+class SeparatingAxisCache
+{
+public:
+   /**
+    * The checks of one step.
+    */
+   struct Stats
+   {
+      unsigned checks; ///< The pairs checked.
+      unsigned hits; ///< The pairs still separated by their cached face.
+      unsigned searches; ///< The pairs whose faces had to be searched.
+      unsigned separated; ///< The pairs found apart, by cache or by search.
+   };
+private:
+   /**
+    * The face that last separated a pair.
+    */
+   struct Axis
+   {
+      unsigned face; ///< The index of the face on its body.
+      bool isOnSecond; ///< Whether the face belongs to the body with the higher id.
+      unsigned step; ///< The step the pair was last found apart.
+   };
+
+   /**
+    * Hashes a pair of RigidBody ids.
+    */
+   struct PairHash
+   {
+      std::size_t operator()(const std::pair<uint64_t, uint64_t>& pair) const
+      {
+         std::hash<uint64_t> hash;
+         return hash(pair.first) * 31 + hash(pair.second);
+      }
+   };
+
+   typedef std::pair<uint64_t, uint64_t> Key;
+   typedef std::unordered_map<Key, Axis, PairHash, std::equal_to<Key>,
+                              TrackingAllocator<std::pair<const Key, Axis>, Memory::COLLISIONS>> AxisMap;
+
+   AxisMap mAxes; ///< The separating face of each pair that was apart, by the ids of the pair in order.
+   unsigned mStep; ///< The number of steps ended.
+   Stats mStats; ///< The checks of the current step.
+   Stats mLastStats; ///< The checks of the last ended step.
+public:
+   /**
+    * Creates an empty SeparatingAxisCache.
+    */
+   SeparatingAxisCache();
+
+   /**
+    * Checks whether a face of either RigidBody separates them, trying the face
+    * that separated them last first.
+    *
+    * A false result doesn't mean the bodies touch, only that no face of theirs
+    * separates them, and their Collision should be solved as usual.
+    *
+    * @param  bodyA The first RigidBody.
+    * @param  bodyB The second RigidBody.
+    * @return Whether the bodies are apart.
+    */
+   bool isSeparated(RigidBody& bodyA, RigidBody& bodyB);
+
+   /**
+    * Forgets the pairs that weren't found apart this step, and publishes the
+    * Stats of the step.
+    */
+   void endStep();
+
+   /**
+    * Forgets every pair.
+    *
+    * Pairs are kept by RigidBody id, which is never reused, so a removed
+    * body's pairs simply expire at the next endStep().
+    */
+   void clear();
+
+   /**
+    * Returns the checks of the last ended step.
+    *
+    * @return A constant reference to the Stats.
+    */
+   const Stats& getStats() const;
+
+   /**
+    * Returns the number of pairs with a cached face.
+    *
+    * @return The number of pairs.
+    */
+   unsigned getNumberOfPairs() const;
+};
+
+}
+
+#endif /*FZX_SEPARATING_AXIS_CACHE_HPP_*/
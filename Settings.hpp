@@ -7,4 +7,9 @@ const float MINIMUM_ANGULAR_VELOCITY_FOR_AWAKING = .5f;
 const float PENETRATION_SEPERATION_PERCENTAGE = .5;
 const float PENETRATION_SLOP = 0.01;
 
+const float POSITION_CORRECTION_PERCENTAGE = .2f;
+const float MAXIMUM_POSITION_CORRECTION = .2f;
+
+const float MAXIMUM_INCREMENTAL_ROTATION = .25;
+
 #endif /*FZX_SETTINGS_HPP_*/
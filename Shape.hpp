@@ -26,6 +26,7 @@
 #ifndef FZX_SHAPE_HPP_
 #define FZX_SHAPE_HPP_
 
+#include "Memory.hpp"
 #include "Transform.hpp"
 #include "Vec2.hpp"
 
@@ -54,6 +55,9 @@ public:
 		Vec2f lowerLeft, upperRight;
 	};
 
+	//Shapes are accounted to Memory::SHAPES.
+	FZX_TRACK_ALLOCATIONS(SHAPES)
+
 	//Destructor made virtual to allow subclasses to override it
 	virtual ~Shape(){};
 
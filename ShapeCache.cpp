@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "ShapeCache.hpp"
+#include "Circle.hpp"
+#include "Rectangle.hpp"
+#include "Polygon.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace fzx
+{
+
+namespace
+{
+
+/**
+ * The interned Shapes, by a key made of their type and parameters.
+ */
+struct Cache
+{
+   std::mutex mutex;
+   std::unordered_map<std::string, std::weak_ptr<const Shape>> shapes;
+};
+
+Cache& getCache()
+{
+   //Never destroyed, so Shapes released during static destruction still find it.
+   static Cache* cache = new Cache;
+   return *cache;
+}
+
+/**
+ * Forgets a Shape when the last pointer to it is released, then deletes it.
+ */
+struct Release
+{
+   std::string key;
+
+   void operator()(const Shape* shape) const
+   {
+      Cache& cache = getCache();
+      {
+         std::lock_guard<std::mutex> lock(cache.mutex);
+         auto entry = cache.shapes.find(key);
+         //Another thread may have interned a new Shape under the key already.
+         if (entry != cache.shapes.end() && entry->second.expired()) cache.shapes.erase(entry);
+      }
+      delete shape;
+   }
+};
+
+/**
+ * Returns the key of a Shape. The key is built in a buffer kept per thread,
+ * so looking up a Shape that exists allocates nothing.
+ */
+const std::string& makeKey(Shape::ShapeType type, const float* parameters, unsigned count)
+{
+   thread_local std::string key;
+   key.assign(1, (char)type);
+   key.append(reinterpret_cast<const char*>(parameters), count * sizeof(float));
+   return key;
+}
+
+/**
+ * Returns the Shape under a key, creating it with a function if there is none.
+ */
+template <typename Create>
+std::shared_ptr<const Shape> intern(const std::string& key, Create create)
+{
+   Cache& cache = getCache();
+   std::lock_guard<std::mutex> lock(cache.mutex);
+   std::weak_ptr<const Shape>& entry = cache.shapes[key];
+   std::shared_ptr<const Shape> shape = entry.lock();
+   if (!shape)
+   {
+      shape = std::shared_ptr<const Shape>(create(), Release{key},
+                                           TrackingAllocator<char, Memory::SHAPES>());
+      entry = shape;
+   }
+   return shape;
+}
+
+}
+
+std::shared_ptr<const Shape> ShapeCache::getCircle(float radius)
+{
+   return intern(makeKey(Shape::CIRCLE, &radius, 1), [=] { return new Circle(radius); });
+}
+
+std::shared_ptr<const Shape> ShapeCache::getRectangle(float width, float height)
+{
+   const float parameters[2] = {width, height};
+   return intern(makeKey(Shape::RECTANGLE, parameters, 2),
+                 [=] { return new Rectangle(width, height); });
+}
+
+std::shared_ptr<const Shape> ShapeCache::getPolygon(const std::vector<Vec2f>& vertices)
+{
+   static_assert(sizeof(Vec2f) == 2 * sizeof(float), "Vec2f must be two packed floats");
+   return intern(makeKey(Shape::POLYGON, reinterpret_cast<const float*>(vertices.data()),
+                         2 * vertices.size()),
+                 [&] { return new Polygon(vertices); });
+}
+
+bool ShapeCache::getPolygonVertices(const std::shared_ptr<const Shape>& shape,
+                                    std::vector<Vec2f>& vertices)
+{
+   //The key of an interned Shape lives in its deleter and never changes.
+   const Release* release = std::get_deleter<Release>(shape);
+   if (release == nullptr || release->key[0] != (char)Shape::POLYGON) return false;
+
+   std::size_t count = (release->key.size() - 1) / sizeof(Vec2f);
+   vertices.resize(count);
+   if (count) std::memcpy(vertices.data(), release->key.data() + 1, count * sizeof(Vec2f));
+   return true;
+}
+
+unsigned ShapeCache::getNumberOfShapes()
+{
+   Cache& cache = getCache();
+   std::lock_guard<std::mutex> lock(cache.mutex);
+   return cache.shapes.size();
+}
+
+}
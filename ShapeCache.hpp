@@ -0,0 +1,96 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_SHAPE_CACHE_HPP_
+#define FZX_SHAPE_CACHE_HPP_
+
+#include <memory>
+#include <vector>
+
+#include "Shape.hpp"
+
+namespace fzx
+{
+
+/**
+ * Interns Shapes so that RigidBodys with the same geometry share one
+ * immutable instance.
+ *
+ * Asking twice for a Shape with the same parameters returns the same instance
+ * for as long as anything holds it. A Shape is destroyed, and forgotten by the
+ * cache, when the last body using it lets go. The cache is thread safe.
+ */
+class ShapeCache
+{
+public:
+   /**
+    * Returns the shared Circle of a radius.
+    *
+    * @param  radius The radius of the Circle.
+    * @return A shared pointer to the Circle.
+    */
+   static std::shared_ptr<const Shape> getCircle(float radius);
+
+   /**
+    * Returns the shared Rectangle of some dimensions.
+    *
+    * @param  width The width of the Rectangle.
+    * @param  height The height of the Rectangle.
+    * @return A shared pointer to the Rectangle.
+    */
+   static std::shared_ptr<const Shape> getRectangle(float width, float height);
+
+   /**
+    * Returns the shared Polygon built from some vertices.
+    *
+    * Polygons are matched by the vertices they were built from, before they
+    * are made convex and centered.
+    *
+    * @param  vertices The vertices of the Polygon.
+    * @return A shared pointer to the Polygon.
+    */
+   static std::shared_ptr<const Shape> getPolygon(const std::vector<Vec2f>& vertices);
+
+   /**
+    * Returns the vertices a Polygon from getPolygon() was built from.
+    *
+    * @param  shape The Shape.
+    * @param  vertices Set to the vertices given to getPolygon().
+    * @return False if the Shape is not a Polygon from getPolygon().
+    */
+   static bool getPolygonVertices(const std::shared_ptr<const Shape>& shape,
+                                  std::vector<Vec2f>& vertices);
+
+   /**
+    * Returns the number of distinct Shapes alive.
+    *
+    * @return The number of interned Shapes.
+    */
+   static unsigned getNumberOfShapes();
+};
+
+}
+
+#endif /*FZX_SHAPE_CACHE_HPP_*/
@@ -0,0 +1,168 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "StateHash.hpp"
+#include "World.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace fzx
+{
+
+namespace
+{
+
+/**
+ * Finalizer of SplitMix64, spreads every input bit over the whole output.
+ */
+uint64_t mix(uint64_t value)
+{
+   value ^= value >> 30;
+   value *= 0xBF58476D1CE4E5B9ULL;
+   value ^= value >> 27;
+   value *= 0x94D049BB133111EBULL;
+   value ^= value >> 31;
+   return value;
+}
+
+/**
+ * Folds the exact bit pattern of a float into a running hash.
+ */
+uint64_t combine(uint64_t hash, float value)
+{
+   uint32_t bits;
+   std::memcpy(&bits, &value, sizeof(bits));
+   return mix(hash ^ bits);
+}
+
+/**
+ * Returns the cell of a coordinate, clamped so the cast is defined. NaN
+ * lands in cell 0, and coordinates too large for an int in the outermost cells.
+ */
+int getCell(float coordinate, float regionSize)
+{
+   float cell = std::floor(coordinate / regionSize);
+   if (cell != cell) return 0;
+   if (cell <= -2147483648.0f) return std::numeric_limits<int32_t>::min();
+   if (cell >= 2147483648.0f) return std::numeric_limits<int32_t>::max();
+   return (int)cell;
+}
+
+uint64_t packCell(int x, int y)
+{
+   return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+}
+
+}
+
+StateHasher::StateHasher(float regionSize) :
+   mHash(0), mRegionSize(regionSize), mTracksRegions(regionSize > 0) {}
+
+void StateHasher::reset()
+{
+   mHash = 0;
+   mRegions.clear();
+}
+
+void StateHasher::addBody(unsigned index, const RigidBody& body)
+{
+   const Transform& transform = body.getTransform();
+   const Vec2f& position = transform.getTranslation();
+   //The matrix is always current, unlike the angle, which may need an atan2.
+   const Vec2f& rotation = transform.getRotationMatrix().getLeftColumn();
+   Vec2f velocity = body.getPush(RigidBody::VELOCITY);
+
+   uint64_t hash = mix(index + 0x9E3779B97F4A7C15ULL);
+   hash = combine(hash, position.x);
+   hash = combine(hash, position.y);
+   hash = combine(hash, rotation.x);
+   hash = combine(hash, rotation.y);
+   hash = combine(hash, velocity.x);
+   hash = combine(hash, velocity.y);
+   hash = combine(hash, body.getTwist(RigidBody::VELOCITY));
+   hash = mix(hash ^ (body.isSleeping() ? 1 : 0));
+
+   mHash += hash;
+   if (mTracksRegions)
+   {
+      mRegions[packCell(getCell(position.x, mRegionSize), getCell(position.y, mRegionSize))] += hash;
+   }
+}
+
+void StateHasher::addWorld(World& world)
+{
+   for (unsigned i = 0; i < world.getNumberOfBodies(); i++)
+      addBody(i, world.getBody(i));
+}
+
+uint64_t StateHasher::getHash() const
+{
+   return mHash;
+}
+
+uint64_t StateHasher::getRegionHash(int x, int y) const
+{
+   std::unordered_map<uint64_t, uint64_t>::const_iterator region;
+   region = mRegions.find(packCell(x, y));
+   if (region == mRegions.end()) return 0;
+   return region->second;
+}
+
+std::vector<StateHasher::RegionHash> StateHasher::getRegionHashes() const
+{
+   std::vector<RegionHash> output;
+   output.reserve(mRegions.size());
+   for (const auto& region : mRegions)
+   {
+      RegionHash regionHash;
+      regionHash.x = (int)(uint32_t)(region.first >> 32);
+      regionHash.y = (int)(uint32_t)region.first;
+      regionHash.hash = region.second;
+      output.push_back(regionHash);
+   }
+   std::sort(output.begin(), output.end(),
+      [](const RegionHash& a, const RegionHash& b)
+      {
+         return a.y != b.y ? a.y < b.y : a.x < b.x;
+      });
+   return output;
+}
+
+float StateHasher::getRegionSize() const
+{
+   return mRegionSize;
+}
+
+void StateHasher::setRegionSize(float regionSize)
+{
+   mRegionSize = regionSize;
+   mTracksRegions = regionSize > 0;
+   mRegions.clear();
+}
+
+}
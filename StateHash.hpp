@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_STATE_HASH_HPP_
+#define FZX_STATE_HASH_HPP_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "RigidBody.hpp"
+
+namespace fzx
+{
+
+class World;
+
+/**
+ * Computes a 64-bit hash of the state of RigidBodys for desync detection.
+ *
+ * Bodies are fed in one at a time, so the hash can be accumulated in the same
+ * pass that integrates them. Each body is hashed on its own and the results are
+ * summed, which makes the hash independent of the order bodies are added in.
+ * The same sums are also kept per region of a uniform grid, so a mismatch can
+ * be narrowed down to a region without comparing the whole World.
+ */
+class StateHasher
+{
+public:
+   /**
+    * The hash of all the bodies inside one cell of the grid.
+    */
+   struct RegionHash
+   {
+      int x; ///< The column of the cell.
+      int y; ///< The row of the cell.
+      uint64_t hash; ///< The combined hash of the bodies in the cell.
+   };
+private:
+   std::unordered_map<uint64_t, uint64_t> mRegions; ///< The hash per packed cell.
+   uint64_t mHash; ///< The combined hash of every body added.
+   float mRegionSize; ///< The width and height of a grid cell.
+   bool mTracksRegions; ///< Whether region hashes are computed.
+public:
+   /**
+    * Creates a StateHasher with a given region size.
+    *
+    * @param regionSize The width and height of a grid cell. If it's zero or
+    * less, region hashes aren't kept.
+    */
+   StateHasher(float regionSize = 0);
+
+   /**
+    * Clears the hash so a new step can be hashed.
+    */
+   void reset();
+
+   /**
+    * Adds the state of a RigidBody to the hash.
+    *
+    * The position, rotation matrix, velocity, angular velocity and sleep flag
+    * are hashed along with the index, so two bodies swapping states is still
+    * detected. A position that is NaN or too far out for an int cell is
+    * counted in cell 0 or the outermost cell.
+    *
+    * @param index The index of the RigidBody in the World.
+    * @param body The RigidBody to hash.
+    */
+   void addBody(unsigned index, const RigidBody& body);
+
+   /**
+    * Hashes every RigidBody of a World in one pass.
+    *
+    * @param world The World to hash.
+    */
+   void addWorld(World& world);
+
+   /**
+    * Returns the hash of all the bodies added since the last reset.
+    *
+    * @return The 64-bit hash.
+    */
+   uint64_t getHash() const;
+
+   /**
+    * Returns the hash of the bodies in a given region.
+    *
+    * @param x The column of the cell.
+    * @param y The row of the cell.
+    * @return The hash of the region, or 0 if no body is in it.
+    */
+   uint64_t getRegionHash(int x, int y) const;
+
+   /**
+    * Returns the hashes of every non-empty region, sorted by row and column.
+    *
+    * @return The list of region hashes.
+    */
+   std::vector<RegionHash> getRegionHashes() const;
+
+   /**
+    * Returns the width and height of a grid cell.
+    *
+    * @return The region size.
+    */
+   float getRegionSize() const;
+
+   /**
+    * Sets the width and height of a grid cell, clearing the region hashes.
+    *
+    * @param regionSize The width and height of a grid cell. If it's zero or
+    * less, region hashes aren't kept.
+    */
+   void setRegionSize(float regionSize);
+};
+
+}
+
+#endif /*FZX_STATE_HASH_HPP_*/
@@ -0,0 +1,231 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "StaticTree.hpp"
+
+#include <algorithm>
+
+namespace fzx
+{
+
+namespace
+{
+
+const unsigned NUMBER_OF_BINS = 16; ///< The candidate split positions per node.
+
+Shape::BoundingBox merge(const Shape::BoundingBox& a, const Shape::BoundingBox& b)
+{
+   Shape::BoundingBox output;
+   output.lowerLeft.set(std::min(a.lowerLeft.x, b.lowerLeft.x),
+                        std::min(a.lowerLeft.y, b.lowerLeft.y));
+   output.upperRight.set(std::max(a.upperRight.x, b.upperRight.x),
+                         std::max(a.upperRight.y, b.upperRight.y));
+   return output;
+}
+
+bool overlaps(const Shape::BoundingBox& a, const Shape::BoundingBox& b)
+{
+   return a.lowerLeft.x <= b.upperRight.x && b.lowerLeft.x <= a.upperRight.x &&
+          a.lowerLeft.y <= b.upperRight.y && b.lowerLeft.y <= a.upperRight.y;
+}
+
+float getPerimeter(const Shape::BoundingBox& box)
+{
+   Vec2f extent = box.upperRight - box.lowerLeft;
+   return 2 * (extent.x + extent.y);
+}
+
+float getCenter(const Shape::BoundingBox& box, bool isX)
+{
+   return isX ? (box.lowerLeft.x + box.upperRight.x) / 2 : (box.lowerLeft.y + box.upperRight.y) / 2;
+}
+
+/**
+ * A bin of the surface area heuristic, holding the items whose centers fall in
+ * a slice of the node.
+ */
+struct Bin
+{
+   Shape::BoundingBox boundingBox;
+   unsigned count;
+};
+
+}
+
+void StaticTree::build(const Shape::BoundingBox* boxes, unsigned numberOfBoxes)
+{
+   clear();
+   if (numberOfBoxes == 0) return;
+
+   mItems.resize(numberOfBoxes);
+   mBoxes.assign(boxes, boxes + numberOfBoxes);
+   for (unsigned i = 0; i < numberOfBoxes; i++) mItems[i] = i;
+
+   //A binary tree with leaves of at least one item has fewer than 2n nodes.
+   mNodes.reserve(2 * numberOfBoxes);
+   mNodes.resize(1);
+   buildNode(0, 0, numberOfBoxes, 0);
+}
+
+void StaticTree::buildNode(unsigned nodeIndex, unsigned begin, unsigned end, unsigned depth)
+{
+   Shape::BoundingBox boundingBox = mBoxes[begin];
+   float centerX = getCenter(boundingBox, true), centerY = getCenter(boundingBox, false);
+   Shape::BoundingBox centers = {Vec2f(centerX, centerY), Vec2f(centerX, centerY)};
+   for (unsigned i = begin + 1; i < end; i++)
+   {
+      Vec2f center(getCenter(mBoxes[i], true), getCenter(mBoxes[i], false));
+      boundingBox = merge(boundingBox, mBoxes[i]);
+      centers = merge(centers, Shape::BoundingBox{center, center});
+   }
+   mNodes[nodeIndex].boundingBox = boundingBox;
+   mNodes[nodeIndex].first = begin;
+   mNodes[nodeIndex].count = end - begin;
+
+   unsigned count = end - begin;
+   Vec2f extent = centers.upperRight - centers.lowerLeft;
+   bool isX = extent.x >= extent.y;
+   float low = isX ? centers.lowerLeft.x : centers.lowerLeft.y;
+   float width = isX ? extent.x : extent.y;
+   if (count <= LEAF_SIZE || depth + 1 >= MAX_DEPTH || width <= 0) return;
+
+   //Sort the items into bins by center.
+   Bin bins[NUMBER_OF_BINS];
+   for (Bin& bin : bins) bin.count = 0;
+   float scale = NUMBER_OF_BINS / width;
+   for (unsigned i = begin; i < end; i++)
+   {
+      unsigned b = std::min(NUMBER_OF_BINS - 1, (unsigned)((getCenter(mBoxes[i], isX) - low) * scale));
+      bins[b].boundingBox = bins[b].count == 0 ? mBoxes[i] : merge(bins[b].boundingBox, mBoxes[i]);
+      bins[b].count++;
+   }
+
+   //Sweep from the right for the cost of every right side, then from the left
+   //to find the cheapest split.
+   float rightCosts[NUMBER_OF_BINS];
+   Shape::BoundingBox right = bins[NUMBER_OF_BINS - 1].boundingBox;
+   unsigned rightCount = 0;
+   for (unsigned b = NUMBER_OF_BINS - 1; b > 0; b--)
+   {
+      if (bins[b].count > 0)
+         right = rightCount == 0 ? bins[b].boundingBox : merge(right, bins[b].boundingBox);
+      rightCount += bins[b].count;
+      rightCosts[b] = rightCount == 0 ? 0 : getPerimeter(right) * rightCount;
+   }
+
+   float bestCost = getPerimeter(boundingBox) * count;
+   unsigned bestSplit = 0;
+   Shape::BoundingBox left = bins[0].boundingBox;
+   unsigned leftCount = 0;
+   for (unsigned b = 0; b + 1 < NUMBER_OF_BINS; b++)
+   {
+      if (bins[b].count > 0)
+         left = leftCount == 0 ? bins[b].boundingBox : merge(left, bins[b].boundingBox);
+      leftCount += bins[b].count;
+      if (leftCount == 0 || leftCount == count) continue;
+      float cost = getPerimeter(left) * leftCount + rightCosts[b + 1];
+      if (cost < bestCost)
+      {
+         bestCost = cost;
+         bestSplit = b + 1;
+      }
+   }
+   if (bestSplit == 0) return;
+
+   //Partition the items, keeping their boxes alongside.
+   unsigned middle = begin;
+   for (unsigned i = begin; i < end; i++)
+   {
+      unsigned b = std::min(NUMBER_OF_BINS - 1, (unsigned)((getCenter(mBoxes[i], isX) - low) * scale));
+      if (b < bestSplit)
+      {
+         std::swap(mItems[i], mItems[middle]);
+         std::swap(mBoxes[i], mBoxes[middle]);
+         middle++;
+      }
+   }
+
+   unsigned firstChild = mNodes.size();
+   mNodes[nodeIndex].first = firstChild;
+   mNodes[nodeIndex].count = 0;
+   mNodes.resize(mNodes.size() + 2);
+   buildNode(firstChild, begin, middle, depth + 1);
+   buildNode(firstChild + 1, middle, end, depth + 1);
+}
+
+void StaticTree::clear()
+{
+   mNodes.clear();
+   mItems.clear();
+   mBoxes.clear();
+}
+
+void StaticTree::query(const Shape::BoundingBox& boundingBox, std::vector<unsigned>& items) const
+{
+   if (mNodes.empty()) return;
+
+   //Each level leaves at most one sibling waiting on the stack.
+   unsigned stack[MAX_DEPTH + 1];
+   unsigned stackSize = 0;
+   stack[stackSize++] = 0;
+   while (stackSize > 0)
+   {
+      const Node& node = mNodes[stack[--stackSize]];
+      if (!overlaps(node.boundingBox, boundingBox)) continue;
+
+      if (node.count > 0)
+      {
+         for (unsigned i = node.first; i < node.first + node.count; i++)
+            if (overlaps(mBoxes[i], boundingBox)) items.push_back(mItems[i]);
+      }
+      else
+      {
+         stack[stackSize++] = node.first;
+         stack[stackSize++] = node.first + 1;
+      }
+   }
+}
+
+unsigned StaticTree::getNumberOfNodes() const
+{
+   return mNodes.size();
+}
+
+const StaticTree::Node& StaticTree::getNode(unsigned i) const
+{
+   return mNodes[i];
+}
+
+unsigned StaticTree::getNumberOfItems() const
+{
+   return mItems.size();
+}
+
+unsigned StaticTree::getItem(unsigned i) const
+{
+   return mItems[i];
+}
+
+}
@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_STATIC_TREE_HPP_
+#define FZX_STATIC_TREE_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "Memory.hpp"
+#include "Shape.hpp"
+
+namespace fzx
+{
+
+/**
+ * An immutable bounding volume tree over BoundingBoxes that don't move.
+ *
+ * It is built in one pass over every box with binned surface area heuristic
+ * splits, using the perimeter as the 2D surface area. Adding or removing boxes
+ * means building it again, so it suits static geometry that changes in batches
+ * if at all.
+ */
+class StaticTree
+{
+public:
+   static const unsigned MAX_DEPTH = 64; ///< The deepest a leaf can be, the root being 0.
+   static const unsigned LEAF_SIZE = 4; ///< The fewest items worth splitting.
+
+   /**
+    * A node of the tree.
+    *
+    * Internal nodes have two children stored next to each other starting at
+    * first. Leaves have a count of items, which are stored contiguously
+    * starting at first.
+    */
+   struct Node
+   {
+      Shape::BoundingBox boundingBox; ///< The box that sorrounds every item below.
+      uint32_t first; ///< The first child of an internal node, or the first item of a leaf.
+      uint32_t count; ///< The number of items in a leaf, 0 for internal nodes.
+   };
+private:
+   std::vector<Node, TrackingAllocator<Node, Memory::BROAD_PHASE>> mNodes; ///< The tree, with the root at index 0.
+   std::vector<unsigned, TrackingAllocator<unsigned, Memory::BROAD_PHASE>> mItems; ///< The index of each item, in leaf order.
+   std::vector<Shape::BoundingBox, TrackingAllocator<Shape::BoundingBox, Memory::BROAD_PHASE>> mBoxes; ///< The box of each item, in leaf order.
+
+   /**
+    * Builds the subtree of a node over a range of items.
+    */
+   void buildNode(unsigned nodeIndex, unsigned begin, unsigned end, unsigned depth);
+public:
+   /**
+    * Builds the tree over a set of boxes, replacing any previous tree.
+    *
+    * @param boxes          The boxes. Item i is boxes[i].
+    * @param numberOfBoxes  The number of boxes.
+    */
+   void build(const Shape::BoundingBox* boxes, unsigned numberOfBoxes);
+
+   /**
+    * Removes every item from the tree.
+    */
+   void clear();
+
+   /**
+    * Finds every item whose box overlaps a box.
+    *
+    * @param boundingBox The box to test against.
+    * @param items       The vector the indices of the overlapping items are
+    *                    appended to.
+    */
+   void query(const Shape::BoundingBox& boundingBox, std::vector<unsigned>& items) const;
+
+   /**
+    * Returns the number of nodes in the tree.
+    *
+    * @return The number of nodes.
+    */
+   unsigned getNumberOfNodes() const;
+
+   /**
+    * Returns a node of the tree.
+    *
+    * @param  i The index of the node, the root being 0.
+    * @return A constant reference to the Node.
+    */
+   const Node& getNode(unsigned i) const;
+
+   /**
+    * Returns the number of items in the tree.
+    *
+    * @return The number of items.
+    */
+   unsigned getNumberOfItems() const;
+
+   /**
+    * Returns the item stored at a position in leaf order.
+    *
+    * @param  i The position, as used by Node::first in leaves.
+    * @return The index of the item in the boxes the tree was built from.
+    */
+   unsigned getItem(unsigned i) const;
+};
+
+}
+
+#endif /*FZX_STATIC_TREE_HPP_*/
@@ -0,0 +1,117 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+
+#include "Trace.hpp"
+
+namespace fzx
+{
+
+ThreadPool::ThreadPool(unsigned numberOfThreads, const char* threadName) :
+   mThreadName(threadName), mTask(nullptr), mTaskName(""), mNumberOfIndices(0), mChunkSize(1),
+   mGeneration(0), mBusyThreads(0), mIsStopping(false), mNextIndex(0)
+{
+   if (numberOfThreads == 0) numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+   for (unsigned i = 1; i < numberOfThreads; i++)
+      mThreads.push_back(std::thread(&ThreadPool::work, this));
+}
+
+ThreadPool::~ThreadPool()
+{
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mIsStopping = true;
+   }
+   mWorkReady.notify_all();
+   for (std::thread& thread : mThreads) thread.join();
+}
+
+void ThreadPool::work()
+{
+   FZX_TRACE_THREAD_NAME(mThreadName);
+   unsigned generation = 0;
+   while (true)
+   {
+      {
+         std::unique_lock<std::mutex> lock(mMutex);
+         mWorkReady.wait(lock, [&] { return mIsStopping || mGeneration != generation; });
+         if (mIsStopping) return;
+         generation = mGeneration;
+      }
+      runChunks();
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (--mBusyThreads == 0) mWorkDone.notify_one();
+   }
+}
+
+void ThreadPool::runChunks()
+{
+   FZX_TRACE_SPAN(mTaskName);
+   while (true)
+   {
+      unsigned first = mNextIndex.fetch_add(mChunkSize, std::memory_order_relaxed);
+      if (first >= mNumberOfIndices) return;
+      unsigned last = std::min(first + mChunkSize, mNumberOfIndices);
+      for (unsigned i = first; i < last; i++) (*mTask)(i);
+   }
+}
+
+unsigned ThreadPool::getNumberOfThreads() const
+{
+   return mThreads.size() + 1;
+}
+
+void ThreadPool::forEach(unsigned numberOfIndices, unsigned chunkSize, const char* name,
+                         const std::function<void(unsigned)>& task)
+{
+   if (mThreads.empty() || numberOfIndices <= chunkSize)
+   {
+      FZX_TRACE_SPAN(name);
+      for (unsigned i = 0; i < numberOfIndices; i++) task(i);
+      return;
+   }
+
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mTask = &task;
+      mTaskName = name;
+      mNumberOfIndices = numberOfIndices;
+      mChunkSize = std::max(1u, chunkSize);
+      mNextIndex.store(0, std::memory_order_relaxed);
+      mBusyThreads = mThreads.size();
+      mGeneration++;
+   }
+   mWorkReady.notify_all();
+   runChunks();
+
+   std::unique_lock<std::mutex> lock(mMutex);
+   mWorkDone.wait(lock, [&] { return mBusyThreads == 0; });
+   mTask = nullptr;
+}
+
+}
@@ -0,0 +1,119 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_THREAD_POOL_HPP_
+#define FZX_THREAD_POOL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fzx
+{
+
+/**
+ * A pool of threads that runs a function over a range of indices, together
+ * with the calling thread.
+ *
+ * The indices are claimed in chunks from a shared counter, so threads that
+ * finish early take over the rest. Every thread records the work it takes
+ * part in as a trace span.
+ */
+class ThreadPool
+{
+private:
+   std::vector<std::thread> mThreads; ///< The helper threads of the pool.
+   const char* mThreadName; ///< The name of the helpers in the trace.
+   std::mutex mMutex; ///< Guards the members below.
+   std::condition_variable mWorkReady; ///< Wakes the helpers when work is posted.
+   std::condition_variable mWorkDone; ///< Wakes the caller when the helpers finish.
+   const std::function<void(unsigned)>* mTask; ///< The work being run, given an index.
+   const char* mTaskName; ///< The name of the span of the work being run.
+   unsigned mNumberOfIndices; ///< The number of indices of the work being run.
+   unsigned mChunkSize; ///< The number of indices claimed at once.
+   unsigned mGeneration; ///< Incremented every time work is posted.
+   unsigned mBusyThreads; ///< The helpers that haven't finished the work.
+   bool mIsStopping; ///< Whether the helpers should exit.
+   std::atomic<unsigned> mNextIndex; ///< The next index to be claimed.
+
+   /**
+    * The loop of a helper thread.
+    */
+   void work();
+
+   /**
+    * Claims and runs chunks of the current work until none is left.
+    */
+   void runChunks();
+
+   //The threads refer to the pool, so it can't be copied.
+   ThreadPool(const ThreadPool&);
+   ThreadPool& operator=(const ThreadPool&);
+public:
+   /**
+    * Starts the helper threads.
+    *
+    * @param numberOfThreads The number of threads work is spread over,
+    *                        including the calling thread. 0 uses one per
+    *                        hardware thread.
+    * @param threadName      The name of the helpers in the trace. It must
+    *                        outlive the pool.
+    */
+   ThreadPool(unsigned numberOfThreads, const char* threadName);
+
+   /**
+    * Stops and joins the helper threads.
+    */
+   ~ThreadPool();
+
+   /**
+    * Returns the number of threads work is spread over.
+    *
+    * @return The number of threads, including the calling one.
+    */
+   unsigned getNumberOfThreads() const;
+
+   /**
+    * Runs a function on every index from 0 to numberOfIndices, spread over
+    * the threads, and returns once every call is done.
+    *
+    * The function is called concurrently for different indices.
+    *
+    * @param numberOfIndices The number of indices.
+    * @param chunkSize       The number of indices a thread claims at once.
+    * @param name            The name of the span every thread records, which
+    *                        must outlive the trace.
+    * @param task            The function, given each index.
+    */
+   void forEach(unsigned numberOfIndices, unsigned chunkSize, const char* name,
+                const std::function<void(unsigned)>& task);
+};
+
+}
+
+#endif /*FZX_THREAD_POOL_HPP_*/
@@ -0,0 +1,341 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "Trace.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace fzx
+{
+
+namespace
+{
+
+/**
+ * One recorded event.
+ */
+struct Event
+{
+   const char* name;
+   int64_t start; ///< Nanoseconds since the recording started.
+   int64_t duration; ///< Nanoseconds for spans, the value for counters.
+   bool isCounter;
+};
+
+/**
+ * A single-producer, single-consumer ring of events owned by one thread.
+ */
+struct ThreadBuffer
+{
+   static const uint32_t CAPACITY = 1 << 14; ///< A power of two.
+
+   Event events[CAPACITY];
+   std::atomic<uint32_t> head; ///< The next slot the owning thread writes.
+   std::atomic<uint32_t> tail; ///< The next slot the writer thread reads.
+   uint32_t threadId;
+   const char* threadName;
+
+   ThreadBuffer(uint32_t id) : head(0), tail(0), threadId(id), threadName(nullptr) {}
+
+   bool push(const Event& event)
+   {
+      uint32_t currentHead = head.load(std::memory_order_relaxed);
+      if (currentHead - tail.load(std::memory_order_acquire) >= CAPACITY) return false;
+      events[currentHead & (CAPACITY - 1)] = event;
+      head.store(currentHead + 1, std::memory_order_release);
+      return true;
+   }
+};
+
+/**
+ * The state of the recording, shared by every thread.
+ */
+struct Recorder
+{
+   std::mutex mutex; ///< Guards buffers, file and the writer thread.
+   std::condition_variable wakeUp;
+   std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+   std::thread writer;
+   std::FILE* file;
+   TraceRecorder::Clock::time_point origin;
+   std::atomic<bool> isRecording;
+   std::atomic<uint64_t> droppedEvents;
+   uint32_t nextThreadId; ///< The id of the next thread to register a buffer.
+   bool isStopping; ///< Set from stop() until finish() has closed the file.
+   bool isFirstEvent;
+
+   Recorder() : file(nullptr), isRecording(false), droppedEvents(0), nextThreadId(1),
+                isStopping(false), isFirstEvent(true) {}
+
+   /**
+    * Finishes a recording still running when the program exits, since
+    * destroying a joinable writer thread would terminate it.
+    */
+   ~Recorder();
+
+   /**
+    * Joins the writer thread once isStopping is set, then writes the rest of
+    * the events, closes the file and clears isStopping.
+    */
+   void finish();
+};
+
+Recorder& getRecorder()
+{
+   static Recorder recorder;
+   return recorder;
+}
+
+/**
+ * Unregisters and frees the buffer of a thread when the thread exits.
+ */
+struct ThreadBufferOwner
+{
+   ThreadBuffer* buffer;
+
+   ThreadBufferOwner() : buffer(nullptr) {}
+
+   /**
+    * Writes what the thread recorded first, if a recording is running.
+    */
+   ~ThreadBufferOwner();
+};
+
+/**
+ * Returns the buffer of the calling thread, registering it on first use.
+ * The buffer lives until the thread exits, across recordings.
+ */
+ThreadBuffer& getThreadBuffer()
+{
+   thread_local ThreadBufferOwner owner;
+   if (!owner.buffer)
+   {
+      Recorder& recorder = getRecorder();
+      std::lock_guard<std::mutex> lock(recorder.mutex);
+      recorder.buffers.emplace_back(new ThreadBuffer(recorder.nextThreadId++));
+      owner.buffer = recorder.buffers.back().get();
+   }
+   return *owner.buffer;
+}
+
+int64_t toNanoseconds(TraceRecorder::Clock::time_point time)
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      time - getRecorder().origin).count();
+}
+
+/**
+ * Writes a string as a quoted JSON string, escaping what JSON requires.
+ */
+void writeString(std::FILE* file, const char* string)
+{
+   std::fputc('"', file);
+   for (; *string; string++)
+   {
+      unsigned char character = *string;
+      if (character == '"' || character == '\\') std::fprintf(file, "\\%c", character);
+      else if (character < 0x20) std::fprintf(file, "\\u%04x", character);
+      else std::fputc(character, file);
+   }
+   std::fputc('"', file);
+}
+
+void writeSeparator(Recorder& recorder)
+{
+   if (!recorder.isFirstEvent) std::fputs(",\n", recorder.file);
+   recorder.isFirstEvent = false;
+}
+
+/**
+ * Writes every event waiting in the buffers. Must hold the recorder's mutex.
+ */
+void drain(Recorder& recorder)
+{
+   for (std::unique_ptr<ThreadBuffer>& buffer : recorder.buffers)
+   {
+      uint32_t tail = buffer->tail.load(std::memory_order_relaxed);
+      uint32_t head = buffer->head.load(std::memory_order_acquire);
+      for (; tail != head; tail++)
+      {
+         const Event& event = buffer->events[tail & (ThreadBuffer::CAPACITY - 1)];
+         writeSeparator(recorder);
+         std::fputs("{\"name\":", recorder.file);
+         writeString(recorder.file, event.name);
+         if (event.isCounter)
+            std::fprintf(recorder.file,
+               ",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"value\":%lld}}",
+               event.start / 1000.0, buffer->threadId, (long long)event.duration);
+         else
+            std::fprintf(recorder.file,
+               ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+               event.start / 1000.0, event.duration / 1000.0, buffer->threadId);
+      }
+      buffer->tail.store(tail, std::memory_order_release);
+   }
+}
+
+void writeThreadName(Recorder& recorder, const ThreadBuffer& buffer)
+{
+   if (!buffer.threadName) return;
+   writeSeparator(recorder);
+   std::fprintf(recorder.file,
+      "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":",
+      buffer.threadId);
+   writeString(recorder.file, buffer.threadName);
+   std::fputs("}}", recorder.file);
+}
+
+ThreadBufferOwner::~ThreadBufferOwner()
+{
+   if (!buffer) return;
+   Recorder& recorder = getRecorder();
+   std::lock_guard<std::mutex> lock(recorder.mutex);
+   if (recorder.file)
+   {
+      drain(recorder);
+      writeThreadName(recorder, *buffer);
+   }
+   for (unsigned i = 0; i < recorder.buffers.size(); i++)
+   {
+      if (recorder.buffers[i].get() != buffer) continue;
+      recorder.buffers.erase(recorder.buffers.begin() + i);
+      break;
+   }
+}
+
+void runWriter(Recorder* writing)
+{
+   Recorder& recorder = *writing;
+   std::unique_lock<std::mutex> lock(recorder.mutex);
+   while (!recorder.isStopping)
+   {
+      drain(recorder);
+      recorder.wakeUp.wait_for(lock, std::chrono::milliseconds(5));
+   }
+   drain(recorder);
+}
+
+Recorder::~Recorder()
+{
+   if (!writer.joinable()) return;
+   {
+      std::lock_guard<std::mutex> lock(mutex);
+      isRecording.store(false, std::memory_order_release);
+      isStopping = true;
+   }
+   finish();
+}
+
+void Recorder::finish()
+{
+   wakeUp.notify_one();
+   writer.join();
+
+   std::lock_guard<std::mutex> lock(mutex);
+   drain(*this);
+   for (std::unique_ptr<ThreadBuffer>& buffer : buffers) writeThreadName(*this, *buffer);
+   std::fputs("\n]}\n", file);
+   std::fclose(file);
+   file = nullptr;
+   isStopping = false;
+}
+
+}
+
+bool TraceRecorder::start(const std::string& path)
+{
+   Recorder& recorder = getRecorder();
+   std::lock_guard<std::mutex> lock(recorder.mutex);
+   //A recording being stopped still owns the writer thread and the file.
+   if (recorder.isRecording || recorder.isStopping) return false;
+
+   recorder.file = std::fopen(path.c_str(), "w");
+   if (!recorder.file) return false;
+   std::fputs("{\"traceEvents\":[\n", recorder.file);
+
+   //Events left over from a previous recording are discarded.
+   for (std::unique_ptr<ThreadBuffer>& buffer : recorder.buffers)
+      buffer->tail.store(buffer->head.load());
+   recorder.origin = Clock::now();
+   recorder.droppedEvents = 0;
+   recorder.isFirstEvent = true;
+   recorder.writer = std::thread(runWriter, &recorder);
+   //Publishes the origin to the threads that see the recording start.
+   recorder.isRecording.store(true, std::memory_order_release);
+   return true;
+}
+
+void TraceRecorder::stop()
+{
+   Recorder& recorder = getRecorder();
+   {
+      std::lock_guard<std::mutex> lock(recorder.mutex);
+      if (!recorder.isRecording) return;
+      recorder.isRecording.store(false, std::memory_order_release);
+      recorder.isStopping = true;
+   }
+   recorder.finish();
+}
+
+bool TraceRecorder::isRecording()
+{
+   return getRecorder().isRecording.load(std::memory_order_acquire);
+}
+
+void TraceRecorder::recordSpan(const char* name, Clock::time_point start, Clock::time_point end)
+{
+   if (!isRecording()) return;
+   Event event = {name, toNanoseconds(start),
+                  std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+                  false};
+   if (!getThreadBuffer().push(event)) getRecorder().droppedEvents++;
+}
+
+void TraceRecorder::recordCounter(const char* name, int64_t value)
+{
+   if (!isRecording()) return;
+   Event event = {name, toNanoseconds(Clock::now()), value, true};
+   if (!getThreadBuffer().push(event)) getRecorder().droppedEvents++;
+}
+
+void TraceRecorder::setThreadName(const char* name)
+{
+   ThreadBuffer& buffer = getThreadBuffer();
+   std::lock_guard<std::mutex> lock(getRecorder().mutex);
+   buffer.threadName = name;
+}
+
+uint64_t TraceRecorder::getNumberOfDroppedEvents()
+{
+   return getRecorder().droppedEvents;
+}
+
+}
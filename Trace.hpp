@@ -0,0 +1,155 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_TRACE_HPP_
+#define FZX_TRACE_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace fzx
+{
+
+/**
+ * Records spans and counters and writes them as a Chrome trace-event JSON
+ * file, which can be opened in chrome://tracing or the Perfetto UI.
+ *
+ * Each thread writes its events into its own lock-free ring buffer, and a
+ * background thread drains the buffers into the file, so recording an event
+ * costs two clock reads and a few stores. When a buffer is full, events are
+ * dropped and counted instead of blocking the simulation.
+ *
+ * Event names must be string literals or otherwise outlive the recording.
+ */
+class TraceRecorder
+{
+public:
+   typedef std::chrono::steady_clock Clock;
+
+   /**
+    * Starts recording into a file.
+    *
+    * @param  path The path of the JSON file to write.
+    * @return Whether the file could be opened. False if already recording, or
+    *         if another thread is still inside stop().
+    */
+   static bool start(const std::string& path);
+
+   /**
+    * Stops recording, writes every remaining event and closes the file.
+    */
+   static void stop();
+
+   /**
+    * Checks whether events are being recorded.
+    *
+    * @return Whether a recording is in progress.
+    */
+   static bool isRecording();
+
+   /**
+    * Records a span on the calling thread.
+    *
+    * @param name The name of the span.
+    * @param start When the span started.
+    * @param end When the span ended.
+    */
+   static void recordSpan(const char* name, Clock::time_point start, Clock::time_point end);
+
+   /**
+    * Records the value of a counter.
+    *
+    * @param name The name of the counter.
+    * @param value The value of the counter.
+    */
+   static void recordCounter(const char* name, int64_t value);
+
+   /**
+    * Names the calling thread in the trace.
+    *
+    * @param name The name of the thread.
+    */
+   static void setThreadName(const char* name);
+
+   /**
+    * Returns the number of events dropped because a buffer was full.
+    *
+    * @return The number of dropped events since the recording started.
+    */
+   static uint64_t getNumberOfDroppedEvents();
+};
+
+/**
+ * Records a span from its construction to its destruction.
+ */
+class ScopedTraceSpan
+{
+private:
+   const char* mName; ///< The name of the span.
+   TraceRecorder::Clock::time_point mStart; ///< When the span started.
+   bool mIsRecording; ///< Whether a recording was running when it started.
+public:
+   /**
+    * Starts the span.
+    *
+    * @param name The name of the span.
+    */
+   ScopedTraceSpan(const char* name) :
+      mName(name), mIsRecording(TraceRecorder::isRecording())
+   {
+      if (mIsRecording) mStart = TraceRecorder::Clock::now();
+   }
+
+   /**
+    * Ends the span and records it.
+    */
+   ~ScopedTraceSpan()
+   {
+      if (mIsRecording)
+         TraceRecorder::recordSpan(mName, mStart, TraceRecorder::Clock::now());
+   }
+};
+
+}
+
+#define FZX_TRACE_CONCATENATE_(a, b) a##b
+#define FZX_TRACE_CONCATENATE(a, b) FZX_TRACE_CONCATENATE_(a, b)
+
+#ifdef FZX_TRACE
+/// Records the rest of the enclosing scope as a span.
+#define FZX_TRACE_SPAN(name) \
+   fzx::ScopedTraceSpan FZX_TRACE_CONCATENATE(fzxSpan, __LINE__)(name)
+/// Records the value of a counter.
+#define FZX_TRACE_COUNTER(name, value) fzx::TraceRecorder::recordCounter(name, value)
+/// Names the calling thread in the trace.
+#define FZX_TRACE_THREAD_NAME(name) fzx::TraceRecorder::setThreadName(name)
+#else
+#define FZX_TRACE_SPAN(name)
+#define FZX_TRACE_COUNTER(name, value)
+#define FZX_TRACE_THREAD_NAME(name)
+#endif
+
+#endif /*FZX_TRACE_HPP_*/
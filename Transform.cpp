@@ -25,8 +25,37 @@
 ///
 #include "Transform.hpp"
 
+#include <cmath>
+
+#include "Settings.hpp"
+
 namespace fzx {
 
+namespace
+{
+
+const float TWO_PI = 6.2831853f;
+
+/**
+ * Rotates the unit complex number (cosine, sine) by a small angle.
+ *
+ * The angle's cosine and sine come from their Taylor series up to the fifth
+ * order, and one Newton step pulls the result back onto the unit circle.
+ */
+inline void rotateSmall(float& cosine, float& sine, float delta)
+{
+   float deltaSquared = delta * delta;
+   float c = 1 - deltaSquared * (0.5f - deltaSquared * (1.0f / 24));
+   float s = delta * (1 - deltaSquared * (1.0f / 6 - deltaSquared * (1.0f / 120)));
+   float newCosine = cosine * c - sine * s;
+   float newSine = sine * c + cosine * s;
+   float scale = 1.5f - 0.5f * (newCosine * newCosine + newSine * newSine);
+   cosine = newCosine * scale;
+   sine = newSine * scale;
+}
+
+}
+
 Vec2f Transform::apply(const Vec2f& vector) const
 {
    return mRotationMatrix * vector + mTranslation;
@@ -38,8 +67,24 @@ void Transform::translate(const Vec2f& delta)
 }
 void Transform::rotate(float delta)
 {
+   //STATIC bodies are rotated by 0 every position iteration.
+   if (delta == 0) return;
+   if (std::abs(delta) > MAXIMUM_INCREMENTAL_ROTATION)
+   {
+      setRotation(getRotation() + delta);
+      return;
+   }
+   rotateMatrix(delta);
    mAngle += delta;
-   mRotationMatrix = Mat22f(mAngle);
+   mIsAngleStale = true;
+}
+
+void Transform::rotateMatrix(float delta)
+{
+   float cosine = mRotationMatrix.getLeftColumn().x;
+   float sine = mRotationMatrix.getLeftColumn().y;
+   rotateSmall(cosine, sine, delta);
+   mRotationMatrix = Mat22f(cosine, sine, -sine, cosine);
 }
 
 const Mat22f& Transform::getRotationMatrix() const
@@ -54,12 +99,30 @@ const Vec2f& Transform::getTranslation() const
 
 float Transform::getRotation() const
 {
+   if (!mIsAngleStale) return mAngle;
+
+   //The sum of the small rotations is off by far less than half a turn,
+   //so it picks the turn that atan2's result belongs to.
+   const Vec2f& column = mRotationMatrix.getLeftColumn();
+   float difference = std::atan2(column.y, column.x) - mAngle;
+   difference -= TWO_PI * std::floor(difference / TWO_PI + 0.5f);
+   return mAngle + difference;
+}
+
+float Transform::getRotation()
+{
+   if (mIsAngleStale)
+   {
+      mAngle = static_cast<const Transform&>(*this).getRotation();
+      mIsAngleStale = false;
+   }
    return mAngle;
 }
 
 void Transform::setRotation(float theta)
 {
    mAngle = theta;
+   mIsAngleStale = false;
    mRotationMatrix = Mat22f(theta);
 }
 
@@ -32,15 +32,36 @@
 namespace fzx
 {
 
+class WorldSerializer;
+class RollbackBuffer;
+class Scene;
+
 /**
  * Represents a set of geometrical transformations.
+ *
+ * The rotation is kept as a unit complex number, the left column of the
+ * rotation matrix. Small rotations multiply it by an approximation of the
+ * rotation's complex number instead of calling cos and sin, and the angle is
+ * only recovered from it when asked for.
  */
 class Transform
 {
+friend class WorldSerializer;
+friend class RollbackBuffer;
+friend class Scene;
 private:
    Mat22f mRotationMatrix; ///< The matrix that represents an objects rotation.
    Vec2f mTranslation; ///< The vector that represents an objects translation.
    float mAngle; ///< The angle that the object is rotated by counterclockwise.
+   bool mIsAngleStale; ///< Whether mAngle is only the sum of the small rotations since it was last exact.
+
+   /**
+    * Rotates the rotation matrix by an angle small enough for the
+    * approximation, without touching the angle.
+    *
+    * @param delta The angle to rotate by in radians.
+    */
+   void rotateMatrix(float delta);
 public:
 
    /**
@@ -48,7 +69,7 @@ public:
     *
     * The angle and translation is set to zero.
     */
-   Transform() : mRotationMatrix(0), mTranslation(0, 0), mAngle(0) {}
+   Transform() : mRotationMatrix(), mTranslation(0, 0), mAngle(0), mIsAngleStale(false) {}
 
    /**
     * Applies this transformation to a vector.
@@ -72,6 +93,10 @@ public:
    /**
     * Rotates the transformation to a new angle.
     *
+    * Rotations up to MAXIMUM_INCREMENTAL_ROTATION are applied without cos and
+    * sin. Larger ones recompute the matrix exactly. A rotation of 0 changes
+    * nothing.
+    *
     * @param delta The float that represents the angle to rotate by in radians.
     */
    void rotate(float delta);
@@ -93,10 +118,23 @@ public:
    /**
     * Returns the angle that this Transform is rotated by.
     *
+    * After small rotations the angle is recovered from the rotation matrix
+    * with atan2, on the same turn as the sum of the rotations, so it keeps
+    * counting past a full turn. Nothing is cached, so a Transform can be read
+    * from several threads at once.
+    *
     * @return A float that is the angle this Transform is rotated by.
     */
    float getRotation() const;
 
+   /**
+    * Returns the angle that this Transform is rotated by, keeping it so the
+    * next call needs no atan2 until the Transform rotates again.
+    *
+    * @return A float that is the angle this Transform is rotated by.
+    */
+   float getRotation();
+
    /**
     * Set's this Transform's angle to a specific value.
     *
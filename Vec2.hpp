@@ -247,7 +247,8 @@ struct Vec2
 	 */
 	T getMagnitude() const
 	{
-		return std::sqrt(getMagnitudeSquared());
+		using std::sqrt;
+		return sqrt(getMagnitudeSquared());
 	}
 
 	/**
@@ -260,7 +261,8 @@ struct Vec2
 	 */
 	T getDirection()  const
 	{
-		return std::atan2(y, x) + 3.1415926f;
+		using std::atan2;
+		return atan2(y, x) + T(3.1415926f);
 	}
 };
 
@@ -1,8 +1,11 @@
 #ifndef FZX_WORLD_HPP_
 #define FZX_WORLD_HPP_
 
+#include "Memory.hpp"
+#include "Profiler.hpp"
 #include "RigidBody.hpp"
 #include "Collision.hpp"
+#include "StateHash.hpp"
 
 #include <string>
 #include <vector>
@@ -16,15 +19,28 @@ namespace fzx
  */
 class World
 {
+friend class WorldSerializer;
+friend class IslandSolver;
 private:
-   std::vector<std::unique_ptr<RigidBody>> mBodies; ///< The RigidBodys in the world.
-   std::vector<Collision> mCollisions; ///< The Collision generated last step.
+   typedef TrackingAllocator<std::unique_ptr<RigidBody>, Memory::BODIES> BodyAllocator;
+   typedef TrackingAllocator<Collision, Memory::COLLISIONS> CollisionAllocator;
+
+   Memory::Account mMemory; ///< The memory of the World's own containers, declared first to outlive them.
+   std::vector<std::unique_ptr<RigidBody>, BodyAllocator> mBodies{BodyAllocator(&mMemory)}; ///< The RigidBodys in the world.
+   std::vector<Collision, CollisionAllocator> mCollisions{CollisionAllocator(&mMemory)}; ///< The Collision generated last step.
    Vec2f mGravity; ///< The gravity all non-static RigidBodys undergo.
    Vec2f mFluidVelocity; ///< The velocity of the fluid sorrounding the objects.
    unsigned mPositionIterations; ///< The number of position iterations per step.
    unsigned mVelocityIterations; ///< The number of velocity iterations per step.
    float mFluidDrag; ///< The drag of the sorrounding fluid.
    float mDeltaTime; ///< The displacement in time for step.
+   StepProfiler mProfiler; ///< Times each step when FZX_PROFILE is defined.
+   StateHasher mStateHasher; ///< Hashes the state on request, keeping its region storage.
+
+   //The allocators of the containers point at mMemory, so a World can't be
+   //copied or moved.
+   World(const World&);
+   World& operator=(const World&);
 
    /**
     * Sets up Collisions that aren't obciously seperated.
@@ -194,6 +210,61 @@ public:
     * @param detlaTime The time displacement done each step.
     */
    void setDeltaTime(float detlaTime);
+
+   /**
+    * Returns the timings and counters of the last step.
+    *
+    * They stay at zero unless the library is built with FZX_PROFILE and the
+    * step was bracketed by FZX_PROFILE_BEGIN_STEP and FZX_PROFILE_END_STEP,
+    * as WorldBatch and RollbackBuffer do.
+    *
+    * @return The StepStats of the last step.
+    */
+   const StepStats& getStepStats() const;
+
+   /**
+    * Returns the StepProfiler of the World, for its history or to give it
+    * PerfCounters.
+    *
+    * @return A reference to the StepProfiler.
+    */
+   StepProfiler& getProfiler();
+
+   /**
+    * Returns the memory charged to the World in a Category, apart from what
+    * other Worlds in the process use.
+    *
+    * That is its own containers, RigidBodys made with new (account), and the
+    * contacts an IslandSolver keeps while it solves the World.
+    *
+    * @param  category The Category to look up.
+    * @return The current and peak bytes of the World in the Category.
+    */
+   Memory::Stats getMemoryStats(Memory::Category category) const;
+
+   /**
+    * Returns the memory charged to the World in every Category.
+    *
+    * @return The summed Stats of the World.
+    */
+   Memory::Stats getTotalMemoryStats() const;
+
+   /**
+    * Lowers the peaks of the World's memory to its current usage.
+    */
+   void resetMemoryPeaks();
+
+   /**
+    * Hashes the current state of every RigidBody, for desync detection.
+    *
+    * Nothing is hashed unless this is called. The StateHasher is kept by the
+    * World, so the storage of its region hashes is reused between calls.
+    *
+    * @param  regionSize The width and height of a region, or 0 to skip the
+    *         region hashes.
+    * @return The StateHasher holding the hashes, valid until the next call.
+    */
+   const StateHasher& hashState(float regionSize = 0);
 };
 
 }
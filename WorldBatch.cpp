@@ -0,0 +1,160 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "WorldBatch.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "Scene.hpp"
+#include "WorldSerializer.hpp"
+
+namespace fzx
+{
+
+namespace
+{
+
+/**
+ * Returns how many threads a batch uses, no more than it has Worlds.
+ */
+unsigned limitThreads(unsigned numberOfThreads, unsigned numberOfWorlds)
+{
+   if (numberOfThreads == 0) numberOfThreads = std::max(1u, std::thread::hardware_concurrency());
+   return std::min(numberOfThreads, std::max(1u, numberOfWorlds));
+}
+
+}
+
+WorldBatch::WorldBatch(unsigned numberOfWorlds, unsigned positionIterations,
+                       unsigned velocityIterations, float deltaTime, unsigned numberOfThreads) :
+   mPool(limitThreads(numberOfThreads, numberOfWorlds), "WorldBatch worker"),
+   //Claiming a few Worlds at a time keeps the threads off the shared counter
+   //while still leaving enough chunks to balance uneven Worlds.
+   mChunkSize(std::max(1u, numberOfWorlds / (mPool.getNumberOfThreads() * 8)))
+{
+   mWorlds.reserve(numberOfWorlds);
+   for (unsigned i = 0; i < numberOfWorlds; i++)
+      mWorlds.emplace_back(new World(positionIterations, velocityIterations, deltaTime));
+}
+
+unsigned WorldBatch::getNumberOfWorlds() const
+{
+   return mWorlds.size();
+}
+
+unsigned WorldBatch::getNumberOfThreads() const
+{
+   return mPool.getNumberOfThreads();
+}
+
+World& WorldBatch::getWorld(unsigned i)
+{
+   return *mWorlds[i];
+}
+
+void WorldBatch::forEach(const std::function<void(World&, unsigned)>& task)
+{
+   mPool.forEach(mWorlds.size(), mChunkSize, "WorldBatch::forEach",
+                 [&](unsigned i) { task(*mWorlds[i], i); });
+}
+
+void WorldBatch::step(unsigned steps)
+{
+   forEach([steps](World& world, unsigned)
+   {
+      for (unsigned i = 0; i < steps; i++)
+      {
+         FZX_PROFILE_BEGIN_STEP(world.getProfiler());
+         world.step();
+         FZX_PROFILE_END_STEP(world.getProfiler());
+      }
+   });
+}
+
+bool WorldBatch::addScene(const Scene& scene, const std::string& name)
+{
+   std::atomic<bool> isComplete(true);
+   forEach([&](World& world, unsigned)
+   {
+      if (!scene.addBodies(world, name)) isComplete.store(false, std::memory_order_relaxed);
+   });
+   return isComplete.load();
+}
+
+void WorldBatch::setResetState(World& world)
+{
+   WorldSerializer::serialize(world, mResetState);
+}
+
+bool WorldBatch::reset()
+{
+   if (mResetState.empty()) return false;
+   std::atomic<bool> isValid(true);
+   forEach([&](World& world, unsigned)
+   {
+      if (!WorldSerializer::deserialize(world, mResetState.data(), mResetState.size()))
+         isValid.store(false, std::memory_order_relaxed);
+   });
+   return isValid.load();
+}
+
+bool WorldBatch::reset(const std::vector<unsigned>& indices)
+{
+   if (mResetState.empty()) return false;
+   for (unsigned i : indices) if (i >= mWorlds.size()) return false;
+   for (unsigned i : indices)
+   {
+      if (!WorldSerializer::deserialize(*mWorlds[i], mResetState.data(), mResetState.size()))
+         return false;
+   }
+   return true;
+}
+
+void WorldBatch::exportObservations(float* observations, unsigned bodiesPerWorld)
+{
+   unsigned stride = bodiesPerWorld * OBSERVATION_SIZE;
+   forEach([=](World& world, unsigned index)
+   {
+      float* output = observations + (std::size_t)index * stride;
+      unsigned numberOfBodies = std::min(bodiesPerWorld, world.getNumberOfBodies());
+      for (unsigned i = 0; i < numberOfBodies; i++)
+      {
+         RigidBody& body = world.getBody(i);
+         Transform& transform = body.getTransform();
+         Vec2f velocity = body.getPush(RigidBody::VELOCITY);
+         *output++ = transform.getTranslation().x;
+         *output++ = transform.getTranslation().y;
+         *output++ = transform.getRotation();
+         *output++ = velocity.x;
+         *output++ = velocity.y;
+         *output++ = body.getTwist(RigidBody::VELOCITY);
+      }
+      std::fill(output, output + (bodiesPerWorld - numberOfBodies) * OBSERVATION_SIZE, 0.0f);
+   });
+}
+
+}
@@ -0,0 +1,175 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_WORLD_BATCH_HPP_
+#define FZX_WORLD_BATCH_HPP_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.hpp"
+#include "World.hpp"
+
+namespace fzx
+{
+
+class Scene;
+
+/**
+ * Owns many independent Worlds and steps, resets and observes all of them in
+ * one call, spreading the Worlds over a pool of threads.
+ *
+ * Static geometry common to the batch can come from one Scene. Every World
+ * gets its own STATIC RigidBodys for it, but their Shapes come from the
+ * ShapeCache, so the geometry is stored once for the whole batch.
+ */
+class WorldBatch
+{
+public:
+   /**
+    * The number of floats exported per RigidBody: the x and y of the
+    * translation, the rotation, the x and y of the velocity and the angular
+    * velocity.
+    */
+   static const unsigned OBSERVATION_SIZE = 6;
+private:
+   std::vector<std::unique_ptr<World>> mWorlds; ///< The Worlds of the batch.
+   std::vector<unsigned char> mResetState; ///< The serialized state reset() restores.
+
+   ThreadPool mPool; ///< Spreads the Worlds over threads, stopped before they are destroyed.
+   unsigned mChunkSize; ///< The number of Worlds claimed at once.
+
+   //The threads refer to the batch, so it can't be copied.
+   WorldBatch(const WorldBatch&);
+   WorldBatch& operator=(const WorldBatch&);
+public:
+   /**
+    * Creates a batch of empty Worlds with the same settings.
+    *
+    * @param numberOfWorlds     The number of Worlds in the batch.
+    * @param positionIterations The number of position iterations per step.
+    * @param velocityIterations The number of velocity iterations per step.
+    * @param deltaTime          The time displacement per step.
+    * @param numberOfThreads    The number of threads work is spread over,
+    *                           including the calling thread. 0 uses one per
+    *                           hardware thread.
+    */
+   WorldBatch(unsigned numberOfWorlds, unsigned positionIterations,
+              unsigned velocityIterations, float deltaTime, unsigned numberOfThreads = 0);
+
+   /**
+    * Returns the number of Worlds in the batch.
+    *
+    * @return The number of Worlds.
+    */
+   unsigned getNumberOfWorlds() const;
+
+   /**
+    * Returns the number of threads work is spread over.
+    *
+    * @return The number of threads, including the calling one.
+    */
+   unsigned getNumberOfThreads() const;
+
+   /**
+    * Returns a World of the batch.
+    *
+    * @param  i The index of the World.
+    * @return A reference to the World.
+    */
+   World& getWorld(unsigned i);
+
+   /**
+    * Runs a function on every World, spread over the threads.
+    *
+    * The function is called concurrently for different Worlds, so it must
+    * only touch the World it is given. Returns once every call is done.
+    *
+    * @param task The function, given each World and its index.
+    */
+   void forEach(const std::function<void(World&, unsigned)>& task);
+
+   /**
+    * Steps every World.
+    *
+    * @param steps The number of steps each World takes.
+    */
+   void step(unsigned steps = 1);
+
+   /**
+    * Adds the bodies of a Scene to every World as STATIC RigidBodys.
+    *
+    * Add the Scene before setResetState(), so that the reset state holds its
+    * bodies too.
+    *
+    * @param  scene An open Scene. It is only read during the call.
+    * @param  name The name of the new RigidBodys.
+    * @return Whether every body was added to every World.
+    */
+   bool addScene(const Scene& scene, const std::string& name);
+
+   /**
+    * Sets the state that reset() restores every World to.
+    *
+    * @param world The World whose current state is saved.
+    */
+   void setResetState(World& world);
+
+   /**
+    * Restores every World to the reset state.
+    *
+    * @return Whether there was a valid reset state.
+    */
+   bool reset();
+
+   /**
+    * Restores some of the Worlds to the reset state, such as those whose
+    * episode has ended.
+    *
+    * @param  indices The indices of the Worlds to reset.
+    * @return Whether there was a valid reset state and every index was that
+    *         of a World. No World is reset if an index is out of range.
+    */
+   bool reset(const std::vector<unsigned>& indices);
+
+   /**
+    * Writes the state of the RigidBodys of every World into one buffer.
+    *
+    * The buffer holds bodiesPerWorld * OBSERVATION_SIZE floats per World, one
+    * World after the other. Worlds with fewer RigidBodys are padded with zeros
+    * and extra RigidBodys are left out.
+    *
+    * @param observations   The buffer, of at least getNumberOfWorlds() *
+    *                       bodiesPerWorld * OBSERVATION_SIZE floats.
+    * @param bodiesPerWorld The number of RigidBodys exported from each World.
+    */
+   void exportObservations(float* observations, unsigned bodiesPerWorld);
+};
+
+}
+
+#endif /*FZX_WORLD_BATCH_HPP_*/
@@ -0,0 +1,451 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "WorldSerializer.hpp"
+#include "World.hpp"
+#include "Rectangle.hpp"
+#include "Polygon.hpp"
+#include "ShapeCache.hpp"
+#include "NameTable.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace fzx
+{
+
+namespace
+{
+
+/**
+ * The header at the start of a serialized World.
+ */
+struct Header
+{
+   uint32_t magic, version;
+   uint32_t numberOfBodies, numberOfCollisions, numberOfContacts;
+   uint32_t numberOfVertices, nameBytes;
+   uint32_t positionIterations, velocityIterations;
+   float gravityX, gravityY, fluidVelocityX, fluidVelocityY;
+   float fluidDrag, deltaTime;
+};
+
+/**
+ * The state of one RigidBody.
+ */
+struct BodyRecord
+{
+   uint32_t bodyType, shapeType;
+   float width, height; ///< The radius is stored in width for Circles.
+   uint32_t firstVertex, numberOfVertices;
+   float density, staticFriction, kineticFriction, restitution;
+   float mass, inverseMass, inertia, inverseInertia;
+   float x, y, angle; ///< The angle as kept, which is only a running sum if isAngleStale.
+   float rotation[4]; ///< The rotation matrix, column by column, which small rotations integrate.
+   uint32_t isAngleStale;
+   float velocityX, velocityY, forceX, forceY;
+   float angularVelocity, torque;
+   int32_t layer;
+   uint32_t isSleeping;
+   uint32_t firstNameByte, nameLength;
+};
+
+/**
+ * A Collision between two RigidBodys given by index.
+ */
+struct CollisionRecord
+{
+   uint32_t bodyA, bodyB, numberOfContacts;
+   float mixedStaticFriction, mixedKineticFriction, mixedRestitution;
+};
+
+static_assert(sizeof(Header) % 4 == 0, "Header must be made of words");
+static_assert(sizeof(BodyRecord) == 32 * 4, "BodyRecord must be packed");
+static_assert(sizeof(CollisionRecord) == 6 * 4, "CollisionRecord must be packed");
+static_assert(sizeof(Collision::ContactData) == 16 * 4, "ContactData must be packed");
+
+bool isLittleEndian()
+{
+   const uint32_t one = 1;
+   unsigned char firstByte;
+   std::memcpy(&firstByte, &one, 1);
+   return firstByte == 1;
+}
+
+/**
+ * Copies 4-byte words, swapping their byte order on big-endian machines.
+ */
+void copyWords(void* destination, const void* source, std::size_t bytes)
+{
+   std::memcpy(destination, source, bytes);
+   if (isLittleEndian()) return;
+
+   unsigned char* word = static_cast<unsigned char*>(destination);
+   for (std::size_t i = 0; i + 4 <= bytes; i += 4)
+   {
+      std::swap(word[i], word[i + 3]);
+      std::swap(word[i + 1], word[i + 2]);
+   }
+}
+
+/**
+ * Returns a view of a section of words, copying it only when the bytes can't be
+ * used in place.
+ */
+template <typename T>
+const T* viewWords(const unsigned char* source, std::size_t count, std::vector<T>& storage)
+{
+   if (isLittleEndian() && reinterpret_cast<std::uintptr_t>(source) % alignof(T) == 0)
+      return reinterpret_cast<const T*>(source);
+   storage.resize(count);
+   if (count) copyWords(storage.data(), source, count * sizeof(T));
+   return storage.data();
+}
+
+/**
+ * Gets the vertices a Polygon was built from, so it is interned again as the
+ * same Shape. Polygons that didn't come from the ShapeCache, or were padded
+ * from fewer than 3 vertices, give their own.
+ */
+void getSourceVertices(const std::shared_ptr<const Shape>& shape, std::vector<Vec2f>& vertices)
+{
+   if (ShapeCache::getPolygonVertices(shape, vertices) && vertices.size() >= 3) return;
+
+   const Polygon& polygon = static_cast<const Polygon&>(*shape);
+   vertices.resize(polygon.getNumberOfVertices());
+   for (unsigned i = 0; i < vertices.size(); i++) vertices[i] = polygon.getVertix(i);
+}
+
+/**
+ * Checks whether a list of vertices matches the given vertices.
+ */
+bool hasVertices(const std::vector<Vec2f>& source, const Vec2f* vertices, unsigned numberOfVertices)
+{
+   if (source.size() != numberOfVertices) return false;
+   for (unsigned i = 0; i < numberOfVertices; i++)
+   {
+      if (source[i].x != vertices[i].x || source[i].y != vertices[i].y) return false;
+   }
+   return true;
+}
+
+std::size_t roundUpToWord(std::size_t bytes)
+{
+   return (bytes + 3) & ~(std::size_t)3;
+}
+
+}
+
+void WorldSerializer::serialize(World& world, std::vector<unsigned char>& buffer)
+{
+   Header header;
+   header.magic = MAGIC;
+   header.version = VERSION;
+   header.numberOfBodies = world.mBodies.size();
+   header.numberOfCollisions = world.mCollisions.size();
+   header.numberOfContacts = 0;
+   header.numberOfVertices = 0;
+   header.nameBytes = 0;
+   header.positionIterations = world.mPositionIterations;
+   header.velocityIterations = world.mVelocityIterations;
+   header.gravityX = world.mGravity.x;
+   header.gravityY = world.mGravity.y;
+   header.fluidVelocityX = world.mFluidVelocity.x;
+   header.fluidVelocityY = world.mFluidVelocity.y;
+   header.fluidDrag = world.mFluidDrag;
+   header.deltaTime = world.mDeltaTime;
+
+   std::vector<BodyRecord> bodies(world.mBodies.size());
+   std::vector<Vec2f> vertices;
+   std::vector<Vec2f> source;
+   std::vector<char> names;
+   for (unsigned i = 0; i < world.mBodies.size(); i++)
+   {
+      const RigidBody& body = *world.mBodies[i];
+      BodyRecord& record = bodies[i];
+      record.bodyType = body.mBodyType;
+      record.shapeType = body.mShape->getType();
+      record.width = record.height = 0;
+      record.firstVertex = vertices.size();
+      record.numberOfVertices = 0;
+      if (record.shapeType == Shape::CIRCLE)
+         record.width = body.mShape->getRadius();
+      else if (record.shapeType == Shape::RECTANGLE)
+      {
+         const Rectangle& rectangle = static_cast<const Rectangle&>(*body.mShape);
+         record.width = rectangle.getWidth();
+         record.height = rectangle.getHeight();
+      }
+      else
+      {
+         getSourceVertices(body.mShape, source);
+         record.numberOfVertices = source.size();
+         vertices.insert(vertices.end(), source.begin(), source.end());
+      }
+      record.density = body.mMaterial.density;
+      record.staticFriction = body.mMaterial.staticFriction;
+      record.kineticFriction = body.mMaterial.kineticFriction;
+      record.restitution = body.mMaterial.restitution;
+      record.mass = body.mMassData.mass;
+      record.inverseMass = body.mMassData.inverseMass;
+      record.inertia = body.mMassData.inertia;
+      record.inverseInertia = body.mMassData.inverseInertia;
+      record.x = body.mTransform.getTranslation().x;
+      record.y = body.mTransform.getTranslation().y;
+      //The matrix is integrated step by step, so it can't be rebuilt from the
+      //angle. Store it and the angle as they are.
+      const Transform& transform = body.mTransform;
+      record.angle = transform.mAngle;
+      const Mat22f& rotation = transform.mRotationMatrix;
+      record.rotation[0] = rotation.getLeftColumn().x;
+      record.rotation[1] = rotation.getLeftColumn().y;
+      record.rotation[2] = rotation.getRightColumn().x;
+      record.rotation[3] = rotation.getRightColumn().y;
+      record.isAngleStale = transform.mIsAngleStale;
+      record.velocityX = body.mVelocity.x;
+      record.velocityY = body.mVelocity.y;
+      record.forceX = body.mForce.x;
+      record.forceY = body.mForce.y;
+      record.angularVelocity = body.mAngularVelocity;
+      record.torque = body.mTorque;
+      record.layer = body.mLayer;
+      record.isSleeping = body.mIsSleeping;
+      record.firstNameByte = names.size();
+      const std::string& name = body.mName.getName();
+      record.nameLength = name.size();
+      names.insert(names.end(), name.begin(), name.end());
+   }
+   header.numberOfVertices = vertices.size();
+   header.nameBytes = names.size();
+
+   //Collisions refer to bodies by index, so build a lookup from the pointers.
+   std::unordered_map<const RigidBody*, unsigned> indices(world.mBodies.size());
+   for (unsigned i = 0; i < world.mBodies.size(); i++) indices[world.mBodies[i].get()] = i;
+   std::vector<CollisionRecord> collisions(world.mCollisions.size());
+   std::vector<Collision::ContactData> contacts;
+   for (unsigned i = 0; i < world.mCollisions.size(); i++)
+   {
+      const Collision& collision = world.mCollisions[i];
+      CollisionRecord& record = collisions[i];
+      record.bodyA = indices[collision.mBodyA];
+      record.bodyB = indices[collision.mBodyB];
+      record.numberOfContacts = collision.mContacts.size();
+      record.mixedStaticFriction = collision.mMixedStaticFriction;
+      record.mixedKineticFriction = collision.mMixedKineticFriction;
+      record.mixedRestitution = collision.mMixedRestitution;
+      contacts.insert(contacts.end(), collision.mContacts.begin(),
+                      collision.mContacts.end());
+   }
+   header.numberOfContacts = contacts.size();
+
+   std::size_t headerBytes = sizeof(Header);
+   std::size_t bodyBytes = bodies.size() * sizeof(BodyRecord);
+   std::size_t collisionBytes = collisions.size() * sizeof(CollisionRecord);
+   std::size_t contactBytes = contacts.size() * sizeof(Collision::ContactData);
+   std::size_t vertexBytes = vertices.size() * sizeof(Vec2f);
+
+   buffer.assign(headerBytes + bodyBytes + collisionBytes + contactBytes +
+                 vertexBytes + roundUpToWord(names.size()), 0);
+   unsigned char* output = buffer.data();
+   copyWords(output, &header, headerBytes);
+   output += headerBytes;
+   if (bodyBytes) copyWords(output, bodies.data(), bodyBytes);
+   output += bodyBytes;
+   if (collisionBytes) copyWords(output, collisions.data(), collisionBytes);
+   output += collisionBytes;
+   if (contactBytes) copyWords(output, contacts.data(), contactBytes);
+   output += contactBytes;
+   if (vertexBytes) copyWords(output, vertices.data(), vertexBytes);
+   output += vertexBytes;
+   if (!names.empty()) std::memcpy(output, names.data(), names.size());
+}
+
+bool WorldSerializer::deserialize(World& world, const unsigned char* data, std::size_t size)
+{
+   Header header;
+   if (size < sizeof(Header)) return false;
+   copyWords(&header, data, sizeof(Header));
+   if (header.magic != MAGIC || header.version != VERSION) return false;
+
+   std::size_t bodyBytes = (std::size_t)header.numberOfBodies * sizeof(BodyRecord);
+   std::size_t collisionBytes = (std::size_t)header.numberOfCollisions * sizeof(CollisionRecord);
+   std::size_t contactBytes = (std::size_t)header.numberOfContacts * sizeof(Collision::ContactData);
+   std::size_t vertexBytes = (std::size_t)header.numberOfVertices * sizeof(Vec2f);
+   if (size < sizeof(Header) + bodyBytes + collisionBytes + contactBytes +
+              vertexBytes + header.nameBytes) return false;
+
+   //On little-endian machines the sections are read in place.
+   const unsigned char* input = data + sizeof(Header);
+   std::vector<BodyRecord> bodyStorage;
+   const BodyRecord* bodies = viewWords(input, header.numberOfBodies, bodyStorage);
+   input += bodyBytes;
+   std::vector<CollisionRecord> collisionStorage;
+   const CollisionRecord* collisions =
+      viewWords(input, header.numberOfCollisions, collisionStorage);
+   input += collisionBytes;
+   const unsigned char* contacts = input;
+   input += contactBytes;
+   std::vector<Vec2f> vertexStorage;
+   const Vec2f* vertices = viewWords(input, header.numberOfVertices, vertexStorage);
+   input += vertexBytes;
+   const char* names = reinterpret_cast<const char*>(input);
+
+   //Check every reference before touching the World.
+   for (unsigned i = 0; i < header.numberOfBodies; i++)
+   {
+      const BodyRecord& record = bodies[i];
+      if (record.bodyType > RigidBody::DYNAMIC) return false;
+      if (record.shapeType > Shape::POLYGON) return false;
+      if ((std::size_t)record.firstVertex + record.numberOfVertices > header.numberOfVertices)
+         return false;
+      if (std::isnan(record.width) || std::isnan(record.height)) return false;
+      if (record.shapeType == Shape::POLYGON)
+      {
+         if (record.numberOfVertices < 3) return false;
+         const Vec2f* polygonVertices = vertices + record.firstVertex;
+         for (unsigned j = 0; j < record.numberOfVertices; j++)
+            if (std::isnan(polygonVertices[j].x) || std::isnan(polygonVertices[j].y)) return false;
+      }
+      if ((std::size_t)record.firstNameByte + record.nameLength > header.nameBytes)
+         return false;
+   }
+   std::size_t numberOfContacts = 0;
+   for (unsigned i = 0; i < header.numberOfCollisions; i++)
+   {
+      const CollisionRecord& record = collisions[i];
+      if (record.bodyA >= header.numberOfBodies) return false;
+      if (record.bodyB >= header.numberOfBodies) return false;
+      numberOfContacts += record.numberOfContacts;
+   }
+   if (numberOfContacts != header.numberOfContacts) return false;
+
+   world.mPositionIterations = header.positionIterations;
+   world.mVelocityIterations = header.velocityIterations;
+   world.mGravity.set(header.gravityX, header.gravityY);
+   world.mFluidVelocity.set(header.fluidVelocityX, header.fluidVelocityY);
+   world.mFluidDrag = header.fluidDrag;
+   world.mDeltaTime = header.deltaTime;
+
+   //Keep the bodies that already exist so their storage is reused.
+   world.mCollisions.clear();
+   if (world.mBodies.size() > header.numberOfBodies)
+      world.mBodies.resize(header.numberOfBodies);
+   world.mBodies.reserve(header.numberOfBodies);
+   while (world.mBodies.size() < header.numberOfBodies)
+      world.mBodies.emplace_back(new (&world.mMemory) RigidBody(""));
+
+   //Reused for every body that needs a new Polygon or name.
+   std::vector<Vec2f> polygon;
+   std::vector<Vec2f> source;
+   std::string name;
+   for (unsigned i = 0; i < header.numberOfBodies; i++)
+   {
+      const BodyRecord& record = bodies[i];
+      RigidBody& body = *world.mBodies[i];
+      Shape::ShapeType shapeType = (Shape::ShapeType)record.shapeType;
+      const Vec2f* polygonVertices = vertices + record.firstVertex;
+      bool isSameShape = shapeType == body.mShape->getType();
+
+      //Shapes are shared and immutable, so a different one is looked up in
+      //the ShapeCache rather than changed in place.
+      if (isSameShape && shapeType == Shape::CIRCLE)
+         isSameShape = body.mShape->getRadius() == record.width;
+      else if (isSameShape && shapeType == Shape::RECTANGLE)
+      {
+         const Rectangle& rectangle = static_cast<const Rectangle&>(*body.mShape);
+         isSameShape = rectangle.getWidth() == record.width &&
+                       rectangle.getHeight() == record.height;
+      }
+      else if (isSameShape)
+      {
+         getSourceVertices(body.mShape, source);
+         isSameShape = hasVertices(source, polygonVertices, record.numberOfVertices);
+      }
+
+      if (!isSameShape)
+      {
+         if (shapeType == Shape::CIRCLE) body.mShape = ShapeCache::getCircle(record.width);
+         else if (shapeType == Shape::RECTANGLE)
+            body.mShape = ShapeCache::getRectangle(record.width, record.height);
+         else
+         {
+            polygon.assign(polygonVertices, polygonVertices + record.numberOfVertices);
+            body.mShape = ShapeCache::getPolygon(polygon);
+         }
+      }
+
+      body.mBodyType = (RigidBody::BodyType)record.bodyType;
+      body.mMaterial = RigidBody::Material{record.density, record.staticFriction,
+                                           record.kineticFriction, record.restitution};
+      body.mMassData = RigidBody::MassData{record.mass, record.inverseMass,
+                                           record.inertia, record.inverseInertia};
+      body.mTransform.setTranslation(Vec2f(record.x, record.y));
+      Transform& transform = body.mTransform;
+      transform.mAngle = record.angle;
+      transform.mRotationMatrix = Mat22f(record.rotation[0], record.rotation[1],
+                                         record.rotation[2], record.rotation[3]);
+      transform.mIsAngleStale = record.isAngleStale != 0;
+      body.mVelocity.set(record.velocityX, record.velocityY);
+      body.mForce.set(record.forceX, record.forceY);
+      body.mAngularVelocity = record.angularVelocity;
+      body.mTorque = record.torque;
+      body.mLayer = record.layer;
+      body.mIsSleeping = record.isSleeping != 0;
+      //The state was replaced, so a RollbackBuffer mustn't skip the body.
+      body.mChanges++;
+      const char* recordName = names + record.firstNameByte;
+      const std::string& currentName = body.mName.getName();
+      if (currentName.size() != record.nameLength ||
+          currentName.compare(0, record.nameLength, recordName, record.nameLength) != 0)
+      {
+         name.assign(recordName, record.nameLength);
+         body.mName = NameTable::Reference(name);
+      }
+   }
+
+   world.mCollisions.reserve(header.numberOfCollisions);
+   for (unsigned i = 0; i < header.numberOfCollisions; i++)
+   {
+      const CollisionRecord& record = collisions[i];
+      world.mCollisions.push_back(Collision(world.mBodies[record.bodyA].get(),
+                                            world.mBodies[record.bodyB].get()));
+      Collision& collision = world.mCollisions.back();
+      collision.mMixedStaticFriction = record.mixedStaticFriction;
+      collision.mMixedKineticFriction = record.mixedKineticFriction;
+      collision.mMixedRestitution = record.mixedRestitution;
+      collision.mContacts.resize(record.numberOfContacts);
+      if (record.numberOfContacts)
+      {
+         std::size_t bytes = record.numberOfContacts * sizeof(Collision::ContactData);
+         copyWords(collision.mContacts.data(), contacts, bytes);
+         contacts += bytes;
+      }
+   }
+
+   return true;
+}
+
+}
@@ -0,0 +1,90 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_WORLD_SERIALIZER_HPP_
+#define FZX_WORLD_SERIALIZER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace fzx
+{
+
+class World;
+
+/**
+ * Saves and restores the complete state of a World as a flat binary buffer.
+ *
+ * The layout is versioned and little-endian. It starts with a header, followed
+ * by fixed-size records for the RigidBodys, the Collisions and their contacts,
+ * then a pool of Polygon vertices and a pool of names. Every record is made of
+ * 4-byte words, so on little-endian machines each section is written and read
+ * with a single memcpy.
+ */
+class WorldSerializer
+{
+public:
+   static const uint32_t MAGIC = 0x57585A46; ///< "FZXW" in little-endian.
+   static const uint32_t VERSION = 3; ///< The version of the layout written.
+
+   /**
+    * Writes the state of a World into a buffer.
+    *
+    * Covers the World's settings, every RigidBody's shape, material, mass,
+    * transform, velocities, forces, layer, name and sleep state, and the
+    * Collisions of the last step with their contacts. Polygons are written as
+    * the vertices they were built from, so a restored one is interned as the
+    * same Shape as bodies built alike.
+    *
+    * @param world The World to save.
+    * @param buffer The buffer the state is written to. Its previous content is
+    * replaced.
+    */
+   static void serialize(World& world, std::vector<unsigned char>& buffer);
+
+   /**
+    * Restores the state of a World from a buffer.
+    *
+    * RigidBodys that already exist in the World are reused, and so are their
+    * Shapes when the type matches, so restoring into a World with the same
+    * layout doesn't allocate per body. On little-endian machines the records
+    * are read directly from the data without being copied. Every restored
+    * body counts as changed, for RollbackBuffer.
+    *
+    * Polygons with fewer than 3 vertices and NaN sizes or vertices make the
+    * data invalid.
+    *
+    * @param world The World to restore into.
+    * @param data A pointer to the serialized state.
+    * @param size The size of the data in bytes.
+    * @return Whether the data was valid. If not, the World is left untouched.
+    */
+   static bool deserialize(World& world, const unsigned char* data, std::size_t size);
+};
+
+}
+
+#endif /*FZX_WORLD_SERIALIZER_HPP_*/
@@ -0,0 +1,64 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#include "World.hpp"
+
+namespace fzx
+{
+
+const StepStats& World::getStepStats() const
+{
+   return mProfiler.getLast();
+}
+
+StepProfiler& World::getProfiler()
+{
+   return mProfiler;
+}
+
+Memory::Stats World::getMemoryStats(Memory::Category category) const
+{
+   return mMemory.getStats(category);
+}
+
+Memory::Stats World::getTotalMemoryStats() const
+{
+   return mMemory.getTotalStats();
+}
+
+void World::resetMemoryPeaks()
+{
+   mMemory.resetPeaks();
+}
+
+const StateHasher& World::hashState(float regionSize)
+{
+   if (regionSize != mStateHasher.getRegionSize()) mStateHasher.setRegionSize(regionSize);
+   mStateHasher.reset();
+   mStateHasher.addWorld(*this);
+   return mStateHasher;
+}
+
+}
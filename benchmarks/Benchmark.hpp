@@ -0,0 +1,210 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+
+#ifndef FZX_BENCHMARK_HPP_
+#define FZX_BENCHMARK_HPP_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace fzx
+{
+namespace benchmark
+{
+
+/**
+ * A small xorshift generator, so inputs are the same on every run and platform.
+ */
+class Random
+{
+private:
+   uint64_t mState; ///< The state of the generator, never zero.
+public:
+   /**
+    * Creates a generator with a given seed.
+    *
+    * @param seed The seed of the sequence.
+    */
+   explicit Random(uint64_t seed = 0x2545F4914F6CDD1DULL) : mState(seed ? seed : 1) {}
+
+   /**
+    * Returns the next 64 random bits.
+    *
+    * @return A random integer.
+    */
+   uint64_t next()
+   {
+      mState ^= mState >> 12;
+      mState ^= mState << 25;
+      mState ^= mState >> 27;
+      return mState * 0x2545F4914F6CDD1DULL;
+   }
+
+   /**
+    * Returns a random float in a given range.
+    *
+    * @param minimum The lowest value.
+    * @param maximum The highest value.
+    * @return A float in [minimum, maximum).
+    */
+   float nextFloat(float minimum, float maximum)
+   {
+      float unit = (next() >> 40) / 16777216.0f;
+      return minimum + unit * (maximum - minimum);
+   }
+};
+
+/**
+ * The timing of one benchmark.
+ */
+struct Result
+{
+   std::string name; ///< The name of the benchmark.
+   double nanosecondsPerOperation; ///< The median time of one operation.
+   double operationsPerSecond; ///< The inverse of nanosecondsPerOperation.
+   uint64_t operations; ///< The number of operations in each sample.
+};
+
+/**
+ * Keeps a value alive so the compiler can't remove the code that computed it.
+ *
+ * Every byte of the value counts as read, not just some of them.
+ *
+ * @param value The value to keep.
+ */
+template <typename T>
+inline void keep(const T& value)
+{
+#if defined(__GNUC__)
+   asm volatile("" : : "r"(&value) : "memory");
+#else
+   static volatile unsigned char sink[sizeof(T)];
+   const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+   for (size_t i = 0; i < sizeof(T); i++) sink[i] = bytes[i];
+#endif
+}
+
+/**
+ * Times an operation.
+ *
+ * The operation is called with an increasing iteration number. The number of
+ * calls per sample grows until a sample takes at least 20 milliseconds, then
+ * the median of several samples is reported.
+ *
+ * @param name The name of the benchmark.
+ * @param operation The operation to time, called as operation(iteration).
+ * @return The timing of the operation.
+ */
+template <typename Operation>
+Result run(const std::string& name, Operation operation)
+{
+   typedef std::chrono::steady_clock Clock;
+   const double minimumSampleSeconds = .02;
+   const unsigned numberOfSamples = 7;
+
+   uint64_t operations = 16;
+   uint64_t iteration = 0;
+   while (true)
+   {
+      Clock::time_point start = Clock::now();
+      for (uint64_t i = 0; i < operations; i++) operation(iteration++);
+      double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+      if (seconds >= minimumSampleSeconds || operations >= (1ULL << 40)) break;
+      operations *= 2;
+   }
+
+   std::vector<double> samples;
+   for (unsigned sample = 0; sample < numberOfSamples; sample++)
+   {
+      Clock::time_point start = Clock::now();
+      for (uint64_t i = 0; i < operations; i++) operation(iteration++);
+      samples.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+   }
+   std::sort(samples.begin(), samples.end());
+
+   Result result;
+   result.name = name;
+   result.operations = operations;
+   result.nanosecondsPerOperation = samples[numberOfSamples / 2] * 1e9 / operations;
+   result.operationsPerSecond = 1e9 / result.nanosecondsPerOperation;
+   return result;
+}
+
+/**
+ * Writes results as an aligned table.
+ *
+ * @param output The stream to write to.
+ * @param results The results to write.
+ */
+inline void writeTable(std::ostream& output, const std::vector<Result>& results)
+{
+   std::size_t width = 9;
+   for (const Result& result : results) width = std::max(width, result.name.size());
+
+   output << std::string(width, ' ') << "       ns/op        ops/sec\n";
+   for (const Result& result : results)
+   {
+      char line[64];
+      std::snprintf(line, sizeof(line), "%12.2f %14.0f",
+                    result.nanosecondsPerOperation, result.operationsPerSecond);
+      output << result.name << std::string(width - result.name.size(), ' ')
+             << line << '\n';
+   }
+}
+
+/**
+ * Writes results as JSON so runs can be compared across versions.
+ *
+ * @param output The stream to write to.
+ * @param suite The name of the benchmark suite.
+ * @param results The results to write.
+ */
+inline void writeJson(std::ostream& output, const std::string& suite,
+                      const std::vector<Result>& results)
+{
+   output << "{\n  \"suite\": \"" << suite << "\",\n  \"results\": [\n";
+   for (std::size_t i = 0; i < results.size(); i++)
+   {
+      char numbers[96];
+      std::snprintf(numbers, sizeof(numbers),
+                    "\"ns_per_op\": %.4f, \"ops_per_sec\": %.1f, \"operations\": %llu",
+                    results[i].nanosecondsPerOperation, results[i].operationsPerSecond,
+                    (unsigned long long)results[i].operations);
+      output << "    {\"name\": \"" << results[i].name << "\", " << numbers << "}"
+             << (i + 1 < results.size() ? ",\n" : "\n");
+   }
+   output << "  ]\n}\n";
+}
+
+}
+}
+
+#endif /*FZX_BENCHMARK_HPP_*/
@@ -0,0 +1,280 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// Compares the cache behaviour of the RigidBody layout, with its per-step
+// fields packed into the first cache line, against the layout it replaced,
+// which interleaved them with the name, material and shape. Each layout runs
+// the loops of World::integrateVelocity() and World::applyImpulse() over
+// bodies visited in a scattered order, the way a World finds them on the heap.
+// Build it with every library source, World.cpp and Collision.cpp included:
+//
+//    g++ -std=c++11 -O2 -pthread LayoutBenchmarks.cpp ../*.cpp -o LayoutBenchmarks
+//
+// Usage: LayoutBenchmarks [--counts 10000,100000,1000000]
+//
+// Cache misses are read from the hardware counters where the system allows
+// it, and shown as - otherwise.
+//
+////////////////////////////////////////////////////////////
+
+#include "Benchmark.hpp"
+
+#include "../RigidBody.hpp"
+#include "../PerfCounters.hpp"
+#include "../ShapeCache.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <sstream>
+
+using namespace fzx;
+using namespace fzx::benchmark;
+
+namespace fzx
+{
+
+/**
+ * The fields World's loops use, on RigidBody itself.
+ */
+struct RigidBodyFields
+{
+   static void setUp(RigidBody& body, RigidBody::BodyType type, const std::shared_ptr<const Shape>& shape)
+   {
+      body.setShape(shape);
+      body.setBodyType(type);
+   }
+
+   static RigidBody::BodyType bodyType(const RigidBody& body) { return body.mBodyType; }
+   static bool isSleeping(const RigidBody& body) { return body.mIsSleeping; }
+   static const RigidBody::MassData& massData(const RigidBody& body) { return body.mMassData; }
+   static Transform& transform(RigidBody& body) { return body.mTransform; }
+   static Vec2f& velocity(RigidBody& body) { return body.mVelocity; }
+   static float& angularVelocity(RigidBody& body) { return body.mAngularVelocity; }
+};
+
+}
+
+namespace
+{
+
+/**
+ * The fields of RigidBody in the order they had before the hot/cold split,
+ * when it owned its name and pointed to a Shape of its own.
+ */
+struct InterleavedBody
+{
+   RigidBody::BodyType bodyType;
+   RigidBody::MassData massData;
+   RigidBody::Material material;
+   const Shape* shape;
+   std::string name;
+   Transform transform;
+   Vec2f velocity;
+   Vec2f force;
+   float angularVelocity;
+   float torque;
+   int layer;
+   bool isSleeping;
+};
+
+/**
+ * The fields World's loops use, on InterleavedBody.
+ */
+struct InterleavedBodyFields
+{
+   static void setUp(InterleavedBody& body, RigidBody::BodyType type, const std::shared_ptr<const Shape>& shape)
+   {
+      body.bodyType = type;
+      body.material = RigidBody::Material{1, 0, 0, 1};
+      body.shape = shape.get();
+      body.massData.mass = shape->getArea() * body.material.density;
+      body.massData.inertia = shape->getInertiaPerMass() * body.massData.mass;
+      body.massData.inverseMass = 1 / body.massData.mass;
+      body.massData.inverseInertia = 1 / body.massData.inertia;
+      body.isSleeping = false;
+   }
+
+   static RigidBody::BodyType bodyType(const InterleavedBody& body) { return body.bodyType; }
+   static bool isSleeping(const InterleavedBody& body) { return body.isSleeping; }
+   static const RigidBody::MassData& massData(const InterleavedBody& body) { return body.massData; }
+   static Transform& transform(InterleavedBody& body) { return body.transform; }
+   static Vec2f& velocity(InterleavedBody& body) { return body.velocity; }
+   static float& angularVelocity(InterleavedBody& body) { return body.angularVelocity; }
+};
+
+/**
+ * A set of bodies in one block, and the scattered order they are visited in.
+ * Fields reads and writes the fields of a Body.
+ */
+template <typename Body, typename Fields>
+class Bodies
+{
+private:
+   Body* mBodies;
+   unsigned mCount;
+   std::vector<Body*> mOrder;
+
+   Bodies(const Bodies&);
+   Bodies& operator=(const Bodies&);
+public:
+   explicit Bodies(unsigned count) : mCount(count)
+   {
+      mBodies = static_cast<Body*>(Memory::allocate(count * sizeof(Body), Memory::BODIES, alignof(Body)));
+      std::shared_ptr<const Shape> shape = ShapeCache::getRectangle(1, 1);
+      Random random;
+      for (unsigned i = 0; i < count; i++)
+      {
+         Body* body = ::new (mBodies + i) Body();
+         Fields::setUp(*body, i % 16 == 0 ? RigidBody::STATIC : RigidBody::DYNAMIC, shape);
+         Fields::transform(*body).setTranslation(Vec2f(random.nextFloat(-100, 100), random.nextFloat(-100, 100)));
+         Fields::velocity(*body) = Vec2f(random.nextFloat(-1, 1), random.nextFloat(-1, 1));
+         Fields::angularVelocity(*body) = random.nextFloat(-1, 1);
+         mOrder.push_back(body);
+      }
+      for (unsigned i = count; i > 1; i--) std::swap(mOrder[i - 1], mOrder[random.next() % i]);
+   }
+
+   ~Bodies()
+   {
+      for (unsigned i = 0; i < mCount; i++) mBodies[i].~Body();
+      Memory::deallocate(mBodies, mCount * sizeof(Body), Memory::BODIES, alignof(Body));
+   }
+
+   Body& operator[](unsigned i)
+   {
+      return *mOrder[i];
+   }
+
+   unsigned size() const
+   {
+      return mCount;
+   }
+};
+
+/**
+ * Moves every awake, non-static body by its velocities.
+ */
+template <typename Body, typename Fields>
+void integrateVelocity(Bodies<Body, Fields>& bodies, float deltaTime)
+{
+   for (unsigned i = 0; i < bodies.size(); i++)
+   {
+      Body& body = bodies[i];
+      if (Fields::bodyType(body) == RigidBody::STATIC || Fields::isSleeping(body)) continue;
+      Fields::transform(body).translate(Fields::velocity(body) * deltaTime);
+      Fields::transform(body).rotate(Fields::angularVelocity(body) * deltaTime);
+   }
+}
+
+/**
+ * Applies an opposite impulse to each body and the next one in visiting order.
+ */
+template <typename Body, typename Fields>
+void applyImpulse(Bodies<Body, Fields>& bodies)
+{
+   const Vec2f impulse(0, 1e-6f);
+   const Vec2f arm(.5f, .5f);
+   for (unsigned i = 0; i + 1 < bodies.size(); i++)
+   {
+      Body& a = bodies[i];
+      Body& b = bodies[i + 1];
+      Fields::velocity(a) -= impulse * Fields::massData(a).inverseMass;
+      Fields::angularVelocity(a) -= (arm % impulse) * Fields::massData(a).inverseInertia;
+      Fields::velocity(b) += impulse * Fields::massData(b).inverseMass;
+      Fields::angularVelocity(b) += (arm % impulse) * Fields::massData(b).inverseInertia;
+   }
+}
+
+/**
+ * Runs one loop over some bodies and prints its time and misses per body.
+ */
+template <typename Body, typename Fields, typename Loop>
+void measure(const std::string& name, Bodies<Body, Fields>& bodies, const PerfCounters& counters, Loop loop)
+{
+   Result result = run(name, [&](uint64_t) { loop(bodies); });
+
+   const unsigned passes = 8;
+   HardwareCounters start = counters.read();
+   for (unsigned pass = 0; pass < passes; pass++) loop(bodies);
+   HardwareCounters misses = counters.read() - start;
+
+   double visits = double(bodies.size()) * passes;
+   char l1[32] = "-", llc[32] = "-";
+   if (counters.isAvailable(PerfCounters::L1_MISSES))
+      std::snprintf(l1, sizeof(l1), "%.3f", misses.l1Misses / visits);
+   if (counters.isAvailable(PerfCounters::LLC_MISSES))
+      std::snprintf(llc, sizeof(llc), "%.3f", misses.llcMisses / visits);
+   std::printf("%-40s %10.2f %12s %12s\n", name.c_str(),
+               result.nanosecondsPerOperation / bodies.size(), l1, llc);
+}
+
+template <typename Body, typename Fields>
+void measureLayout(const std::string& layout, unsigned count, const PerfCounters& counters)
+{
+   Bodies<Body, Fields> bodies(count);
+   std::string suffix = " " + layout + " " + std::to_string(count);
+   measure("integrateVelocity" + suffix, bodies, counters,
+           [](Bodies<Body, Fields>& bodies) { integrateVelocity(bodies, 1.f / 60); });
+   measure("applyImpulse" + suffix, bodies, counters,
+           [](Bodies<Body, Fields>& bodies) { applyImpulse(bodies); });
+}
+
+}
+
+int main(int argc, char** argv)
+{
+   std::vector<unsigned> counts = {10000, 100000, 1000000};
+   for (int i = 1; i < argc; i++)
+   {
+      std::string argument = argv[i];
+      if (argument == "--counts" && i + 1 < argc)
+      {
+         counts.clear();
+         std::stringstream list(argv[++i]);
+         std::string count;
+         while (std::getline(list, count, ',')) counts.push_back(std::strtoul(count.c_str(), nullptr, 10));
+      }
+      else
+      {
+         std::cerr << "Usage: " << argv[0] << " [--counts 10000,100000,1000000]\n";
+         return 1;
+      }
+   }
+
+   PerfCounters counters;
+   if (!counters.open()) std::cerr << "Hardware counters are unavailable, misses are not shown\n";
+
+   std::printf("sizeof: interleaved %u, RigidBody %u bytes\n",
+               (unsigned)sizeof(InterleavedBody), (unsigned)sizeof(RigidBody));
+   std::printf("%-40s %10s %12s %12s\n", "", "ns/body", "L1 miss/body", "LLC miss/body");
+   for (unsigned count : counts)
+   {
+      measureLayout<InterleavedBody, InterleavedBodyFields>("interleaved", count, counters);
+      measureLayout<RigidBody, RigidBodyFields>("split", count, counters);
+   }
+   return 0;
+}
@@ -0,0 +1,415 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// Times the primitives of the math and shape layers, and each of the shape
+// pair routines of Collision. Rectangle::collide() is also timed against
+// Collision::solve() on the same boxes as Polygons, and checked to find the
+// same contacts, and SeparatingAxisCache is timed on pairs that nearly
+// touch against Collision::solve(). The Fixed math is timed against the
+// same float operations, and the ratio of the two is reported. Build it with
+// every library source, World.cpp and Collision.cpp included:
+//
+//    g++ -std=c++11 -O2 -pthread MicroBenchmarks.cpp ../*.cpp -o MicroBenchmarks
+//
+// Usage: MicroBenchmarks [--filter text] [--json file]
+//
+////////////////////////////////////////////////////////////
+
+#include "Benchmark.hpp"
+
+#include "../Collision.hpp"
+#include "../Circle.hpp"
+#include "../Fixed.hpp"
+#include "../Rectangle.hpp"
+#include "../Polygon.hpp"
+#include "../SeparatingAxisCache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+
+using namespace fzx;
+using namespace fzx::benchmark;
+
+namespace
+{
+
+const unsigned NUMBER_OF_INPUTS = 1024; ///< A power of two, so inputs wrap with a mask.
+const unsigned INPUT_MASK = NUMBER_OF_INPUTS - 1;
+
+/**
+ * The deterministic inputs the benchmarks cycle through.
+ */
+struct Inputs
+{
+   std::vector<Vec2f> vectors;
+   std::vector<float> angles;
+   std::vector<Mat22f> matrices;
+   std::vector<Transform> transforms;
+   std::vector<Vec2x> fixedVectors; ///< The vectors as Fixed.
+   std::vector<Fixed> fixedAngles; ///< The angles as Fixed.
+   std::vector<Mat22x> fixedMatrices; ///< The matrices of the Fixed angles.
+
+   Inputs()
+   {
+      Random random;
+      for (unsigned i = 0; i < NUMBER_OF_INPUTS; i++)
+      {
+         vectors.push_back(Vec2f(random.nextFloat(-10, 10), random.nextFloat(-10, 10)));
+         angles.push_back(random.nextFloat(-3.1415926f, 3.1415926f));
+         matrices.push_back(Mat22f(angles.back()));
+         Transform transform;
+         transform.setTranslation(Vec2f(random.nextFloat(-100, 100), random.nextFloat(-100, 100)));
+         transform.setRotation(angles.back());
+         transforms.push_back(transform);
+         fixedVectors.push_back(Vec2x(Fixed(vectors.back().x), Fixed(vectors.back().y)));
+         fixedAngles.push_back(Fixed(angles.back()));
+         fixedMatrices.push_back(Mat22x(fixedAngles.back()));
+      }
+   }
+};
+
+/**
+ * Creates a convex polygon with a given number of vertices on a circle.
+ */
+std::vector<Vec2f> makeRegularPolygon(unsigned numberOfVertices, float radius)
+{
+   std::vector<Vec2f> vertices;
+   for (unsigned i = 0; i < numberOfVertices; i++)
+   {
+      float angle = 6.2831853f * i / numberOfVertices;
+      vertices.push_back(Vec2f(std::cos(angle), std::sin(angle)) * radius);
+   }
+   return vertices;
+}
+
+/**
+ * Makes a RigidBody with a given shape: 'c' for Circle, 'r' for Rectangle,
+ * 'p' for Polygon and 'b' for the same 2 by 1 box as the Rectangle, but as a
+ * Polygon.
+ */
+std::unique_ptr<RigidBody> makeBody(char shape)
+{
+   std::unique_ptr<RigidBody> body(new RigidBody(std::string(1, shape)));
+   if (shape == 'r') body->setShapeToRectangle(2, 1);
+   if (shape == 'p') body->setShapeToPolygon(makeRegularPolygon(6, 1));
+   if (shape == 'b') body->setShapeToPolygon({Vec2f(1, -.5f), Vec2f(1, .5f), Vec2f(-1, .5f), Vec2f(-1, -.5f)});
+   return body;
+}
+
+/**
+ * The placements of the second body in the pair benchmarks. Most, but not all,
+ * overlap a body of radius 1 at the origin.
+ */
+std::vector<Transform> makePlacements()
+{
+   std::vector<Transform> placements;
+   Random random(7);
+   for (unsigned i = 0; i < NUMBER_OF_INPUTS; i++)
+   {
+      Transform transform;
+      transform.setTranslation(Vec2f(random.nextFloat(-2.5f, 2.5f), random.nextFloat(-2.5f, 2.5f)));
+      transform.setRotation(random.nextFloat(-3.1415926f, 3.1415926f));
+      placements.push_back(transform);
+   }
+   return placements;
+}
+
+/**
+ * Times Collision::solve() for a pair of shapes. The second body is placed at
+ * deterministic offsets so that most, but not all, pairs overlap.
+ */
+Result runPair(const std::string& name, char shapeA, char shapeB)
+{
+   std::unique_ptr<RigidBody> bodyA = makeBody(shapeA);
+   std::unique_ptr<RigidBody> bodyB = makeBody(shapeB);
+   std::vector<Transform> placements = makePlacements();
+
+   return run(name, [&](uint64_t i)
+   {
+      bodyB->getTransform() = placements[i & INPUT_MASK];
+      Collision collision(bodyA.get(), bodyB.get());
+      collision.solve();
+      keep(collision.getNumberOfContacts());
+   });
+}
+
+/**
+ * Times Rectangle::collide() on a 2 by 1 box at the origin and another at each
+ * of the placements.
+ */
+Result runRectangleCollide(const std::string& name, const Rectangle& rectangle)
+{
+   std::vector<Transform> placements = makePlacements();
+   const Transform origin;
+   Rectangle::Manifold manifold;
+   return run(name, [&](uint64_t i)
+   {
+      Rectangle::collide(rectangle, origin, rectangle, placements[i & INPUT_MASK], manifold);
+      keep(manifold);
+   });
+}
+
+/**
+ * Checks that Rectangle::collide() and Collision::solve() on the same boxes as
+ * Polygons find the same number of contacts and the same deepest penetration
+ * for every placement, so the two are timing the same work.
+ *
+ * @return The number of placements they disagree on.
+ */
+unsigned countDisagreements(const Rectangle& rectangle)
+{
+   unsigned disagreements = 0;
+   const Transform origin;
+   std::unique_ptr<RigidBody> boxA = makeBody('b');
+   std::unique_ptr<RigidBody> boxB = makeBody('b');
+   for (const Transform& placement : makePlacements())
+   {
+      Rectangle::Manifold manifold;
+      Rectangle::collide(rectangle, origin, rectangle, placement, manifold);
+      float deepest = 0;
+      for (unsigned i = 0; i < manifold.numberOfContacts; i++) deepest = std::max(deepest, manifold.penetrations[i]);
+
+      boxB->getTransform() = placement;
+      Collision collision(boxA.get(), boxB.get());
+      collision.solve();
+      float genericDeepest = 0;
+      for (unsigned i = 0; i < collision.getNumberOfContacts(); i++)
+         genericDeepest = std::max(genericDeepest, collision.getContactData(i).penetration);
+
+      if (manifold.numberOfContacts != collision.getNumberOfContacts()
+          || std::abs(deepest - genericDeepest) > 1e-3f)
+         disagreements++;
+   }
+   return disagreements;
+}
+
+/**
+ * Finds the placements where a hexagon overlaps the BoundingBox of one at the
+ * origin without touching it, the pairs the broad phase reports for nothing.
+ */
+std::vector<std::unique_ptr<RigidBody>> makeNearMisses(RigidBody& hexagon)
+{
+   std::vector<std::unique_ptr<RigidBody>> nearMisses;
+   for (const Transform& placement : makePlacements())
+   {
+      std::unique_ptr<RigidBody> other = makeBody('p');
+      other->getTransform() = placement;
+      if (!Collision::checkBoundingBoxes(&hexagon, other.get())) continue;
+      Collision collision(&hexagon, other.get());
+      collision.solve();
+      if (collision.getNumberOfContacts() == 0) nearMisses.push_back(std::move(other));
+   }
+   return nearMisses;
+}
+
+/**
+ * Times SeparatingAxisCache::isSeparated() on the near misses of two hexagons,
+ * each pair checked once per round like a persistent pair of the broad phase,
+ * so the face cached in the last round is tried first.
+ */
+Result runCachedNearMisses(const std::string& name)
+{
+   std::unique_ptr<RigidBody> hexagon = makeBody('p');
+   std::vector<std::unique_ptr<RigidBody>> nearMisses = makeNearMisses(*hexagon);
+   SeparatingAxisCache cache;
+   for (std::unique_ptr<RigidBody>& other : nearMisses) cache.isSeparated(*hexagon, *other);
+   return run(name, [&](uint64_t i)
+   {
+      keep(cache.isSeparated(*hexagon, *nearMisses[i % nearMisses.size()]));
+   });
+}
+
+/**
+ * Times Collision::solve() on the same near misses, the work the cache saves
+ * the pairs it finds apart.
+ */
+Result runNearMisses(const std::string& name)
+{
+   std::unique_ptr<RigidBody> hexagon = makeBody('p');
+   std::vector<std::unique_ptr<RigidBody>> nearMisses = makeNearMisses(*hexagon);
+   return run(name, [&](uint64_t i)
+   {
+      Collision collision(hexagon.get(), nearMisses[i % nearMisses.size()].get());
+      collision.solve();
+      keep(collision.getNumberOfContacts());
+   });
+}
+
+bool matches(const std::string& name, const std::string& filter)
+{
+   return filter.empty() || name.find(filter) != std::string::npos;
+}
+
+/**
+ * Prints how many times slower each Fixed operation is than its float
+ * counterpart, for the pairs that were both run.
+ */
+void writeFixedRatios(std::ostream& output, const std::vector<Result>& results)
+{
+   for (const Result& fixed : results)
+   {
+      //Vec2x and Mat22x are named after Vec2f and Mat22f, less the suffix.
+      if (fixed.name.find("2x") == std::string::npos) continue;
+      std::string floatName;
+      for (std::string::size_type i = 0; i < fixed.name.size(); i++)
+         if (fixed.name[i] != 'x' || i == 0 || fixed.name[i - 1] != '2') floatName += fixed.name[i];
+      for (const Result& other : results)
+      {
+         if (other.name != floatName) continue;
+         output << fixed.name << " costs " << fixed.nanosecondsPerOperation / other.nanosecondsPerOperation
+                << "x " << other.name << '\n';
+      }
+   }
+}
+
+}
+
+int main(int argc, char** argv)
+{
+   std::string filter;
+   std::string jsonPath;
+   for (int i = 1; i < argc; i += 2)
+   {
+      std::string option = i + 1 < argc ? argv[i] : "";
+      if (option == "--filter") filter = argv[i + 1];
+      else if (option == "--json") jsonPath = argv[i + 1];
+      else
+      {
+         std::cerr << "Usage: " << argv[0] << " [--filter text] [--json file]\n";
+         return 1;
+      }
+   }
+
+   const Inputs inputs;
+   const std::vector<Vec2f>& v = inputs.vectors;
+   const std::vector<Transform>& t = inputs.transforms;
+   Circle circle(1);
+   Rectangle rectangle(2, 1);
+   Polygon polygon(makeRegularPolygon(8, 1));
+
+   std::vector<Result> results;
+   auto add = [&](const std::string& name, std::function<Result(const std::string&)> benchmark)
+   {
+      if (matches(name, filter)) results.push_back(benchmark(name));
+   };
+
+   add("Vec2::operator+", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(v[i & INPUT_MASK] + v[(i + 1) & INPUT_MASK]); }); });
+   add("Vec2::dot", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(v[i & INPUT_MASK] * v[(i + 1) & INPUT_MASK]); }); });
+   add("Vec2::cross", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(v[i & INPUT_MASK] % v[(i + 1) & INPUT_MASK]); }); });
+   add("Vec2::getMagnitude", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(v[i & INPUT_MASK].getMagnitude()); }); });
+   add("Vec2::getDirection", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(v[i & INPUT_MASK].getDirection()); }); });
+   add("Mat22::Mat22(theta)", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(Mat22f(inputs.angles[i & INPUT_MASK])); }); });
+   add("Mat22::operator*(Vec2)", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(inputs.matrices[i & INPUT_MASK] * v[(i + 1) & INPUT_MASK]); }); });
+   add("Mat22::operator*(Mat22)", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(inputs.matrices[i & INPUT_MASK] * inputs.matrices[(i + 1) & INPUT_MASK]); }); });
+   add("Mat22::getInverse", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(inputs.matrices[i & INPUT_MASK].getInverse()); }); });
+   const std::vector<Vec2x>& vx = inputs.fixedVectors;
+   add("Vec2x::operator+", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(vx[i & INPUT_MASK] + vx[(i + 1) & INPUT_MASK]); }); });
+   add("Vec2x::dot", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(vx[i & INPUT_MASK] * vx[(i + 1) & INPUT_MASK]); }); });
+   add("Vec2x::cross", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(vx[i & INPUT_MASK] % vx[(i + 1) & INPUT_MASK]); }); });
+   add("Vec2x::getMagnitude", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(vx[i & INPUT_MASK].getMagnitude()); }); });
+   add("Vec2x::getDirection", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(vx[i & INPUT_MASK].getDirection()); }); });
+   add("Mat22x::Mat22(theta)", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(Mat22x(inputs.fixedAngles[i & INPUT_MASK])); }); });
+   add("Mat22x::operator*(Vec2x)", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(inputs.fixedMatrices[i & INPUT_MASK] * vx[(i + 1) & INPUT_MASK]); }); });
+   add("Mat22x::operator*(Mat22x)", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(inputs.fixedMatrices[i & INPUT_MASK] * inputs.fixedMatrices[(i + 1) & INPUT_MASK]); }); });
+   add("Transform::apply", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(t[i & INPUT_MASK].apply(v[(i + 1) & INPUT_MASK])); }); });
+   add("Transform::rotate", [&](const std::string& name)
+   {
+      Transform transform;
+      return run(name, [&](uint64_t i)
+      {
+         transform.rotate(inputs.angles[i & INPUT_MASK] * .01f);
+         keep(transform.getRotationMatrix());
+      });
+   });
+   add("Circle::getBoundingBox", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(circle.getBoundingBox(t[i & INPUT_MASK])); }); });
+   add("Rectangle::getBoundingBox", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(rectangle.getBoundingBox(t[i & INPUT_MASK])); }); });
+   add("Polygon::getBoundingBox", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(polygon.getBoundingBox(t[i & INPUT_MASK])); }); });
+   add("Circle::getSupport", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(circle.getSupport(v[i & INPUT_MASK], t[(i + 1) & INPUT_MASK])); }); });
+   add("Rectangle::getSupport", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(rectangle.getSupport(v[i & INPUT_MASK], t[(i + 1) & INPUT_MASK])); }); });
+   add("Polygon::getSupport", [&](const std::string& name) { return run(name,
+      [&](uint64_t i) { keep(polygon.getSupport(v[i & INPUT_MASK], t[(i + 1) & INPUT_MASK])); }); });
+
+   add("Collision::solveCircleVsCircle", [&](const std::string& name) { return runPair(name, 'c', 'c'); });
+   add("Collision::solveCircleVsRectangle", [&](const std::string& name) { return runPair(name, 'c', 'r'); });
+   add("Collision::solveCircleVsPolygon", [&](const std::string& name) { return runPair(name, 'c', 'p'); });
+   add("Collision::solveRectangleVsRectangle", [&](const std::string& name) { return runPair(name, 'r', 'r'); });
+   add("Collision::solveRectangleVsPolygon", [&](const std::string& name) { return runPair(name, 'r', 'p'); });
+   add("Collision::solvePolygonVsPolygon", [&](const std::string& name) { return runPair(name, 'p', 'p'); });
+
+   //The closed form kernel against Collision's generic path on the same boxes
+   //as Polygons.
+   add("Rectangle::collide", [&](const std::string& name) { return runRectangleCollide(name, rectangle); });
+   add("Collision::solve on box Polygons", [&](const std::string& name) { return runPair(name, 'b', 'b'); });
+   add("SeparatingAxisCache::isSeparated", runCachedNearMisses);
+   add("Collision::solve on near misses", runNearMisses);
+   if (matches("Rectangle::collide", filter))
+   {
+      unsigned disagreements = countDisagreements(rectangle);
+      if (disagreements > 0)
+         std::cerr << "Rectangle::collide disagrees with Collision on box Polygons on "
+                   << disagreements << " of " << NUMBER_OF_INPUTS << " placements\n";
+   }
+
+   writeTable(std::cout, results);
+   writeFixedRatios(std::cout, results);
+   if (!jsonPath.empty())
+   {
+      std::ofstream json(jsonPath.c_str());
+      writeJson(json, "micro", results);
+      if (!json)
+      {
+         std::cerr << "Could not write " << jsonPath << '\n';
+         return 1;
+      }
+   }
+   return 0;
+}
@@ -0,0 +1,159 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// Times StateEncoder and StateDecoder on a World of circles where only some
+// bodies are awake, and reports the size of the packets. Build it with every
+// library source, World.cpp and Collision.cpp included:
+//
+//    g++ -std=c++11 -O2 -pthread ReplicationBenchmarks.cpp ../*.cpp -o ReplicationBenchmarks
+//
+// Usage: ReplicationBenchmarks [--bodies 50000] [--awake fraction] [--json file]
+//
+// Deltas are encoded alternately from two copies of the scene a step apart,
+// so every awake body changes in every packet without timing World::step().
+//
+////////////////////////////////////////////////////////////
+
+#include "Benchmark.hpp"
+
+#include "../Replication.hpp"
+#include "../World.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using namespace fzx;
+using namespace fzx::benchmark;
+
+namespace
+{
+
+/**
+ * Fills a World with a grid of circles without gravity. A fraction of them
+ * drift, the rest are put to sleep.
+ */
+void buildWorld(World& world, unsigned count, float awakeFraction)
+{
+   Random random;
+   world.setGravity(Vec2f(0, 0));
+   unsigned columns = (unsigned)std::sqrt((float)count) + 1;
+   for (unsigned i = 0; i < count; i++)
+   {
+      RigidBody& body = world.addBody("circle");
+      body.setShapeToCircle(.5f);
+      body.getTransform().setTranslation(Vec2f((i % columns) * 1.5f, (i / columns) * 1.5f));
+      if (random.nextFloat(0, 1) < awakeFraction)
+         body.setPush(Vec2f(random.nextFloat(-1, 1), random.nextFloat(-1, 1)), RigidBody::VELOCITY);
+      else body.stop();
+   }
+}
+
+/**
+ * Fills in the throughput of a Result in bodies instead of packets.
+ */
+Result perBody(Result result, unsigned count)
+{
+   result.name += " (per body)";
+   result.nanosecondsPerOperation /= count;
+   result.operationsPerSecond *= count;
+   return result;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+   unsigned count = 50000;
+   float awakeFraction = .1f;
+   std::string jsonPath;
+   for (int i = 1; i < argc; i += 2)
+   {
+      std::string option = i + 1 < argc ? argv[i] : "";
+      if (option == "--bodies") count = std::max(1, std::atoi(argv[i + 1]));
+      else if (option == "--awake") awakeFraction = std::atof(argv[i + 1]);
+      else if (option == "--json") jsonPath = argv[i + 1];
+      else
+      {
+         std::cerr << "Usage: " << argv[0] << " [--bodies 50000] [--awake fraction] [--json file]\n";
+         return 1;
+      }
+   }
+
+   World first(4, 8, 1.f / 60), second(4, 8, 1.f / 60);
+   World* worlds[2] = {&first, &second};
+   buildWorld(first, count, awakeFraction);
+   buildWorld(second, count, awakeFraction);
+   second.step();
+
+   Quantization quantization = {1.f / 1024, 1.f / 256, 1.f / 256, 16, 60};
+   Quantization keyframes = quantization;
+   keyframes.keyframeInterval = 1;
+   StateEncoder keyframeEncoder(keyframes);
+   StateEncoder deltaEncoder(quantization);
+   StateDecoder decoder(quantization);
+   std::vector<unsigned char> keyframe, delta;
+   bool isValid = keyframeEncoder.encode(first, keyframe) && decoder.decode(keyframe.data(), keyframe.size());
+
+   std::string suffix = " " + std::to_string(count) + " bodies";
+   std::vector<Result> results;
+   results.push_back(run("encode keyframe" + suffix, [&](uint64_t)
+   {
+      keyframeEncoder.encode(first, keyframe);
+   }));
+   results.push_back(run("decode keyframe" + suffix, [&](uint64_t)
+   {
+      decoder.decode(keyframe.data(), keyframe.size());
+   }));
+
+   //The keyframe interval is never reached, so every packet after the first is a delta.
+   deltaEncoder.encode(first, delta);
+   results.push_back(run("encode delta" + suffix, [&](uint64_t iteration)
+   {
+      deltaEncoder.encode(*worlds[(iteration + 1) % 2], delta);
+   }));
+   isValid = isValid && delta.size() > 0;
+
+   results.push_back(perBody(results[0], count));
+   results.push_back(perBody(results[2], count));
+   writeTable(std::cout, results);
+   std::printf("\n%.1f%% awake, keyframe %.2f bytes per body, delta %.2f bytes per body%s\n",
+               awakeFraction * 100, double(keyframe.size()) / count, double(delta.size()) / count,
+               isValid ? "" : ", ENCODING FAILED");
+
+   if (!jsonPath.empty())
+   {
+      std::ofstream json(jsonPath.c_str());
+      writeJson(json, "ReplicationBenchmarks", results);
+      if (!json)
+      {
+         std::cerr << "Could not write " << jsonPath << '\n';
+         return 1;
+      }
+   }
+   return isValid ? 0 : 2;
+}
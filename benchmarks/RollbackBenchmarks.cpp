@@ -0,0 +1,189 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// Times RollbackBuffer on a World of circles where only some bodies are awake,
+// the case it is built for: recording each step, restoring a number of frames
+// and resimulating back to the present. Build it with every library source,
+// World.cpp and Collision.cpp included:
+//
+//    g++ -std=c++11 -O2 -pthread RollbackBenchmarks.cpp ../*.cpp -o RollbackBenchmarks
+//
+// Usage: RollbackBenchmarks [--bodies 10000] [--frames 8] [--awake fraction]
+//                           [--json file]
+//
+// The rollback times include the steps taken to get back to the present, so
+// they are compared against the same number of plain steps.
+//
+////////////////////////////////////////////////////////////
+
+#include "Benchmark.hpp"
+
+#include "../RollbackBuffer.hpp"
+#include "../StateHash.hpp"
+#include "../World.hpp"
+
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+
+using namespace fzx;
+using namespace fzx::benchmark;
+
+namespace
+{
+
+/**
+ * Fills a World with a grid of circles without gravity. A fraction of them
+ * drift and collide, the rest are put to sleep.
+ */
+void buildWorld(World& world, unsigned count, float awakeFraction)
+{
+   Random random;
+   world.setGravity(Vec2f(0, 0));
+   unsigned columns = (unsigned)std::sqrt((float)count) + 1;
+   for (unsigned i = 0; i < count; i++)
+   {
+      RigidBody& body = world.addBody("circle");
+      body.setShapeToCircle(.5f);
+      body.getTransform().setTranslation(Vec2f((i % columns) * 1.5f, (i / columns) * 1.5f));
+      if (random.nextFloat(0, 1) < awakeFraction)
+         body.setPush(Vec2f(random.nextFloat(-1, 1), random.nextFloat(-1, 1)), RigidBody::VELOCITY);
+      else body.stop();
+   }
+}
+
+uint64_t hashWorld(World& world)
+{
+   StateHasher hasher;
+   hasher.addWorld(world);
+   return hasher.getHash();
+}
+
+/**
+ * Steps a World and records every step.
+ */
+void advance(World& world, RollbackBuffer& buffer, unsigned frames)
+{
+   for (unsigned i = 0; i < frames; i++)
+   {
+      world.step();
+      buffer.record();
+   }
+}
+
+/**
+ * Times restoring a number of frames on its own. The steps back to the
+ * present between samples aren't timed.
+ */
+Result runRestore(const std::string& name, World& world, RollbackBuffer& buffer, unsigned frames)
+{
+   typedef std::chrono::steady_clock Clock;
+   const unsigned numberOfSamples = 15;
+   std::vector<double> samples;
+   for (unsigned sample = 0; sample < numberOfSamples; sample++)
+   {
+      Clock::time_point start = Clock::now();
+      buffer.restore(buffer.getFrame() - frames);
+      samples.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+      advance(world, buffer, frames);
+   }
+   std::sort(samples.begin(), samples.end());
+
+   Result result;
+   result.name = name;
+   result.operations = 1;
+   result.nanosecondsPerOperation = samples[numberOfSamples / 2] * 1e9;
+   result.operationsPerSecond = 1e9 / result.nanosecondsPerOperation;
+   return result;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+   unsigned count = 10000;
+   unsigned frames = 8;
+   float awakeFraction = .1f;
+   std::string jsonPath;
+   for (int i = 1; i < argc; i += 2)
+   {
+      std::string option = i + 1 < argc ? argv[i] : "";
+      if (option == "--bodies") count = std::max(1, std::atoi(argv[i + 1]));
+      else if (option == "--frames") frames = std::max(1, std::atoi(argv[i + 1]));
+      else if (option == "--awake") awakeFraction = std::atof(argv[i + 1]);
+      else if (option == "--json") jsonPath = argv[i + 1];
+      else
+      {
+         std::cerr << "Usage: " << argv[0] << " [--bodies 10000] [--frames 8]"
+                   << " [--awake fraction] [--json file]\n";
+         return 1;
+      }
+   }
+
+   World world(4, 8, 1.f / 60);
+   buildWorld(world, count, awakeFraction);
+   RollbackBuffer buffer(world, frames * 2);
+   advance(world, buffer, frames * 2);
+
+   std::string suffix = " " + std::to_string(count) + " bodies";
+   std::string rollback = std::to_string(frames) + " frames";
+   std::vector<Result> results;
+   results.push_back(run("World::step" + suffix, [&](uint64_t) { world.step(); }));
+   results.push_back(run("World::step + record" + suffix, [&](uint64_t) { advance(world, buffer, 1); }));
+   results.push_back(run(rollback + " of World::step + record" + suffix,
+                         [&](uint64_t) { advance(world, buffer, frames); }));
+
+   //A rollback ends at the frame it started from, so it can be repeated.
+   uint64_t before = hashWorld(world);
+   results.push_back(run("resimulate " + rollback + suffix, [&](uint64_t)
+   {
+      buffer.resimulate(buffer.getFrame() - frames);
+   }));
+   bool isSame = hashWorld(world) == before;
+
+   results.push_back(runRestore("restore " + rollback + suffix, world, buffer, frames));
+
+   unsigned changes = 0;
+   for (unsigned frame = buffer.getFrame() - frames + 1; frame <= buffer.getFrame(); frame++)
+      changes += buffer.getNumberOfChanges(frame);
+
+   writeTable(std::cout, results);
+   std::printf("\n%.1f%% awake, %.1f changes recorded per frame, resimulation %s\n",
+               awakeFraction * 100, double(changes) / frames,
+               isSame ? "matches the original run" : "DIVERGED from the original run");
+
+   if (!jsonPath.empty())
+   {
+      std::ofstream json(jsonPath.c_str());
+      writeJson(json, "RollbackBenchmarks", results);
+      if (!json)
+      {
+         std::cerr << "Could not write " << jsonPath << '\n';
+         return 1;
+      }
+   }
+   return isSame ? 0 : 2;
+}
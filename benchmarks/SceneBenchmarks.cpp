@@ -0,0 +1,415 @@
+////////////////////////////////////////////////////////////
+//
+// Fizzex - The Simple Physics Library
+// Copyright (C) 2014-2016 Leonardo Gutierrez (leongflux@gmail.com)
+//
+// This software is provided 'as-is', without any express or implied warranty.
+// In no event will the authors be held liable for any damages arising from the
+// use of this software.
+//
+// Permission is granted to anyone to use this software for any purpose,
+// including commercial applications, and to alter it and redistribute it freely,
+// subject to the following restrictions:
+//
+// 1. The origin of this software must not be misrepresented;
+//    you must not claim that you wrote the original software.
+//    If you use this software in a product, an acknowledgment
+//    in the product documentation would be appreciated but is not required.
+//
+// 2. Altered source versions must be plainly marked as such,
+//    and must not be misrepresented as being the original software.
+//
+// 3. This notice may not be removed or altered from any source distribution.
+//
+////////////////////////////////////////////////////////////
+//
+// Runs canonical scenes through World::step() at several body counts and
+// thread counts, and reports per-step time percentiles, contacts per step and
+// the peak memory the engine accounted to Memory during each run. Build it
+// with every library source, World.cpp and Collision.cpp included:
+//
+//    g++ -std=c++11 -O2 -pthread SceneBenchmarks.cpp ../*.cpp -o SceneBenchmarks
+//
+// Usage: SceneBenchmarks [--scenes a,b] [--counts 1000,10000] [--threads 1,4]
+//                        [--steps n] [--json file] [--baseline file]
+//                        [--tolerance fraction]
+//
+// World has no internal parallelism, so a thread count of T steps T copies of
+// the scene at once, one per thread, to show how throughput scales.
+//
+////////////////////////////////////////////////////////////
+
+#include "Benchmark.hpp"
+
+#include "../Memory.hpp"
+#include "../World.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+using namespace fzx;
+using namespace fzx::benchmark;
+
+namespace
+{
+
+/**
+ * The measurements of one scene at one body count and thread count.
+ */
+struct SceneResult
+{
+   std::string scene;
+   unsigned bodies;
+   unsigned threads;
+   double p50, p90, p99, max; ///< Step times in milliseconds.
+   double contactsPerStep;
+   long peakMemoryKilobytes; ///< The peak of Memory::getTotalStats() during the run.
+};
+
+typedef void (*SceneBuilder)(World& world, unsigned count, Random& random);
+
+void addGround(World& world, float width, float y)
+{
+   RigidBody& ground = world.addBody("ground");
+   ground.setShapeToRectangle(width, 1);
+   ground.getTransform().setTranslation(Vec2f(0, y));
+   ground.setBodyType(RigidBody::STATIC);
+}
+
+/**
+ * A pyramid of boxes resting on the ground.
+ */
+void buildPyramid(World& world, unsigned count, Random&)
+{
+   unsigned rows = (unsigned)((std::sqrt(8.0 * count + 1) - 1) / 2);
+   addGround(world, rows * 1.2f + 10, -1);
+   for (unsigned row = 0; row < rows; row++)
+   {
+      for (unsigned column = 0; column < rows - row; column++)
+      {
+         RigidBody& box = world.addBody("box");
+         box.setShapeToRectangle(1, 1);
+         box.getTransform().setTranslation(
+            Vec2f((column - (rows - row) / 2.0f) * 1.05f, row * 1.0f));
+      }
+   }
+}
+
+/**
+ * Circles falling onto the ground from random heights.
+ */
+void buildRain(World& world, unsigned count, Random& random)
+{
+   float width = std::sqrt((float)count) * 2;
+   addGround(world, width * 2, -1);
+   for (unsigned i = 1; i < count; i++)
+   {
+      RigidBody& drop = world.addBody("drop");
+      drop.setShapeToCircle(.25f);
+      drop.getTransform().setTranslation(
+         Vec2f(random.nextFloat(-width, width), random.nextFloat(0, width)));
+   }
+}
+
+/**
+ * Random convex polygons dropped into a heap.
+ */
+void buildPile(World& world, unsigned count, Random& random)
+{
+   float width = std::sqrt((float)count);
+   addGround(world, width * 3, -1);
+   for (unsigned i = 1; i < count; i++)
+   {
+      unsigned numberOfVertices = 3 + random.next() % 6;
+      std::vector<Vec2f> vertices;
+      for (unsigned j = 0; j < numberOfVertices; j++)
+      {
+         float angle = 6.2831853f * (j + random.nextFloat(0, .5f)) / numberOfVertices;
+         vertices.push_back(Vec2f(std::cos(angle), std::sin(angle)) * random.nextFloat(.3f, .6f));
+      }
+      RigidBody& piece = world.addBody("piece");
+      piece.setShapeToPolygon(vertices);
+      piece.getTransform().setTranslation(
+         Vec2f(random.nextFloat(-width, width), random.nextFloat(0, width * 2)));
+   }
+}
+
+/**
+ * A grid of sleeping buildings where only one in a hundred is awake.
+ */
+void buildCity(World& world, unsigned count, Random& random)
+{
+   unsigned side = (unsigned)std::sqrt((float)count);
+   addGround(world, side * 3.0f + 10, -1);
+   for (unsigned i = 1; i < count; i++)
+   {
+      RigidBody& building = world.addBody("building");
+      building.setShapeToRectangle(2, 1 + random.nextFloat(0, 2));
+      building.getTransform().setTranslation(Vec2f((i % side) * 3.0f, (i / side) * 4.0f));
+      if (random.next() % 100 != 0) building.stop();
+   }
+}
+
+/**
+ * Many small stacks of three boxes, each on its own ground, far apart.
+ */
+void buildIslands(World& world, unsigned count, Random&)
+{
+   for (unsigned island = 0; island * 4 < count; island++)
+   {
+      float x = island * 10.0f;
+      RigidBody& ground = world.addBody("ground");
+      ground.setShapeToRectangle(4, 1);
+      ground.getTransform().setTranslation(Vec2f(x, -1));
+      ground.setBodyType(RigidBody::STATIC);
+      for (unsigned level = 0; level < 3; level++)
+      {
+         RigidBody& box = world.addBody("box");
+         box.setShapeToRectangle(1, 1);
+         box.getTransform().setTranslation(Vec2f(x, level * 1.0f));
+      }
+   }
+}
+
+SceneBuilder findScene(const std::string& name)
+{
+   if (name == "pyramid") return buildPyramid;
+   if (name == "rain") return buildRain;
+   if (name == "pile") return buildPile;
+   if (name == "city") return buildCity;
+   if (name == "islands") return buildIslands;
+   return nullptr;
+}
+
+double getPercentile(const std::vector<double>& sorted, double fraction)
+{
+   std::size_t index = (std::size_t)(fraction * (sorted.size() - 1) + .5);
+   return sorted[index];
+}
+
+SceneResult runScene(const std::string& name, SceneBuilder builder, unsigned count,
+                     unsigned threads, unsigned steps)
+{
+   const unsigned warmupSteps = 10;
+   //Each run starts from what earlier runs left behind, rather than their peak.
+   Memory::resetPeaks();
+   std::vector<std::unique_ptr<World>> worlds;
+   for (unsigned i = 0; i < threads; i++)
+   {
+      worlds.emplace_back(new World(4, 8, 1 / 60.0f));
+      worlds.back()->setGravity(Vec2f(0, -9.8f));
+      Random random(count);
+      builder(*worlds.back(), count, random);
+   }
+
+   std::vector<std::vector<double>> times(threads);
+   std::vector<double> contacts(threads, 0);
+   auto stepWorld = [&](unsigned i)
+   {
+      World& world = *worlds[i];
+      for (unsigned step = 0; step < warmupSteps + steps; step++)
+      {
+         std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+         world.step();
+         double milliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+         if (step < warmupSteps) continue;
+
+         times[i].push_back(milliseconds);
+         for (unsigned j = 0; j < world.getNumberOfCollisions(); j++)
+            contacts[i] += world.getCollision(j).getNumberOfContacts();
+      }
+   };
+
+   std::vector<std::thread> workers;
+   for (unsigned i = 1; i < threads; i++) workers.push_back(std::thread(stepWorld, i));
+   stepWorld(0);
+   for (std::thread& worker : workers) worker.join();
+
+   std::vector<double> allTimes;
+   double totalContacts = 0;
+   for (unsigned i = 0; i < threads; i++)
+   {
+      allTimes.insert(allTimes.end(), times[i].begin(), times[i].end());
+      totalContacts += contacts[i];
+   }
+   std::sort(allTimes.begin(), allTimes.end());
+
+   SceneResult result;
+   result.scene = name;
+   result.bodies = worlds[0]->getNumberOfBodies();
+   result.threads = threads;
+   result.p50 = getPercentile(allTimes, .5);
+   result.p90 = getPercentile(allTimes, .9);
+   result.p99 = getPercentile(allTimes, .99);
+   result.max = allTimes.back();
+   result.contactsPerStep = totalContacts / allTimes.size();
+   result.peakMemoryKilobytes = (long)(Memory::getTotalStats().peakBytes / 1024);
+   return result;
+}
+
+std::vector<std::string> split(const std::string& list)
+{
+   std::vector<std::string> items;
+   std::stringstream stream(list);
+   std::string item;
+   while (std::getline(stream, item, ',')) if (!item.empty()) items.push_back(item);
+   return items;
+}
+
+/**
+ * Writes one result per line, so the baseline can be read back with sscanf.
+ */
+void writeReport(std::ostream& output, const std::vector<SceneResult>& results)
+{
+   output << "{\n  \"suite\": \"scenes\",\n  \"results\": [\n";
+   for (std::size_t i = 0; i < results.size(); i++)
+   {
+      const SceneResult& r = results[i];
+      char line[320];
+      std::snprintf(line, sizeof(line),
+         "    {\"scene\": \"%s\", \"bodies\": %u, \"threads\": %u, \"p50_ms\": %.4f, "
+         "\"p90_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, \"contacts_per_step\": %.1f, "
+         "\"peak_memory_kb\": %ld}%s\n",
+         r.scene.c_str(), r.bodies, r.threads, r.p50, r.p90, r.p99, r.max,
+         r.contactsPerStep, r.peakMemoryKilobytes, i + 1 < results.size() ? "," : "");
+      output << line;
+   }
+   output << "  ]\n}\n";
+}
+
+std::vector<SceneResult> readReport(std::istream& input)
+{
+   std::vector<SceneResult> results;
+   std::string line;
+   while (std::getline(input, line))
+   {
+      SceneResult r;
+      char scene[64];
+      if (std::sscanf(line.c_str(),
+             " {\"scene\": \"%63[^\"]\", \"bodies\": %u, \"threads\": %u, \"p50_ms\": %lf, "
+             "\"p90_ms\": %lf, \"p99_ms\": %lf, \"max_ms\": %lf, \"contacts_per_step\": %lf, "
+             "\"peak_memory_kb\": %ld",
+             scene, &r.bodies, &r.threads, &r.p50, &r.p90, &r.p99, &r.max,
+             &r.contactsPerStep, &r.peakMemoryKilobytes) == 9)
+      {
+         r.scene = scene;
+         results.push_back(r);
+      }
+   }
+   return results;
+}
+
+/**
+ * Prints the change in median step time against a baseline.
+ *
+ * @return The number of runs that got slower by more than the tolerance.
+ */
+unsigned compare(const std::vector<SceneResult>& results,
+                 const std::vector<SceneResult>& baseline, double tolerance)
+{
+   unsigned regressions = 0;
+   std::cout << "\nAgainst baseline (p50):\n";
+   for (const SceneResult& r : results)
+   {
+      for (const SceneResult& b : baseline)
+      {
+         if (b.scene != r.scene || b.bodies != r.bodies || b.threads != r.threads) continue;
+         double change = r.p50 / b.p50 - 1;
+         bool isRegression = change > tolerance;
+         regressions += isRegression;
+         std::printf("%-8s %8u bodies %2u threads %10.3f -> %10.3f ms %+7.1f%%%s\n",
+                     r.scene.c_str(), r.bodies, r.threads, b.p50, r.p50, change * 100,
+                     isRegression ? "  REGRESSION" : "");
+      }
+   }
+   return regressions;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+   std::vector<std::string> scenes = split("pyramid,rain,pile,city,islands");
+   std::vector<std::string> counts = split("1000,10000,100000");
+   std::vector<std::string> threads = split("1");
+   unsigned steps = 120;
+   double tolerance = .1;
+   std::string jsonPath;
+   std::string baselinePath;
+
+   for (int i = 1; i < argc; i += 2)
+   {
+      std::string option = i + 1 < argc ? argv[i] : "";
+      std::string value = option.empty() ? "" : argv[i + 1];
+      if (option == "--scenes") scenes = split(value);
+      else if (option == "--counts") counts = split(value);
+      else if (option == "--threads") threads = split(value);
+      else if (option == "--steps") steps = std::max(1, std::atoi(value.c_str()));
+      else if (option == "--tolerance") tolerance = std::atof(value.c_str());
+      else if (option == "--json") jsonPath = value;
+      else if (option == "--baseline") baselinePath = value;
+      else
+      {
+         std::cerr << "Usage: " << argv[0] << " [--scenes a,b] [--counts 1000,10000]"
+                   << " [--threads 1,4] [--steps n] [--json file] [--baseline file]"
+                   << " [--tolerance fraction]\n";
+         return 1;
+      }
+   }
+
+   std::vector<SceneResult> results;
+   std::printf("%-8s %8s %7s %10s %10s %10s %10s %12s %10s\n", "scene", "bodies", "threads",
+               "p50 ms", "p90 ms", "p99 ms", "max ms", "contacts", "peak KB");
+   for (const std::string& scene : scenes)
+   {
+      SceneBuilder builder = findScene(scene);
+      if (!builder)
+      {
+         std::cerr << "Unknown scene " << scene << '\n';
+         return 1;
+      }
+      for (const std::string& count : counts)
+      {
+         for (const std::string& threadCount : threads)
+         {
+            SceneResult r = runScene(scene, builder, std::atoi(count.c_str()),
+                                     std::max(1, std::atoi(threadCount.c_str())), steps);
+            std::printf("%-8s %8u %7u %10.3f %10.3f %10.3f %10.3f %12.1f %10ld\n",
+                        r.scene.c_str(), r.bodies, r.threads, r.p50, r.p90, r.p99, r.max,
+                        r.contactsPerStep, r.peakMemoryKilobytes);
+            std::fflush(stdout);
+            results.push_back(r);
+         }
+      }
+   }
+
+   if (!jsonPath.empty())
+   {
+      std::ofstream json(jsonPath.c_str());
+      writeReport(json, results);
+      if (!json)
+      {
+         std::cerr << "Could not write " << jsonPath << '\n';
+         return 1;
+      }
+   }
+
+   if (!baselinePath.empty())
+   {
+      std::ifstream baselineFile(baselinePath.c_str());
+      if (!baselineFile)
+      {
+         std::cerr << "Could not read " << baselinePath << '\n';
+         return 1;
+      }
+      if (compare(results, readReport(baselineFile), tolerance) > 0) return 2;
+   }
+   return 0;
+}